@@ -9,6 +9,8 @@
 
 #include <WiFi.h>
 #include <esp_now.h>
+#include <stddef.h>
+#include <string.h>
 
 // Debug message structure
 typedef struct __attribute__((packed)) debug_message {
@@ -37,16 +39,18 @@ typedef struct __attribute__((packed)) discovery_req {
 #define MSG_DEBUG_MONITOR_REQ 0x05
 
 void OnDataRecv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-  if (len < sizeof(debug_message)) return;
+  if (len < 2 || data[0] != MSG_DEBUG) return;
   
-  debug_message msg;
-  memcpy(&msg, data, len);
+  // Read the text in place, bounded by the frame: it may be longer than
+  // debug_message or arrive without its terminator
+  const char* text = (const char*)data + offsetof(debug_message, message);
+  size_t maxLen = len - offsetof(debug_message, message);
+  if (maxLen > sizeof(((debug_message*)0)->message)) maxLen = sizeof(((debug_message*)0)->message);
   
-  if (msg.msgType == MSG_DEBUG) {
-    // Print debug message to Serial
-    Serial.print("[DEBUG] ");
-    Serial.println(msg.message);
-  }
+  // Print debug message to Serial
+  Serial.print("[DEBUG] ");
+  Serial.write((const uint8_t*)text, strnlen(text, maxLen));
+  Serial.println();
 }
 
 void sendDiscoveryRequest() {
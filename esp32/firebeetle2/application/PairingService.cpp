@@ -1,14 +1,15 @@
 #include "PairingService.h"
-#include <WiFi.h>
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 #include "../shared/messages.h"
+#include "../shared/utils.h"
 
 void pairingService_init(PairingService* service, PairingState* state, EspNowTransport* transport, uint8_t pedalMode, unsigned long bootTime) {
   service->pairingState = state;
   service->transport = transport;
   service->pedalMode = pedalMode;
   service->bootTime = bootTime;
+  service->lastOnlineTime = bootTime;
   service->onPaired = nullptr;
 }
 
@@ -27,12 +28,31 @@ void pairingService_handleBeacon(PairingService* service, const uint8_t* senderM
   }
 }
 
-void pairingService_handleDiscoveryResponse(PairingService* service, const uint8_t* senderMAC, uint8_t channel) {
+// What the receiver lists is what it accepts from us; legacy receivers list nothing
+static void pairingService_setLinkCapabilities(PairingService* service, PeerProtocol receiver) {
+  service->pairingState->linkCapabilities = messageCodec_negotiate(receiver);
+}
+
+// From the receive callback the request is posted for loop() to send
+static void pairingService_sendDiscoveryRequest(PairingService* service, const uint8_t* receiverMAC,
+                                                bool fromCallback) {
+  handshake_message discovery = {MSG_DISCOVERY_REQ, 0, false, service->pedalMode, 0,
+                                 PROTOCOL_VERSION, PROTOCOL_CAPABILITIES};
+  if (fromCallback) {
+    espNowTransport_post(service->transport, receiverMAC, (uint8_t*)&discovery, sizeof(discovery));
+  } else {
+    espNowTransport_send(service->transport, receiverMAC, (uint8_t*)&discovery, sizeof(discovery));
+  }
+}
+
+void pairingService_handleDiscoveryResponse(PairingService* service, const uint8_t* senderMAC, PeerProtocol receiver,
+                                            uint8_t channel) {
   if (!service->pairingState->waitingForDiscoveryResponse) {
     return;  // Not waiting for response
   }
   
   pairingState_setPaired(service->pairingState, senderMAC);
+  pairingService_setLinkCapabilities(service, receiver);
   espNowTransport_addPeer(service->transport, senderMAC, channel);
   
   // Clear waiting flag since we're now paired
@@ -46,9 +66,18 @@ void pairingService_handleDiscoveryResponse(PairingService* service, const uint8
   }
 }
 
-void pairingService_handleAlive(PairingService* service, const uint8_t* senderMAC, uint8_t channel) {
+void pairingService_handleAlive(PairingService* service, const uint8_t* senderMAC, PeerProtocol receiver,
+                                uint8_t channel) {
   if (pairingState_isPaired(service->pairingState)) {
-    return;  // Already paired, ignore
+    // Our receiver may have been reflashed since we paired. Its ping asks
+    // whether we are still here; without an answer a full receiver replaces
+    // us. Posted: this runs on the receive callback.
+    if (macEqual(senderMAC, service->pairingState->pairedReceiverMAC)) {
+      pairingService_setLinkCapabilities(service, receiver);
+      handshake_message alive = {MSG_ALIVE, 0, false, service->pedalMode, 0, PROTOCOL_VERSION, PROTOCOL_CAPABILITIES};
+      espNowTransport_post(service->transport, senderMAC, (uint8_t*)&alive, sizeof(alive));
+    }
+    return;
   }
   
   // Check if this is the discovered receiver
@@ -63,6 +92,7 @@ void pairingService_handleAlive(PairingService* service, const uint8_t* senderMA
     
     // Pair immediately
     pairingState_setPaired(service->pairingState, senderMAC);
+    pairingService_setLinkCapabilities(service, receiver);
     espNowTransport_addPeer(service->transport, senderMAC, channel);
     
     // Clear waiting flag since we're now paired
@@ -85,11 +115,10 @@ void pairingService_handleAlive(PairingService* service, const uint8_t* senderMA
     pairingState_clearDiscoveredReceiver(service->pairingState);
     espNowTransport_addPeer(service->transport, senderMAC, channel);
     
-    struct_message discovery = {MSG_DISCOVERY_REQ, 0, false, service->pedalMode};
-    espNowTransport_send(service->transport, senderMAC, (uint8_t*)&discovery, sizeof(discovery));
+    pairingService_sendDiscoveryRequest(service, senderMAC, true);
     
     service->pairingState->waitingForDiscoveryResponse = true;
-    service->pairingState->discoveryRequestTime = millis();
+    service->pairingState->discoveryRequestTime = halClock_millis();
   }
 }
 
@@ -114,27 +143,28 @@ void pairingService_initiatePairing(PairingService* service, const uint8_t* rece
   
   espNowTransport_addPeer(service->transport, receiverMAC, channel);
   
-  struct_message discovery = {MSG_DISCOVERY_REQ, 0, false, service->pedalMode};
-  espNowTransport_send(service->transport, receiverMAC, (uint8_t*)&discovery, sizeof(discovery));
+  pairingService_sendDiscoveryRequest(service, receiverMAC, false);
   
   service->pairingState->waitingForDiscoveryResponse = true;
-  service->pairingState->discoveryRequestTime = millis();
+  service->pairingState->discoveryRequestTime = halClock_millis();
 }
 
 void pairingService_broadcastOnline(PairingService* service) {
   uint8_t transmitterMAC[6];
-  WiFi.macAddress(transmitterMAC);
+  halRadio_macAddress(transmitterMAC);
   
   transmitter_online_message onlineMsg;
   onlineMsg.msgType = MSG_TRANSMITTER_ONLINE;
   macCopy(onlineMsg.transmitterMAC, transmitterMAC);
+  onlineMsg.protocolVersion = PROTOCOL_VERSION;
+  onlineMsg.capabilities = PROTOCOL_CAPABILITIES;
   
   espNowTransport_broadcast(service->transport, (uint8_t*)&onlineMsg, sizeof(onlineMsg));
 }
 
 void pairingService_broadcastPaired(PairingService* service, const uint8_t* receiverMAC) {
   uint8_t transmitterMAC[6];
-  WiFi.macAddress(transmitterMAC);
+  halRadio_macAddress(transmitterMAC);
   
   transmitter_paired_message pairedMsg;
   pairedMsg.msgType = MSG_TRANSMITTER_PAIRED;
@@ -144,4 +174,33 @@ void pairingService_broadcastPaired(PairingService* service, const uint8_t* rece
   espNowTransport_broadcast(service->transport, (uint8_t*)&pairedMsg, sizeof(pairedMsg));
 }
 
+bool pairingService_checkDiscoveryTimeout(PairingService* service, unsigned long currentTime) {
+  if (!service->pairingState->waitingForDiscoveryResponse) {
+    return false;
+  }
+  
+  if (currentTime - service->pairingState->discoveryRequestTime < DISCOVERY_RESPONSE_TIMEOUT) {
+    return false;
+  }
+  
+  // No response - forget the request so the next pedal press can retry
+  service->pairingState->waitingForDiscoveryResponse = false;
+  service->pairingState->discoveryRequestTime = 0;
+  return true;
+}
 
+// The boot announcement is a single broadcast. Until we pair or hear a beacon,
+// repeat it so a lost one doesn't leave a full receiver unaware of us.
+bool pairingService_checkOnline(PairingService* service, unsigned long currentTime) {
+  if (pairingState_isPaired(service->pairingState) || service->pairingState->receiverBeaconReceived) {
+    return false;
+  }
+  
+  if (currentTime - service->lastOnlineTime < ONLINE_REPEAT_INTERVAL) {
+    return false;
+  }
+  
+  pairingService_broadcastOnline(service);
+  service->lastOnlineTime = currentTime;
+  return true;
+}
@@ -2,10 +2,11 @@
 #include "../application/PairingService.h"
 #include <string.h>
 #include <stdarg.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 #include "../shared/messages.h"
+#include "../shared/utils.h"
 
-// Forward declaration - debugPrint is defined in transmitter.ino
+// Forward declaration - debugPrint is defined in the sketch (.ino)
 extern void debugPrint(const char* format, ...);
 extern bool debugEnabled;
 
@@ -21,10 +22,11 @@ void onPedalPress(char key) {
   
   // Log pedal press
   if (debugEnabled) {
+    long latency = (long)pedalReader_stateForKey(g_pedalService->reader, key)->pressLatency.lastMicros;
     if (pairingState_isPaired(g_pedalService->pairingState)) {
-      debugPrint("Pedal %c PRESSED\n", key);
+      debugPrint("Pedal %c PRESSED (%ld us after edge)\n", key, latency);
     } else {
-      debugPrint("Pedal %c PRESSED (not paired)\n", key);
+      debugPrint("Pedal %c PRESSED (not paired, %ld us after edge)\n", key, latency);
     }
   }
   
@@ -42,10 +44,8 @@ void onPedalPress(char key) {
     }
   }
   
-  // Send pedal event if paired
-  if (pairingState_isPaired(g_pedalService->pairingState)) {
-    pedalService_sendPedalEvent(g_pedalService, key, true);
-  }
+  // Sent now if paired, otherwise queued until pairing completes
+  pedalService_sendPedalEvent(g_pedalService, key, true);
   
   if (g_pedalService->onActivity) {
     g_pedalService->onActivity();
@@ -57,17 +57,15 @@ void onPedalRelease(char key) {
   
   // Log pedal release
   if (debugEnabled) {
+    long latency = (long)pedalReader_stateForKey(g_pedalService->reader, key)->releaseLatency.lastMicros;
     if (pairingState_isPaired(g_pedalService->pairingState)) {
-      debugPrint("Pedal %c RELEASED\n", key);
+      debugPrint("Pedal %c RELEASED (%ld us after edge)\n", key, latency);
     } else {
-      debugPrint("Pedal %c RELEASED (not paired)\n", key);
+      debugPrint("Pedal %c RELEASED (not paired, %ld us after edge)\n", key, latency);
     }
   }
   
-  // Send pedal event if paired
-  if (pairingState_isPaired(g_pedalService->pairingState)) {
-    pedalService_sendPedalEvent(g_pedalService, key, false);
-  }
+  pedalService_sendPedalEvent(g_pedalService, key, false);
   
   if (g_pedalService->onActivity) {
     g_pedalService->onActivity();
@@ -81,39 +79,101 @@ void pedalService_init(PedalService* service, PedalReader* reader, PairingState*
   service->transport = transport;
   service->lastActivityTime = lastActivityTime;
   service->bootTime = bootTime;
+  service->lastSeq = 0;
+  service->lastSnapshotTime = 0;
+  pedalEventQueue_init(&service->eventQueue, PEDAL_EVENT_QUEUE_STALE_MS);
   service->onActivity = nullptr;
   g_pedalService = service;
 }
 
-void pedalService_update(PedalService* service) {
-  pedalReader_update(service->reader, onPedalPress, onPedalRelease);
+// Sends a frame to the paired receiver; copies > 1 queue back-to-back as a
+// redundant burst, each contending for the channel on its own, so loop() never waits
+static bool pedalService_sendFrame(PedalService* service, const void* frame, int len, int copies, uint8_t retries) {
+  bool sent = false;
+  for (int copy = 0; copy < copies; copy++) {
+    sent |= espNowTransport_sendWithRetry(service->transport, service->pairingState->pairedReceiverMAC, 
+                                          (const uint8_t*)frame, len, retries);
+  }
+  
+  unsigned long now = halClock_millis();
+  service->lastSnapshotTime = now;
+  if (service->lastActivityTime) {
+    *service->lastActivityTime = now;
+  }
+  return sent;
 }
 
-void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed) {
-  if (!pairingState_isPaired(service->pairingState)) {
-    return;  // Not paired
+// Sends the state of every pedal
+static bool pedalService_sendSnapshot(PedalService* service, uint8_t pedalMask, int copies, uint8_t retries) {
+  pedal_snapshot_message msg = {
+    .msgType = MSG_PEDAL_SNAPSHOT,
+    .pedalMask = pedalMask,
+    .pedalMode = service->reader->pedalMode,
+    .seq = service->lastSeq
+  };
+  return pedalService_sendFrame(service, &msg, sizeof(msg), copies, retries);
+}
+
+// Sends in the fastest format the paired receiver supports. Sequence numbers
+// skip 0, which marks frames without one.
+static bool pedalService_sendEvent(PedalService* service, char key, bool pressed, uint8_t pedalMask) {
+  service->lastSeq = service->lastSeq == 255 ? 1 : service->lastSeq + 1;
+  uint8_t capabilities = service->pairingState->linkCapabilities;
+  
+  // The snapshot carries every pedal's state, so a lost one is repaired by the
+  // next. The first copy goes out immediately; the others cover a lost frame
+  // without waiting for a retry timeout. The receiver drops the duplicates by
+  // seq, and the transport resends any copy the MAC layer reports as failed.
+  if (capabilities & CAP_SNAPSHOT) {
+    return pedalService_sendSnapshot(service, pedalMask, PEDAL_EVENT_BURST_COUNT, PEDAL_EVENT_RETRY_BUDGET);
   }
   
-  // Note: pedalMode field is not used by receiver (it uses transmitterManager data)
-  // but we set it for consistency
-  // Use designated initializer for better code generation
-  struct_message msg = {
-    .msgType = MSG_PEDAL_EVENT,
-    .key = key,
-    .pressed = pressed,
-    .pedalMode = service->reader->pedalMode
-  };
+  // Older receivers take one struct_message per edge, and only drop burst
+  // copies if they understand seq
+  bool sequenced = capabilities & CAP_SEQUENCE;
+  struct_message msg = {MSG_PEDAL_EVENT, key, pressed, service->reader->pedalMode,
+                        (uint8_t)(sequenced ? service->lastSeq : 0)};
+  return pedalService_sendFrame(service, &msg, sizeof(msg), sequenced ? PEDAL_EVENT_BURST_COUNT : 1,
+                                PEDAL_EVENT_RETRY_BUDGET);
+}
+
+void pedalService_update(PedalService* service) {
+  pedalReader_update(service->reader, onPedalPress, onPedalRelease);
   
-  bool sent = espNowTransport_send(service->transport, service->pairingState->pairedReceiverMAC, 
-                                   (uint8_t*)&msg, sizeof(msg));
+  if (!pairingState_isPaired(service->pairingState)) return;
   
-  // Only log failures (successful sends are routine)
-  if (debugEnabled && !sent) {
-    debugPrint("Pedal event send FAILED: key='%c', %s\n", key, pressed ? "PRESSED" : "RELEASED");
+  // Drain one queued event per pass, so a replayed tap still reaches the
+  // host as a press and a release a loop period apart
+  QueuedPedalEvent queued;
+  if (pedalEventQueue_peek(&service->eventQueue, halClock_millis(), &queued)) {
+    if (pedalService_sendEvent(service, queued.key, queued.pressed, queued.pedalMask)) {
+      pedalEventQueue_pop(&service->eventQueue);
+    }
+    return;
   }
   
-  if (service->lastActivityTime) {
-    *service->lastActivityTime = millis();
+  // Keepalive: lets the receiver release our keys if we go silent while held
+  if ((service->pairingState->linkCapabilities & CAP_SNAPSHOT) && pedalReader_pressedMask(service->reader) != 0 &&
+      halClock_millis() - service->lastSnapshotTime >= PEDAL_SNAPSHOT_KEEPALIVE_MS) {
+    pedalService_sendSnapshot(service, pedalReader_pressedMask(service->reader), 1, 0);
   }
 }
 
+void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed) {
+  uint8_t pedalMask = pedalReader_pressedMask(service->reader);
+  
+  // Nothing overtakes an event that is still waiting
+  if (!pairingState_isPaired(service->pairingState) || !pedalEventQueue_isEmpty(&service->eventQueue)) {
+    pedalEventQueue_push(&service->eventQueue, key, pressed, pedalMask, halClock_millis());
+    return;
+  }
+  
+  if (!pedalService_sendEvent(service, key, pressed, pedalMask)) {
+    pedalEventQueue_push(&service->eventQueue, key, pressed, pedalMask, halClock_millis());
+    
+    // Only log failures (successful sends are routine)
+    if (debugEnabled) {
+      debugPrint("Pedal event send FAILED, queued: key='%c', %s\n", key, pressed ? "PRESSED" : "RELEASED");
+    }
+  }
+}
@@ -3,10 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "../domain/PedalReader.h"
+#include "../shared/PedalReader.h"
 #include "../domain/PairingState.h"
 #include "../infrastructure/EspNowTransport.h"
 #include "../shared/messages.h"
+#include "../shared/PedalEventQueue.h"
 #include "PairingService.h"
 
 typedef struct {
@@ -14,11 +15,15 @@ typedef struct {
   PairingState* pairingState;
   EspNowTransport* transport;
   unsigned long* lastActivityTime;
+  unsigned long bootTime;
+  uint8_t lastSeq;  // Sequence number of the last pedal event sent
+  unsigned long lastSnapshotTime;
+  PedalEventQueue eventQueue;  // Events waiting for the link, sent in order
   void (*onActivity)();
 } PedalService;
 
 void pedalService_init(PedalService* service, PedalReader* reader, PairingState* pairingState, 
-                       EspNowTransport* transport, unsigned long* lastActivityTime);
+                       EspNowTransport* transport, unsigned long* lastActivityTime, unsigned long bootTime);
 void pedalService_setPairingService(PairingService* pairingService);
 void pedalService_update(PedalService* service);
 void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed);
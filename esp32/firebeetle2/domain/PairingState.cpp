@@ -1,6 +1,5 @@
 #include "PairingState.h"
 #include <string.h>
-#include <Arduino.h>
 
 void pairingState_init(PairingState* state) {
   memset(state->pairedReceiverMAC, 0, 6);
@@ -10,6 +9,7 @@ void pairingState_init(PairingState* state) {
   state->waitingForDiscoveryResponse = false;
   state->receiverBeaconReceived = false;
   state->discoveryRequestTime = 0;
+  state->linkCapabilities = 0;
 }
 
 bool pairingState_isPaired(const PairingState* state) {
@@ -13,6 +13,7 @@ typedef struct {
   bool waitingForDiscoveryResponse;
   bool receiverBeaconReceived;
   unsigned long discoveryRequestTime;
+  uint8_t linkCapabilities;  // CAP_* bits both we and the paired receiver support
 } PairingState;
 
 void pairingState_init(PairingState* state);
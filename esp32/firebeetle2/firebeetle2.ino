@@ -1,12 +1,12 @@
-#include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
-#include "esp_wifi.h"
+#include <stdarg.h>
+#include <string.h>
 
 // Clean Architecture: Include shared and domain modules
+#include "shared/hal/Hal.h"
 #include "shared/messages.h"
+#include "shared/MessageCodec.h"
 #include "domain/PairingState.h"
-#include "domain/PedalReader.h"
+#include "shared/PedalReader.h"
 #include "infrastructure/EspNowTransport.h"
 #include "application/PairingService.h"
 #include "application/PedalService.h"
@@ -16,6 +16,10 @@
 // ============================================================================
 #define PEDAL_MODE 1  // 0=DUAL (pins 13 & 14), 1=SINGLE (pin 13 only)
 #define DEBUG_ENABLED 1  // Set to 0 to disable Serial output and save battery
+#define PEDAL_INTERRUPT_CAPTURE 1  // 1=GPIO interrupts timestamp pedal edges, 0=poll pins every loop()
+#define PEDAL_1_DEBOUNCE DEBOUNCE_POLICY_DEFERRED  // DEBOUNCE_POLICY_DEFERRED (wait DEBOUNCE_DELAY) or DEBOUNCE_POLICY_EAGER (press once an edge holds DEBOUNCE_CONFIRM_US)
+#define PEDAL_2_DEBOUNCE DEBOUNCE_POLICY_DEFERRED
+#define DEBOUNCE_LOCKOUT_MS DEBOUNCE_LOCKOUT  // Eager policy: ignore edges for this long after a reported change
 // ============================================================================
 
 #define PEDAL_1_PIN 13
@@ -36,163 +40,146 @@ PedalService pedalService;
 // System state
 unsigned long lastActivityTime = 0;
 unsigned long bootTime = 0;
+bool debugEnabled = DEBUG_ENABLED;
 
 // Forward declarations
 void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
 void onPaired(const uint8_t* receiverMAC);
 void onActivity();
 
+void debugPrint(const char* format, ...) {
+  #if DEBUG_ENABLED
+  va_list args;
+  va_start(args, format);
+  halLog_vprintf(format, args);
+  va_end(args);
+  #endif
+}
+
 void onPaired(const uint8_t* receiverMAC) {
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(millis() - bootTime);
-  Serial.print(" ms] Successfully paired with receiver: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(receiverMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  debugPrint("[%lu ms] Successfully paired with receiver: %02X:%02X:%02X:%02X:%02X:%02X (link caps 0x%02X)\n",
+             halClock_millis() - bootTime, receiverMAC[0], receiverMAC[1], receiverMAC[2],
+             receiverMAC[3], receiverMAC[4], receiverMAC[5], pairingState.linkCapabilities);
   #endif
 }
 
 void onActivity() {
-  lastActivityTime = millis();
+  lastActivityTime = halClock_millis();
 }
 
+// Runs on the receive callback: loop() sends it
 void sendDeleteRecordMessage(const uint8_t* receiverMAC) {
-  struct_message deleteMsg = {MSG_DELETE_RECORD, 0, false, 0};
-  espNowTransport_send(&transport, receiverMAC, (uint8_t*)&deleteMsg, sizeof(deleteMsg));
+  struct_message deleteMsg = {MSG_DELETE_RECORD, 0, false, 0, 0};
+  espNowTransport_post(&transport, receiverMAC, (uint8_t*)&deleteMsg, sizeof(deleteMsg));
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(millis() - bootTime);
-  Serial.print(" ms] Sent delete record message to receiver: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(receiverMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  debugPrint("[%lu ms] Queued delete record message to receiver: %02X:%02X:%02X:%02X:%02X:%02X\n",
+             halClock_millis() - bootTime, receiverMAC[0], receiverMAC[1], receiverMAC[2],
+             receiverMAC[3], receiverMAC[4], receiverMAC[5]);
   #endif
 }
 
-void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
-  if (len < 1) return;
+// Message handlers, one per msgType; the codec has already checked each frame's length
+void onBeacon(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const beacon_message* beacon = (const beacon_message*)data;
+  pairingService_handleBeacon(&pairingService, senderMAC, beacon);
   
   #if DEBUG_ENABLED
-  unsigned long timeSinceBoot = millis() - bootTime;
-  Serial.print("[");
-  Serial.print(timeSinceBoot);
-  Serial.print(" ms] Received ESP-NOW message: len=");
-  Serial.print(len);
-  Serial.print(", sender=");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(senderMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  PeerProtocol receiver = messageCodec_peerProtocol(data, len);
+  debugPrint("[%lu ms] Received MSG_BEACON: slots=%d/%d, protocol v%d, caps 0x%02X\n",
+             halClock_millis() - bootTime, beacon->availableSlots, beacon->totalSlots,
+             receiver.version, receiver.capabilities);
   #endif
-  
-  uint8_t msgType = data[0];
-  
-  // Handle beacon message
-  if (msgType == MSG_BEACON && len >= sizeof(beacon_message)) {
-    beacon_message* beacon = (beacon_message*)data;
-    pairingService_handleBeacon(&pairingService, senderMAC, beacon);
-    
-    #if DEBUG_ENABLED
-    Serial.print("[");
-    Serial.print(timeSinceBoot);
-    Serial.print(" ms] Received MSG_BEACON: slots=");
-    Serial.print(beacon->availableSlots);
-    Serial.print("/");
-    Serial.print(beacon->totalSlots);
-    Serial.println();
-    #endif
-    return;
-  }
-  
-  // Handle other messages
-  if (len < sizeof(struct_message)) {
+}
+
+// Once paired, ALIVE and DISCOVERY_RESP only matter when another receiver
+// still lists us: tell it to delete its record
+static void rejectOtherReceiver(const uint8_t* senderMAC, uint8_t msgType, uint8_t channel) {
+  if (memcmp(senderMAC, pairingState.pairedReceiverMAC, 6) == 0) {
+    // Message from our paired receiver - accept it
     #if DEBUG_ENABLED
-    Serial.print("[");
-    Serial.print(timeSinceBoot);
-    Serial.println(" ms] Message too short");
+    debugPrint("[%lu ms] Received message from paired receiver (type=%d)\n",
+               halClock_millis() - bootTime, msgType);
     #endif
     return;
   }
   
-  struct_message* msg = (struct_message*)data;
-  
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(timeSinceBoot);
-  Serial.print(" ms] Message type=");
-  Serial.print(msg->msgType);
-  Serial.print(", isPaired=");
-  Serial.println(pairingState_isPaired(&pairingState));
+  debugPrint("[%lu ms] Received message from different receiver - sending DELETE_RECORD\n",
+             halClock_millis() - bootTime);
   #endif
   
+  espNowTransport_addPeer(&transport, senderMAC, channel);
+  sendDeleteRecordMessage(senderMAC);
+}
+
+void onDiscoveryResponse(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
   if (pairingState_isPaired(&pairingState)) {
-    // Already paired - check if message is from our paired receiver
-    if (memcmp(senderMAC, pairingState.pairedReceiverMAC, 6) == 0) {
-      // Message from our paired receiver - accept it
-      #if DEBUG_ENABLED
-      Serial.print("[");
-      Serial.print(timeSinceBoot);
-      Serial.print(" ms] Received message from paired receiver (type=");
-      Serial.print(msg->msgType);
-      Serial.println(")");
-      #endif
-    } else {
-      // Message from different receiver - send DELETE_RECORD
-      if (msg->msgType == MSG_ALIVE || msg->msgType == MSG_DISCOVERY_RESP) {
-        #if DEBUG_ENABLED
-        Serial.print("[");
-        Serial.print(timeSinceBoot);
-        Serial.println(" ms] Received message from different receiver - sending DELETE_RECORD");
-        #endif
-        
-        espNowTransport_addPeer(&transport, senderMAC, channel);
-        sendDeleteRecordMessage(senderMAC);
-      }
-    }
+    rejectOtherReceiver(senderMAC, MSG_DISCOVERY_RESP, channel);
   } else {
-    // Not paired - handle pairing messages
-    if (msg->msgType == MSG_DISCOVERY_RESP) {
-      pairingService_handleDiscoveryResponse(&pairingService, senderMAC, channel);
-    } else if (msg->msgType == MSG_ALIVE) {
-      pairingService_handleAlive(&pairingService, senderMAC, channel);
-    }
+    pairingService_handleDiscoveryResponse(&pairingService, senderMAC, messageCodec_peerProtocol(data, len), channel);
+  }
+}
+
+void onAlive(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  if (pairingState_isPaired(&pairingState)) {
+    rejectOtherReceiver(senderMAC, MSG_ALIVE, channel);
   }
+  pairingService_handleAlive(&pairingService, senderMAC, messageCodec_peerProtocol(data, len), channel);
+}
+
+static constexpr MessageTable kMessageTable = messageTable_make({
+  {MSG_BEACON, onBeacon},
+  {MSG_DISCOVERY_RESP, onDiscoveryResponse},
+  {MSG_ALIVE, onAlive},
+});
+
+void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  #if DEBUG_ENABLED
+  debugPrint("[%lu ms] Received ESP-NOW message: type=%d, len=%d, sender=%02X:%02X:%02X:%02X:%02X:%02X, isPaired=%d\n",
+             halClock_millis() - bootTime, len > 0 ? data[0] : -1, len, senderMAC[0], senderMAC[1], senderMAC[2],
+             senderMAC[3], senderMAC[4], senderMAC[5], pairingState_isPaired(&pairingState));
+  #endif
+  
+  messageTable_dispatch(&kMessageTable, senderMAC, data, len, channel);
 }
 
 
 void goToDeepSleep() {
   #if DEBUG_ENABLED
-  Serial.println("Going to deep sleep...");
+  const SendPeerStats* link = espNowTransport_peerStats(&transport, pairingState.pairedReceiverMAC);
+  if (link) {
+    debugPrint("Link: %lu sent, %lu delivered, %lu retried, %lu failed\n", (unsigned long)link->sent,
+               (unsigned long)link->delivered, (unsigned long)link->retried, (unsigned long)link->failed);
+  }
+  debugPrint("Going to deep sleep...\n");
   #endif
-  esp_sleep_enable_ext0_wakeup((gpio_num_t)PEDAL_1_PIN, LOW);
-  esp_deep_sleep_start();
+  halPower_deepSleep(PEDAL_1_PIN);
 }
 
 void setup() {
   #if DEBUG_ENABLED
-  Serial.begin(115200);
-  delay(100);
-  Serial.println("ESP-NOW Pedal Transmitter");
-  Serial.print("Mode: ");
-  Serial.println(PEDAL_MODE == 0 ? "DUAL" : "SINGLE");
+  halLog_begin(115200);
+  halClock_delay(100);
+  debugPrint("ESP-NOW Pedal Transmitter\n");
+  debugPrint("Mode: %s\n", PEDAL_MODE == 0 ? "DUAL" : "SINGLE");
   #endif
 
   // Battery optimization
-  setCpuFrequencyMhz(80);
-  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+  halPower_setCpuFrequencyMhz(80);
+  halRadio_enablePowerSave();
   
-  bootTime = millis();
-  lastActivityTime = millis();
+  bootTime = halClock_millis();
+  lastActivityTime = halClock_millis();
   
   // Initialize domain layer
   pairingState_init(&pairingState);
   pedalReader_init(&pedalReader, PEDAL_1_PIN, PEDAL_2_PIN, PEDAL_MODE);
+  pedalReader_setDebouncePolicy(&pedalReader, 0, PEDAL_1_DEBOUNCE, DEBOUNCE_LOCKOUT_MS);
+  pedalReader_setDebouncePolicy(&pedalReader, 1, PEDAL_2_DEBOUNCE, DEBOUNCE_LOCKOUT_MS);
+  #if PEDAL_INTERRUPT_CAPTURE
+  pedalReader_enableInterruptCapture(&pedalReader);
+  #endif
   
   // Initialize infrastructure layer
   espNowTransport_init(&transport);
@@ -206,7 +193,7 @@ void setup() {
   pairingService_init(&pairingService, &pairingState, &transport, PEDAL_MODE, bootTime);
   pairingService.onPaired = onPaired;
   
-  pedalService_init(&pedalService, &pedalReader, &pairingState, &transport, &lastActivityTime);
+  pedalService_init(&pedalService, &pedalReader, &pairingState, &transport, &lastActivityTime, bootTime);
   pedalService.onActivity = onActivity;
   pedalService_setPairingService(&pairingService);
   
@@ -214,17 +201,27 @@ void setup() {
   pairingService_broadcastOnline(&pairingService);
   
   #if DEBUG_ENABLED
-  Serial.println("ESP-NOW initialized");
+  debugPrint("ESP-NOW initialized\n");
   #endif
 }
 
 void loop() {
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halClock_millis();
+  
+  // Replies the receive callback queued, and resends of failed frames
+  espNowTransport_flush(&transport);
   
   // Check discovery timeout
   if (pairingService_checkDiscoveryTimeout(&pairingService, currentTime)) {
     #if DEBUG_ENABLED
-    Serial.println("Discovery response timeout");
+    debugPrint("Discovery response timeout\n");
+    #endif
+  }
+  
+  // Announce ourselves again while no receiver has answered
+  if (pairingService_checkOnline(&pairingService, currentTime)) {
+    #if DEBUG_ENABLED
+    debugPrint("Online announcement repeated\n");
     #endif
   }
   
@@ -236,17 +233,23 @@ void loop() {
   // Update pedal service (handles pedal reading and events)
   pedalService_update(&pedalService);
   
-  // Battery optimization: Variable delay based on pairing status
-  if (pairingState_isPaired(&pairingState)) {
-    delay(IDLE_DELAY_PAIRED);
-  } else {
-    delay(IDLE_DELAY_UNPAIRED);
-  }
+  // Battery optimization: Variable delay based on pairing status. A pedal edge
+  // ends it early, and a pending press shortens it to its debounce deadline.
+  unsigned long idleDelay = pairingState_isPaired(&pairingState) ? IDLE_DELAY_PAIRED : IDLE_DELAY_UNPAIRED;
+  halClock_idle(pedalReader_idleTimeout(&pedalReader, idleDelay));
 }
 
 // Include implementation files (Arduino IDE doesn't auto-compile .cpp files in subdirectories)
 #include "domain/PairingState.cpp"
-#include "domain/PedalReader.cpp"
+#include "shared/PedalReader.cpp"
+#include "shared/EspNowSendTracker.cpp"
+#include "shared/PedalEventQueue.cpp"
 #include "infrastructure/EspNowTransport.cpp"
 #include "application/PairingService.cpp"
 #include "application/PedalService.cpp"
+
+// HAL implementation for the target board (host builds define HAL_HOST and link hal/host instead)
+#ifndef HAL_HOST
+#include "shared/hal/esp32/HalSystem.cpp"
+#include "shared/hal/esp32/HalRadio.cpp"
+#endif
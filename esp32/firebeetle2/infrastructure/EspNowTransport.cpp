@@ -1,59 +1,84 @@
 #include "EspNowTransport.h"
-#include <esp_now.h>
-#include <WiFi.h>
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 #include "../shared/messages.h"
 
-static MessageReceivedCallback g_receiveCallback = nullptr;
-
-void OnDataRecvWrapper(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-  if (g_receiveCallback) {
-    uint8_t* senderMAC = (uint8_t*)info->src_addr;
-    uint8_t channel = info->rx_ctrl ? info->rx_ctrl->channel : 0;
-    g_receiveCallback(senderMAC, data, len, channel);
+// WiFi task: a failed attempt wakes loop(), which resends it from espNowTransport_flush
+static void espNowTransport_onSendComplete(void* arg, const uint8_t* mac, bool delivered) {
+  EspNowTransport* transport = (EspNowTransport*)arg;
+  if (sendTracker_onSendComplete(&transport->sendTracker, mac, delivered)) {
+    halClock_wake();
   }
 }
 
 void espNowTransport_init(EspNowTransport* transport) {
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-  
-  if (esp_now_init() == ESP_OK) {
-    transport->initialized = true;
-  } else {
-    transport->initialized = false;
+  sendTracker_init(&transport->sendTracker);
+  memset(&transport->outbox, 0, sizeof(EspNowOutbox));
+  transport->initialized = halRadio_init(0);
+  if (transport->initialized) {
+    halRadio_setSendCallback(espNowTransport_onSendComplete, transport);
   }
 }
 
 bool espNowTransport_send(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len) {
+  return espNowTransport_sendWithRetry(transport, mac, data, len, 0);
+}
+
+bool espNowTransport_sendWithRetry(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len,
+                                   uint8_t retries) {
   if (!transport->initialized) return false;
   
-  esp_err_t result = esp_now_send(mac, data, len);
-  return (result == ESP_OK);
+  return sendTracker_send(&transport->sendTracker, mac, data, len, retries);
+}
+
+// Receive callback side: queue a unicast frame for loop() to send
+bool espNowTransport_post(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len) {
+  EspNowOutbox* outbox = &transport->outbox;
+  uint32_t head = outbox->head;
+  uint32_t tail = __atomic_load_n(&outbox->tail, __ATOMIC_ACQUIRE);
+  if (!transport->initialized || len > SEND_TRACKER_MAX_FRAME || head - tail >= ESPNOW_OUTBOX_SIZE) {
+    return false;
+  }
+
+  OutboxFrame* frame = &outbox->frames[head & (ESPNOW_OUTBOX_SIZE - 1)];
+  memcpy(frame->mac, mac, 6);
+  memcpy(frame->data, data, len);
+  frame->len = (uint8_t)len;
+  __atomic_store_n(&outbox->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void espNowTransport_flush(EspNowTransport* transport) {
+  EspNowOutbox* outbox = &transport->outbox;
+  uint32_t head = __atomic_load_n(&outbox->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = outbox->tail;
+
+  while (tail != head) {
+    const OutboxFrame* frame = &outbox->frames[tail & (ESPNOW_OUTBOX_SIZE - 1)];
+    espNowTransport_send(transport, frame->mac, frame->data, frame->len);
+    tail++;
+  }
+  __atomic_store_n(&outbox->tail, tail, __ATOMIC_RELEASE);
+  sendTracker_poll(&transport->sendTracker);
+}
+
+const SendPeerStats* espNowTransport_peerStats(const EspNowTransport* transport, const uint8_t* mac) {
+  return sendTracker_peerStats(&transport->sendTracker, mac);
 }
 
 bool espNowTransport_addPeer(EspNowTransport* transport, const uint8_t* mac, uint8_t channel) {
   if (!transport->initialized) return false;
   
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, mac, 6);
-  peerInfo.channel = channel;
-  peerInfo.encrypt = false;
-  
-  esp_err_t result = esp_now_add_peer(&peerInfo);
-  return (result == ESP_OK || result == ESP_ERR_ESPNOW_EXIST);
+  return halRadio_addPeer(mac, channel);
 }
 
 void espNowTransport_registerReceiveCallback(EspNowTransport* transport, MessageReceivedCallback callback) {
   if (!transport->initialized) return;
   
-  g_receiveCallback = callback;
-  esp_now_register_recv_cb(OnDataRecvWrapper);
+  halRadio_setReceiveCallback(callback);
 }
 
 void espNowTransport_broadcast(EspNowTransport* transport, const uint8_t* data, int len) {
   uint8_t broadcastMAC[] = BROADCAST_MAC;
   espNowTransport_send(transport, broadcastMAC, data, len);
 }
-
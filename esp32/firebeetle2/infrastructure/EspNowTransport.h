@@ -3,16 +3,41 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "../shared/EspNowSendTracker.h"
+
+#define ESPNOW_OUTBOX_SIZE 4  // Must be a power of two
+
+typedef struct {
+  uint8_t mac[6];
+  uint8_t len;
+  uint8_t data[SEND_TRACKER_MAX_FRAME];
+} OutboxFrame;
+
+// Lock-free single-producer (receive callback) / single-consumer (loop) ring.
+// The send tracker is not locked on the transmitters, so replies decided on
+// the WiFi task wait here until loop() sends them.
+typedef struct {
+  OutboxFrame frames[ESPNOW_OUTBOX_SIZE];
+  volatile uint32_t head;  // Written by espNowTransport_post only
+  volatile uint32_t tail;  // Written by espNowTransport_flush only
+} EspNowOutbox;
 
 // ESP-NOW transport abstraction
 typedef struct {
   bool initialized;
+  EspNowSendTracker sendTracker;  // In-flight unicast frames and per-peer counters
+  EspNowOutbox outbox;            // Unicast replies posted from the receive callback
 } EspNowTransport;
 
 typedef void (*MessageReceivedCallback)(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
 
 void espNowTransport_init(EspNowTransport* transport);
 bool espNowTransport_send(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len);
+bool espNowTransport_sendWithRetry(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len,
+                                   uint8_t retries);  // Resent on MAC-layer failure, up to retries times
+bool espNowTransport_post(EspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len);
+void espNowTransport_flush(EspNowTransport* transport);  // Sends posted frames and resends; call from loop()
+const SendPeerStats* espNowTransport_peerStats(const EspNowTransport* transport, const uint8_t* mac);
 bool espNowTransport_addPeer(EspNowTransport* transport, const uint8_t* mac, uint8_t channel);
 void espNowTransport_registerReceiveCallback(EspNowTransport* transport, MessageReceivedCallback callback);
 void espNowTransport_broadcast(EspNowTransport* transport, const uint8_t* data, int len);
@@ -0,0 +1,136 @@
+#ifndef TRANSMITTER_HOST_MAIN_H
+#define TRANSMITTER_HOST_MAIN_H
+
+// Shared main() for the transmitter host builds. The including file pulls in
+// HalHost.cpp and one transmitter sketch, then defines HOST_PEDAL_PIN (the NO
+// contact) and, on boards that wire it, HOST_PEDAL_NC_PIN. HOST_EXTRA_CHECK, if
+// defined, names a board-specific check run last; it returns false on failure.
+// A fake receiver answers the discovery request; the program checks that a tap
+// made before pairing is replayed, then steps the sketch's loop() on the
+// virtual clock and reports press -> radio latency.
+
+#include <stdio.h>
+#include <string.h>
+
+#define HOST_PRESSES 50
+
+static const uint8_t kReceiverMAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x01};
+
+static int64_t g_lastPedalFrameMicros = -1;
+static bool g_lastPedalFramePressed = false;
+
+static bool hostSendHook(void* context, HalHostNode* sender, const uint8_t* dstMAC, const uint8_t* data, int len) {
+  (void)context;
+  (void)sender;
+  (void)dstMAC;
+  // Time the first copy of each burst
+  if (len >= (int)sizeof(pedal_snapshot_message) && data[0] == MSG_PEDAL_SNAPSHOT && g_lastPedalFrameMicros < 0) {
+    g_lastPedalFrameMicros = halClock_micros();
+    g_lastPedalFramePressed = ((const pedal_snapshot_message*)data)->pedalMask & 0x01;
+  }
+  return true;
+}
+
+static void hostDeliverFromReceiver(const void* frame, int len) {
+  halHost_deliver(halHost_currentNode(), kReceiverMAC, (const uint8_t*)frame, len, 1);
+}
+
+// Runs loop() until a pedal frame goes out; returns the latency in microseconds
+// Moves the switch: NC opens as NO closes, and the other way round
+static void hostSetPedal(bool pressed) {
+#ifdef HOST_PEDAL_NC_PIN
+  if (pressed) halHost_setPin(HOST_PEDAL_NC_PIN, HAL_GPIO_HIGH);
+#endif
+  halHost_setPin(HOST_PEDAL_PIN, pressed ? HAL_GPIO_LOW : HAL_GPIO_HIGH);
+#ifdef HOST_PEDAL_NC_PIN
+  if (!pressed) halHost_setPin(HOST_PEDAL_NC_PIN, HAL_GPIO_LOW);
+#endif
+}
+
+static int64_t hostStepUntilPedalFrame(int64_t changeMicros) {
+  g_lastPedalFrameMicros = -1;
+  for (int i = 0; i < 100 && g_lastPedalFrameMicros < 0; i++) {
+    loop();
+  }
+  return g_lastPedalFrameMicros < 0 ? -1 : g_lastPedalFrameMicros - changeMicros;
+}
+
+int main() {
+  halHost_setLogEnabled(false);
+  halHost_setSendHook(hostSendHook, nullptr);
+#ifdef HOST_PEDAL_NC_PIN
+  halHost_setPin(HOST_PEDAL_NC_PIN, HAL_GPIO_LOW);  // Pedal connected, at rest
+#endif
+  setup();
+  
+  // A tap before pairing is queued, then replayed in order once paired
+  hostSetPedal(true);
+  for (int i = 0; i < 3; i++) loop();
+  hostSetPedal(false);
+  for (int i = 0; i < 3; i++) loop();
+  
+  // Receiver beacon, then a MSG_ALIVE from it pairs the transmitter immediately
+  beacon_message beacon;
+  beacon.msgType = MSG_BEACON;
+  memcpy(beacon.receiverMAC, kReceiverMAC, 6);
+  beacon.availableSlots = 2;
+  beacon.totalSlots = 2;
+  beacon.protocolVersion = PROTOCOL_VERSION;
+  beacon.capabilities = PROTOCOL_CAPABILITIES;
+  hostDeliverFromReceiver(&beacon, sizeof(beacon));
+  
+  handshake_message alive = {MSG_ALIVE, 0, false, 0, 0, PROTOCOL_VERSION, PROTOCOL_CAPABILITIES};
+  hostDeliverFromReceiver(&alive, sizeof(alive));
+  
+  if (!pairingState_isPaired(&pairingState) || pairingState.linkCapabilities != PROTOCOL_CAPABILITIES) {
+    fprintf(stderr, "transmitter_host: failed to pair with every capability\n");
+    return 1;
+  }
+  
+  bool replayedPress = hostStepUntilPedalFrame(0) >= 0 && g_lastPedalFramePressed;
+  bool replayedRelease = hostStepUntilPedalFrame(0) >= 0 && !g_lastPedalFramePressed;
+  if (!replayedPress || !replayedRelease) {
+    fprintf(stderr, "transmitter_host: tap made before pairing not replayed\n");
+    return 1;
+  }
+  halHost_advanceMicros(50000);
+  
+  int64_t worstPress = 0, worstRelease = 0, totalPress = 0, totalRelease = 0;
+  for (int i = 0; i < HOST_PRESSES; i++) {
+    // When polling, the edge happened somewhere during the previous loop() sleep;
+    // vary the phase. With interrupt capture the edge wakes loop() right away.
+    int64_t phase = PEDAL_INTERRUPT_CAPTURE ? 0 : (i * 1337) % (IDLE_DELAY_PAIRED * 1000);
+    
+    hostSetPedal(true);
+    int64_t press = hostStepUntilPedalFrame(halClock_micros() - phase);
+    if (press < 0 || !g_lastPedalFramePressed) {
+      fprintf(stderr, "transmitter_host: press %d not sent\n", i);
+      return 1;
+    }
+    
+    halHost_advanceMicros(30000);
+    hostSetPedal(false);
+    int64_t release = hostStepUntilPedalFrame(halClock_micros() - phase);
+    if (release < 0 || g_lastPedalFramePressed) {
+      fprintf(stderr, "transmitter_host: release %d not sent\n", i);
+      return 1;
+    }
+    
+    halHost_advanceMicros(50000);  // Foot off the pedal before the next step
+    
+    totalPress += press;
+    totalRelease += release;
+    if (press > worstPress) worstPress = press;
+    if (release > worstRelease) worstRelease = release;
+  }
+  
+  printf("transmitter_host: press->send avg %.2f ms (worst %.2f ms), release->send avg %.2f ms (worst %.2f ms)\n",
+         totalPress / 1000.0 / HOST_PRESSES, worstPress / 1000.0,
+         totalRelease / 1000.0 / HOST_PRESSES, worstRelease / 1000.0);
+#ifdef HOST_EXTRA_CHECK
+  if (!HOST_EXTRA_CHECK()) return 1;
+#endif
+  return 0;
+}
+
+#endif // TRANSMITTER_HOST_MAIN_H
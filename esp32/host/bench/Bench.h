@@ -0,0 +1,160 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Minimal microbenchmark harness for the host builds.
+// Each benchmark runs a batch of calls several times and keeps the fastest
+// batch (least disturbed by the OS). Results are compared against a baseline
+// file of "name ns_per_call cycles_per_call" lines; a result slower than
+// baseline * (1 + tolerance) fails the run. --update rewrites the baseline.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_MAX_RESULTS 32
+#define BENCH_REPETITIONS 7
+#define BENCH_DEFAULT_TOLERANCE 0.5
+
+typedef void (*BenchFunction)(void* context);
+
+typedef struct {
+  char name[48];
+  double nsPerCall;
+  double cyclesPerCall;
+} BenchResult;
+
+typedef struct {
+  BenchResult results[BENCH_MAX_RESULTS];
+  int count;
+} BenchSuite;
+
+static inline int64_t bench_nowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline uint64_t bench_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;  // No portable cycle counter - cycles column reads 0
+#endif
+}
+
+static void bench_run(BenchSuite* suite, const char* name, BenchFunction fn, void* context, int iterations) {
+  if (suite->count >= BENCH_MAX_RESULTS) return;
+  
+  double bestNs = 0;
+  double bestCycles = 0;
+  for (int rep = 0; rep < BENCH_REPETITIONS; rep++) {
+    int64_t startNs = bench_nowNanos();
+    uint64_t startCycles = bench_cycles();
+    for (int i = 0; i < iterations; i++) {
+      fn(context);
+    }
+    uint64_t cycles = bench_cycles() - startCycles;
+    int64_t ns = bench_nowNanos() - startNs;
+    
+    double nsPerCall = (double)ns / iterations;
+    if (rep == 0 || nsPerCall < bestNs) {
+      bestNs = nsPerCall;
+      bestCycles = (double)cycles / iterations;
+    }
+  }
+  
+  BenchResult* result = &suite->results[suite->count++];
+  snprintf(result->name, sizeof(result->name), "%s", name);
+  result->nsPerCall = bestNs;
+  result->cyclesPerCall = bestCycles;
+}
+
+static bool bench_findBaseline(const char* path, const char* name, double* nsPerCall) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+  
+  char line[128];
+  bool found = false;
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    
+    char entryName[48];
+    double ns, cycles;
+    if (sscanf(line, "%47s %lf %lf", entryName, &ns, &cycles) == 3 && strcmp(entryName, name) == 0) {
+      *nsPerCall = ns;
+      found = true;
+      break;
+    }
+  }
+  fclose(file);
+  return found;
+}
+
+static bool bench_writeBaselines(const BenchSuite* suite, const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  
+  fprintf(file, "# name ns_per_call cycles_per_call (regenerate with --update)\n");
+  for (int i = 0; i < suite->count; i++) {
+    const BenchResult* result = &suite->results[i];
+    fprintf(file, "%s %.2f %.1f\n", result->name, result->nsPerCall, result->cyclesPerCall);
+  }
+  fclose(file);
+  return true;
+}
+
+// Parses --update, --tolerance=X and --baseline=PATH, reports, returns the exit code
+static int bench_finish(const BenchSuite* suite, int argc, char** argv, const char* defaultBaselinePath) {
+  const char* baselinePath = defaultBaselinePath;
+  double tolerance = BENCH_DEFAULT_TOLERANCE;
+  bool update = false;
+  
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (strncmp(argv[i], "--tolerance=", 12) == 0) {
+      tolerance = atof(argv[i] + 12);
+    } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+      baselinePath = argv[i] + 11;
+    }
+  }
+  
+  int regressions = 0;
+  printf("%-48s %10s %10s %10s\n", "benchmark", "ns/call", "cycles", "baseline");
+  for (int i = 0; i < suite->count; i++) {
+    const BenchResult* result = &suite->results[i];
+    double baseline = 0;
+    bool hasBaseline = bench_findBaseline(baselinePath, result->name, &baseline);
+    bool regressed = !update && hasBaseline && result->nsPerCall > baseline * (1.0 + tolerance);
+    if (regressed) regressions++;
+    
+    if (hasBaseline) {
+      printf("%-48s %10.2f %10.1f %10.2f%s\n", result->name, result->nsPerCall, result->cyclesPerCall,
+             baseline, regressed ? "  REGRESSION" : "");
+    } else {
+      printf("%-48s %10.2f %10.1f %10s\n", result->name, result->nsPerCall, result->cyclesPerCall, "-");
+    }
+  }
+  
+  if (update) {
+    if (!bench_writeBaselines(suite, baselinePath)) {
+      fprintf(stderr, "Failed to write %s\n", baselinePath);
+      return 2;
+    }
+    printf("Baselines written to %s\n", baselinePath);
+    return 0;
+  }
+  
+  if (regressions) {
+    printf("%d benchmark(s) regressed by more than %.0f%%\n", regressions, tolerance * 100);
+    return 1;
+  }
+  return 0;
+}
+
+#endif // BENCH_H
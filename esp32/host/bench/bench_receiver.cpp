@@ -0,0 +1,115 @@
+// Receiver hot-path microbenchmarks: everything a pedal frame touches, from
+// onMessageReceived through the receive ring and HID task down to the HID call.
+//   g++ -std=c++17 -O2 -DHAL_HOST -o bench_receiver esp32/host/bench/bench_receiver.cpp
+//   ./bench_receiver [--update] [--tolerance=0.5] [--baseline=PATH]
+
+#include "../../shared/hal/host/HalHost.cpp"
+#include "../../receiver/receiver.ino"
+#include "Bench.h"
+
+#define BENCH_BASELINE_PATH "esp32/host/bench/baselines/receiver.txt"
+
+static const uint8_t kPedalMAC[2][6] = {
+  {0x02, 0x00, 0x00, 0x00, 0x10, 0x01},
+  {0x02, 0x00, 0x00, 0x00, 0x10, 0x02},
+};
+static const uint8_t kUnknownMAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0xFF};
+static const uint8_t kMonitorMAC[6] = {0x02, 0x00, 0x00, 0x00, 0x30, 0x01};
+
+static volatile int g_sink;
+static struct_message g_pedalFrame = {MSG_PEDAL_EVENT, '1', true, 1, 0};
+static pedal_snapshot_message g_snapshotFrame = {MSG_PEDAL_SNAPSHOT, 0, 1, 0};
+
+static void bench_findIndexFirst(void* context) {
+  (void)context;
+  g_sink = transmitterManager_findIndex(&transmitterManager, kPedalMAC[0]);
+}
+
+static void bench_findIndexLast(void* context) {
+  (void)context;
+  g_sink = transmitterManager_findIndex(&transmitterManager, kPedalMAC[1]);
+}
+
+static void bench_findIndexMiss(void* context) {
+  (void)context;
+  g_sink = transmitterManager_findIndex(&transmitterManager, kUnknownMAC);
+}
+
+static void bench_onMessageReceivedPedal(void* context) {
+  (void)context;
+  g_pedalFrame.pressed = !g_pedalFrame.pressed;
+  onMessageReceived(kPedalMAC[1], (const uint8_t*)&g_pedalFrame, sizeof(g_pedalFrame), 1);
+}
+
+static void bench_onMessageReceivedSnapshot(void* context) {
+  (void)context;
+  g_snapshotFrame.pedalMask ^= 0x01;
+  g_snapshotFrame.seq = g_snapshotFrame.seq == 255 ? 1 : g_snapshotFrame.seq + 1;
+  onMessageReceived(kPedalMAC[1], (const uint8_t*)&g_snapshotFrame, sizeof(g_snapshotFrame), 1);
+}
+
+static void bench_onMessageReceivedAlive(void* context) {
+  (void)context;
+  struct_message alive = {MSG_ALIVE, 0, false, 0, 0};
+  onMessageReceived(kPedalMAC[1], (const uint8_t*)&alive, sizeof(alive), 1);
+}
+
+// The hand-off alone: what the WiFi task now pays per frame, plus the HID task's pickup
+static void bench_receiveRingPushPop(void* context) {
+  (void)context;
+  receiveRing_push(&receiveRing, kPedalMAC[1], (const uint8_t*)&g_pedalFrame, sizeof(g_pedalFrame), 1);
+  g_sink = receiveRing_peek(&receiveRing)->len;
+  receiveRing_pop(&receiveRing);
+}
+
+static int g_pedalIndex = -1;
+
+static void bench_handlePedalEvent(void* context) {
+  (void)context;
+  g_pedalFrame.pressed = !g_pedalFrame.pressed;
+  keyboardService_handlePedalEvent(&keyboardService, g_pedalIndex, &g_pedalFrame, sizeof(g_pedalFrame));
+}
+
+static void bench_debugMonitorPrint(void* context) {
+  (void)context;
+  debugMonitor_print(&debugMonitor, "Pedal event: transmitter %d, key '%c' %s", 1, 'r', "PRESSED");
+  debugMonitor_flush(&debugMonitor);
+}
+
+// The pedal frame, then loop() sending its debug line
+static void bench_onMessageReceivedPedalMonitor(void* context) {
+  bench_onMessageReceivedPedal(context);
+  debugMonitor_flush(&debugMonitor);
+}
+
+static void bench_persistenceSave(void* context) {
+  (void)context;
+  persistence_save(&transmitterManager);
+}
+
+int main(int argc, char** argv) {
+  halHost_setLogEnabled(false);
+  setup();
+  
+  transmitterManager_add(&transmitterManager, kPedalMAC[0], 1);
+  g_pedalIndex = transmitterManager_add(&transmitterManager, kPedalMAC[1], 1);
+  
+  BenchSuite suite = {};
+  bench_run(&suite, "transmitterManager_findIndex/first", bench_findIndexFirst, nullptr, 1000000);
+  bench_run(&suite, "transmitterManager_findIndex/last", bench_findIndexLast, nullptr, 1000000);
+  bench_run(&suite, "transmitterManager_findIndex/miss", bench_findIndexMiss, nullptr, 1000000);
+  bench_run(&suite, "keyboardService_handlePedalEvent", bench_handlePedalEvent, nullptr, 1000000);
+  bench_run(&suite, "receiveRing_push+pop", bench_receiveRingPushPop, nullptr, 1000000);
+  bench_run(&suite, "onMessageReceived/alive", bench_onMessageReceivedAlive, nullptr, 1000000);
+  bench_run(&suite, "onMessageReceived/pedal", bench_onMessageReceivedPedal, nullptr, 1000000);
+  bench_run(&suite, "onMessageReceived/snapshot", bench_onMessageReceivedSnapshot, nullptr, 1000000);
+  
+  // With a paired debug monitor every pedal frame also formats and sends a debug line
+  debugMonitor_handleDiscoveryRequest(&debugMonitor, kMonitorMAC, 1);
+  bench_run(&suite, "debugMonitor_print", bench_debugMonitorPrint, nullptr, 200000);
+  bench_run(&suite, "onMessageReceived/pedal+monitor", bench_onMessageReceivedPedalMonitor, nullptr, 200000);
+  
+  bench_run(&suite, "persistence_save", bench_persistenceSave, nullptr, 20000);
+  
+  return bench_finish(&suite, argc, argv, BENCH_BASELINE_PATH);
+}
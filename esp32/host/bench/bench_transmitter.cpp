@@ -0,0 +1,125 @@
+// Transmitter hot-path microbenchmarks: the pedal scan that runs every loop().
+//   g++ -std=c++17 -O2 -DHAL_HOST -o bench_transmitter esp32/host/bench/bench_transmitter.cpp
+//   ./bench_transmitter [--update] [--tolerance=0.5] [--baseline=PATH]
+
+#include "../../shared/hal/host/HalHost.cpp"
+#include "../../panicpedal-pro/panicpedal-pro.ino"
+#include "../../shared/PedalBank.h"
+#include "Bench.h"
+
+#define BENCH_BASELINE_PATH "esp32/host/bench/baselines/transmitter.txt"
+
+static volatile bool g_sink;
+static volatile uint64_t g_changedSink;
+static PedalReader g_reader;
+static PedalReader g_irqReader;
+static PedalReader g_eagerReader;
+static PedalReader g_latchReader;
+
+static void bench_checkPedalIdle(void* context) {
+  (void)context;
+  g_sink = pedalReader_checkPedal(&g_reader, PEDAL_LEFT_NO_PIN, &g_reader.pedal1State);
+}
+
+// One full press/release cycle: edge, debounce wait, confirm, release
+static void bench_checkPedalCycle(void* context) {
+  (void)context;
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_LOW);
+  g_sink = pedalReader_checkPedal(&g_reader, PEDAL_LEFT_NO_PIN, &g_reader.pedal1State);
+  halHost_advanceMillis(DEBOUNCE_DELAY);
+  g_sink = pedalReader_checkPedal(&g_reader, PEDAL_LEFT_NO_PIN, &g_reader.pedal1State);
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_HIGH);
+  g_sink = pedalReader_checkPedal(&g_reader, PEDAL_LEFT_NO_PIN, &g_reader.pedal1State);
+}
+
+// Eager policy: press on the first edge, release once the lockout has passed
+static void bench_checkPedalEagerCycle(void* context) {
+  (void)context;
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_LOW);
+  g_sink = pedalReader_checkPedal(&g_eagerReader, PEDAL_LEFT_NO_PIN, &g_eagerReader.pedal1State);
+  halHost_advanceMillis(DEBOUNCE_LOCKOUT);
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_HIGH);
+  g_sink = pedalReader_checkPedal(&g_eagerReader, PEDAL_LEFT_NO_PIN, &g_eagerReader.pedal1State);
+  halHost_advanceMillis(DEBOUNCE_LOCKOUT);
+}
+
+// NO/NC latch: NC opens and NO closes, then NO opens and NC closes
+static void bench_checkPedalLatchCycle(void* context) {
+  (void)context;
+  halHost_setPin(PEDAL_RIGHT_NC_PIN, HAL_GPIO_HIGH);
+  halHost_setPin(PEDAL_RIGHT_NO_PIN, HAL_GPIO_LOW);
+  g_sink = pedalReader_checkPedal(&g_latchReader, PEDAL_RIGHT_NO_PIN, &g_latchReader.pedal2State);
+  halHost_setPin(PEDAL_RIGHT_NO_PIN, HAL_GPIO_HIGH);
+  halHost_setPin(PEDAL_RIGHT_NC_PIN, HAL_GPIO_LOW);
+  g_sink = pedalReader_checkPedal(&g_latchReader, PEDAL_RIGHT_NO_PIN, &g_latchReader.pedal2State);
+}
+
+static void bench_pedalReaderUpdateIdle(void* context) {
+  (void)context;
+  pedalReader_update(&g_reader, nullptr, nullptr);
+}
+
+// Same cycle with interrupt capture: the edge handler fills the buffer, update drains it
+static void bench_pedalReaderUpdateInterruptCycle(void* context) {
+  (void)context;
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_LOW);
+  pedalReader_update(&g_irqReader, nullptr, nullptr);
+  halHost_advanceMillis(DEBOUNCE_DELAY);
+  pedalReader_update(&g_irqReader, nullptr, nullptr);
+  halHost_setPin(PEDAL_LEFT_NO_PIN, HAL_GPIO_HIGH);
+  pedalReader_update(&g_irqReader, nullptr, nullptr);
+}
+
+// Vertical-counter scan of 1, 4 and 16 pins (the 16 span both GPIO banks)
+static PedalBank<10> g_bank1;
+static PedalBank<10, 11, 12, 13> g_bank4;
+static PedalBank<10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 38, 39, 40, 41> g_bank16;
+
+static void bench_pedalBankScan1(void* context) {
+  (void)context;
+  g_changedSink = pedalBank_scan(&g_bank1);
+}
+
+static void bench_pedalBankScan4(void* context) {
+  (void)context;
+  g_changedSink = pedalBank_scan(&g_bank4);
+}
+
+static void bench_pedalBankScan16(void* context) {
+  (void)context;
+  g_changedSink = pedalBank_scan(&g_bank16);
+}
+
+int main(int argc, char** argv) {
+  halHost_setLogEnabled(false);
+  pedalReader_init(&g_reader, PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN, PEDAL_MODE_DUAL);
+  
+  BenchSuite suite = {};
+  bench_run(&suite, "pedalReader_checkPedal/idle", bench_checkPedalIdle, nullptr, 1000000);
+  bench_run(&suite, "pedalReader_checkPedal/press_release", bench_checkPedalCycle, nullptr, 1000000);
+  
+  pedalReader_init(&g_eagerReader, PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN, PEDAL_MODE_DUAL);
+  pedalReader_setDebouncePolicy(&g_eagerReader, 0, DEBOUNCE_POLICY_EAGER, DEBOUNCE_LOCKOUT);
+  bench_run(&suite, "pedalReader_checkPedal/eager_press_release", bench_checkPedalEagerCycle, nullptr, 1000000);
+  
+  halHost_setPin(PEDAL_RIGHT_NC_PIN, HAL_GPIO_LOW);
+  pedalReader_init(&g_latchReader, PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN, PEDAL_MODE_DUAL);
+  pedalLatch_enable(&g_latchReader, 1, PEDAL_RIGHT_NC_PIN);
+  bench_run(&suite, "pedalReader_checkPedal/latch_press_release", bench_checkPedalLatchCycle, nullptr, 1000000);
+  
+  bench_run(&suite, "pedalReader_update/idle_dual", bench_pedalReaderUpdateIdle, nullptr, 1000000);
+  
+  pedalReader_init(&g_irqReader, PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN, PEDAL_MODE_DUAL);
+  pedalReader_enableInterruptCapture(&g_irqReader);
+  bench_run(&suite, "pedalReader_update/interrupt_press_release", bench_pedalReaderUpdateInterruptCycle, nullptr, 1000000);
+  
+  
+  pedalBank_init(&g_bank1);
+  pedalBank_init(&g_bank4);
+  pedalBank_init(&g_bank16);
+  bench_run(&suite, "pedalBank_scan/1_pedal", bench_pedalBankScan1, nullptr, 1000000);
+  bench_run(&suite, "pedalBank_scan/4_pedals", bench_pedalBankScan4, nullptr, 1000000);
+  bench_run(&suite, "pedalBank_scan/16_pedals", bench_pedalBankScan16, nullptr, 1000000);
+  
+  return bench_finish(&suite, argc, argv, BENCH_BASELINE_PATH);
+}
@@ -0,0 +1,669 @@
+// Debounce evaluation: replays contact-bounce waveforms into PedalReader (every
+// debounce policy) and PedalBank, and scores each against the intended presses.
+//
+//   g++ -std=c++17 -O2 -DHAL_HOST -o debounce_eval esp32/host/debounce/debounce_eval.cpp
+//   ./debounce_eval [--verbose] [--update] [--corpus=DIR] [--expected=PATH]
+//   ./debounce_eval --generate=DIR [--seed=N]
+//
+// Waveform files (corpus/*.txt) are timestamped edge lists:
+//   # comment
+//   press <us>          intended press starts (first NO contact closure)
+//   release <us>        intended release starts (first NO contact opening)
+//   <us> NO|NC <0|1>    contact edge, 0=closed (LOW), 1=open (HIGH)
+//   end <us>            end of recording
+// The NO contact starts open; the NC contact starts closed if the file has any
+// NC edge, otherwise it is treated as unwired.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include "../../shared/hal/host/HalHost.cpp"
+#include "../../shared/PedalReader.cpp"
+#include "../../panicpedal-pro/domain/PedalLatch.cpp"
+#include "../../shared/PedalBank.h"
+
+#define EVAL_CORPUS_PATH "esp32/host/debounce/corpus"
+#define EVAL_EXPECTED_PATH "esp32/host/debounce/expected.txt"
+
+#define EVAL_MAX_WAVEFORMS 16
+#define EVAL_MAX_EDGES 8192
+#define EVAL_MAX_TRUTH 256
+#define EVAL_MAX_EVENTS 4096
+#define EVAL_NO_PIN 1
+#define EVAL_NC_PIN 35
+#define EVAL_LOOP_MS 20          // IDLE_DELAY_PAIRED in the sketches
+#define EVAL_LOOP_BODY_US 50     // Time one loop() pass takes when it does not idle
+#define EVAL_TAIL_US 200000      // Keep running after the last edge
+#define EVAL_CPU_REPEATS 20
+
+typedef struct {
+  int64_t timeMicros;
+  uint8_t pin;
+  bool level;
+} EvalEdge;
+
+typedef struct {
+  int64_t pressMicros;
+  int64_t releaseMicros;
+} EvalTruth;
+
+typedef struct {
+  char name[64];
+  bool hasNC;
+  EvalEdge edges[EVAL_MAX_EDGES];
+  int edgeCount;
+  EvalTruth truth[EVAL_MAX_TRUTH];
+  int truthCount;
+  int64_t endMicros;
+} Waveform;
+
+typedef enum {
+  EVAL_ENGINE_READER = 0,  // PedalReader, as the sketches run it
+  EVAL_ENGINE_BANK         // PedalBank vertical counter at a fixed scan period
+} EvalEngine;
+
+typedef struct {
+  const char* name;
+  EvalEngine engine;
+  uint8_t policy;
+  uint16_t lockoutMs;
+  bool interruptCapture;
+  uint16_t periodMs;  // Loop idle (reader) or scan period (bank)
+  bool needsNC;
+  bool shipped;  // A board default or profile: any false press or stuck key fails the run
+} EvalPolicy;
+
+static const EvalPolicy kPolicies[] = {
+  {"deferred/poll20", EVAL_ENGINE_READER, DEBOUNCE_POLICY_DEFERRED, 0, false, EVAL_LOOP_MS, false, false},
+  {"deferred", EVAL_ENGINE_READER, DEBOUNCE_POLICY_DEFERRED, 0, true, EVAL_LOOP_MS, false, true},
+  {"eager/10", EVAL_ENGINE_READER, DEBOUNCE_POLICY_EAGER, 10, true, EVAL_LOOP_MS, false, false},
+  {"eager/15", EVAL_ENGINE_READER, DEBOUNCE_POLICY_EAGER, 15, true, EVAL_LOOP_MS, false, true},  // Performance profile
+  {"eager/20", EVAL_ENGINE_READER, DEBOUNCE_POLICY_EAGER, 20, true, EVAL_LOOP_MS, false, false},
+  {"eager/30", EVAL_ENGINE_READER, DEBOUNCE_POLICY_EAGER, 30, true, EVAL_LOOP_MS, false, true},   // DEBOUNCE_LOCKOUT
+  {"eager/50", EVAL_ENGINE_READER, DEBOUNCE_POLICY_EAGER, 50, true, EVAL_LOOP_MS, false, false},
+  {"latch", EVAL_ENGINE_READER, DEBOUNCE_POLICY_LATCH, 0, true, EVAL_LOOP_MS, true, true},
+  {"bank/1ms", EVAL_ENGINE_BANK, 0, 0, false, 1, false, false},
+  {"bank/5ms", EVAL_ENGINE_BANK, 0, 0, false, 5, false, false},
+};
+#define EVAL_POLICY_COUNT (int)(sizeof(kPolicies) / sizeof(kPolicies[0]))
+
+typedef struct {
+  int64_t timeMicros;
+  bool pressed;
+} EvalEvent;
+
+typedef struct {
+  int64_t pressLatencies[EVAL_MAX_TRUTH * EVAL_MAX_WAVEFORMS];
+  int pressCount;
+  int64_t releaseLatencies[EVAL_MAX_TRUTH * EVAL_MAX_WAVEFORMS];
+  int releaseCount;
+  int falsePresses;
+  int missedPresses;
+  int missedReleases;
+  double nsPerUpdate;
+  int waveforms;
+} EvalScore;
+
+static Waveform g_waveforms[EVAL_MAX_WAVEFORMS];
+static int g_waveformCount = 0;
+static EvalEvent g_events[EVAL_MAX_EVENTS];
+static int g_eventCount = 0;
+static HalHostNode g_node;
+
+// ----------------------------------------------------------------------------
+// Corpus loading
+// ----------------------------------------------------------------------------
+
+static int eval_compareEdges(const void* a, const void* b) {
+  const EvalEdge* x = (const EvalEdge*)a;
+  const EvalEdge* y = (const EvalEdge*)b;
+  return (x->timeMicros > y->timeMicros) - (x->timeMicros < y->timeMicros);
+}
+
+static bool eval_loadWaveform(const char* path, const char* name, Waveform* waveform) {
+  FILE* file = fopen(path, "r");
+  if (!file) return false;
+
+  memset(waveform, 0, sizeof(Waveform));
+  snprintf(waveform->name, sizeof(waveform->name), "%.*s", (int)(strlen(name) - 4), name);
+
+  char line[128];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNumber++;
+    if (line[0] == '#' || line[0] == '\n') continue;
+
+    long long time;
+    char contact[8];
+    int level;
+    if (sscanf(line, "press %lld", &time) == 1) {
+      if (waveform->truthCount >= EVAL_MAX_TRUTH) ok = false;
+      else waveform->truth[waveform->truthCount++] = {time, -1};
+    } else if (sscanf(line, "release %lld", &time) == 1) {
+      if (waveform->truthCount == 0) ok = false;
+      else waveform->truth[waveform->truthCount - 1].releaseMicros = time;
+    } else if (sscanf(line, "end %lld", &time) == 1) {
+      waveform->endMicros = time;
+    } else if (sscanf(line, "%lld %7s %d", &time, contact, &level) == 3) {
+      bool nc = strcmp(contact, "NC") == 0;
+      if (waveform->edgeCount >= EVAL_MAX_EDGES || (!nc && strcmp(contact, "NO") != 0)) {
+        ok = false;
+      } else {
+        waveform->edges[waveform->edgeCount++] = {time, (uint8_t)(nc ? EVAL_NC_PIN : EVAL_NO_PIN), level != 0};
+        waveform->hasNC |= nc;
+      }
+    } else {
+      ok = false;
+    }
+  }
+  fclose(file);
+
+  if (!ok) {
+    fprintf(stderr, "%s:%d: bad line\n", path, lineNumber);
+    return false;
+  }
+  qsort(waveform->edges, waveform->edgeCount, sizeof(EvalEdge), eval_compareEdges);
+  if (waveform->edgeCount > 0 && waveform->endMicros < waveform->edges[waveform->edgeCount - 1].timeMicros) {
+    waveform->endMicros = waveform->edges[waveform->edgeCount - 1].timeMicros;
+  }
+  waveform->endMicros += EVAL_TAIL_US;
+  return true;
+}
+
+static int eval_compareNames(const void* a, const void* b) {
+  return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static bool eval_loadCorpus(const char* dirPath) {
+  DIR* dir = opendir(dirPath);
+  if (!dir) {
+    fprintf(stderr, "Cannot open corpus %s\n", dirPath);
+    return false;
+  }
+
+  static char names[EVAL_MAX_WAVEFORMS][64];
+  const char* sorted[EVAL_MAX_WAVEFORMS];
+  int count = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    size_t len = strlen(entry->d_name);
+    if (len < 5 || len >= sizeof(names[0]) || strcmp(entry->d_name + len - 4, ".txt") != 0) continue;
+    if (count >= EVAL_MAX_WAVEFORMS) break;
+    snprintf(names[count], sizeof(names[count]), "%s", entry->d_name);
+    sorted[count] = names[count];
+    count++;
+  }
+  closedir(dir);
+  qsort(sorted, count, sizeof(sorted[0]), eval_compareNames);
+
+  for (int i = 0; i < count; i++) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dirPath, sorted[i]);
+    if (!eval_loadWaveform(path, sorted[i], &g_waveforms[g_waveformCount])) return false;
+    g_waveformCount++;
+  }
+  return g_waveformCount > 0;
+}
+
+// ----------------------------------------------------------------------------
+// Replay
+// ----------------------------------------------------------------------------
+
+static void eval_record(bool pressed) {
+  if (g_eventCount < EVAL_MAX_EVENTS) {
+    g_events[g_eventCount++] = {halClock_micros(), pressed};
+  }
+}
+
+static void eval_onPress(char key) {
+  (void)key;
+  eval_record(true);
+}
+
+static void eval_onRelease(char key) {
+  (void)key;
+  eval_record(false);
+}
+
+static void eval_startNode(const Waveform* waveform) {
+  static const uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x30, 0x01};
+  halHost_initNode(&g_node, mac);
+  halHost_selectNode(&g_node);
+  halHost_setMicros(0);
+  if (waveform->hasNC) halHost_setPin(EVAL_NC_PIN, HAL_GPIO_LOW);  // At rest
+  g_eventCount = 0;
+}
+
+// Mirrors the sketches' loop(): update, then idle until the next deadline or edge
+static int eval_replayReader(const Waveform* waveform, const EvalPolicy* policy) {
+  eval_startNode(waveform);
+
+  PedalReader reader;
+  pedalReader_init(&reader, EVAL_NO_PIN, EVAL_NO_PIN + 1, 1);
+  pedalReader_setDebouncePolicy(&reader, 0, policy->policy, policy->lockoutMs);
+  if (policy->policy == DEBOUNCE_POLICY_LATCH) pedalLatch_enable(&reader, 0, EVAL_NC_PIN);
+  if (policy->interruptCapture) pedalReader_enableInterruptCapture(&reader);
+
+  int updates = 0;
+  int edge = 0;
+  int64_t wake = 0;
+  while (true) {
+    int64_t nextEdge = edge < waveform->edgeCount ? waveform->edges[edge].timeMicros : INT64_MAX;
+    if (wake <= nextEdge) {
+      if (wake > waveform->endMicros) break;
+      halHost_setMicros(wake);
+      pedalReader_update(&reader, eval_onPress, eval_onRelease);
+      updates++;
+      unsigned long idleMs = pedalReader_idleTimeout(&reader, policy->periodMs);
+      wake += idleMs > 0 ? (int64_t)idleMs * 1000 : EVAL_LOOP_BODY_US;
+    } else {
+      halHost_setMicros(nextEdge);
+      halHost_setPin(waveform->edges[edge].pin, waveform->edges[edge].level);
+      edge++;
+      if (g_node.wakePending) {  // The ISR ends halClock_idle early
+        g_node.wakePending = false;
+        wake = nextEdge;
+      }
+    }
+  }
+  return updates;
+}
+
+static int eval_replayBank(const Waveform* waveform, const EvalPolicy* policy) {
+  eval_startNode(waveform);
+
+  PedalBank<EVAL_NO_PIN> bank;
+  pedalBank_init(&bank);
+
+  int updates = 0;
+  int edge = 0;
+  for (int64_t scan = 0; scan <= waveform->endMicros; scan += (int64_t)policy->periodMs * 1000) {
+    while (edge < waveform->edgeCount && waveform->edges[edge].timeMicros <= scan) {
+      halHost_setMicros(waveform->edges[edge].timeMicros);
+      halHost_setPin(waveform->edges[edge].pin, waveform->edges[edge].level);
+      edge++;
+    }
+    halHost_setMicros(scan);
+    pedalBank_update(&bank, eval_onPress, eval_onRelease);
+    updates++;
+  }
+  return updates;
+}
+
+static int eval_replay(const Waveform* waveform, const EvalPolicy* policy) {
+  return policy->engine == EVAL_ENGINE_BANK ? eval_replayBank(waveform, policy)
+                                            : eval_replayReader(waveform, policy);
+}
+
+// ----------------------------------------------------------------------------
+// Scoring
+// ----------------------------------------------------------------------------
+
+typedef struct {
+  int falsePresses;
+  int missedPresses;
+  int missedReleases;
+  int64_t maxPressLatency;
+  int64_t maxReleaseLatency;
+} EvalWaveformScore;
+
+// Each intended press owns the window up to the next one. Its first reported
+// press gives the latency; further presses in the window are false presses;
+// a window that does not end released is a missed release. A release reported
+// before the intended one (a dropout while held) shows up as a false press.
+static EvalWaveformScore eval_score(const Waveform* waveform, EvalScore* total) {
+  EvalWaveformScore score = {0, 0, 0, 0, 0};
+  int event = 0;
+
+  for (; event < g_eventCount && (waveform->truthCount == 0 || g_events[event].timeMicros < waveform->truth[0].pressMicros); event++) {
+    if (g_events[event].pressed) score.falsePresses++;
+  }
+
+  for (int i = 0; i < waveform->truthCount; i++) {
+    const EvalTruth* truth = &waveform->truth[i];
+    int64_t windowEnd = i + 1 < waveform->truthCount ? waveform->truth[i + 1].pressMicros : INT64_MAX;
+    int presses = 0;
+    bool lastPressed = false;
+    int64_t firstPress = -1, firstRelease = -1;
+
+    for (; event < g_eventCount && g_events[event].timeMicros < windowEnd; event++) {
+      const EvalEvent* e = &g_events[event];
+      if (e->pressed) {
+        presses++;
+        if (firstPress < 0) firstPress = e->timeMicros;
+      } else if (firstRelease < 0 && truth->releaseMicros >= 0 && e->timeMicros >= truth->releaseMicros) {
+        firstRelease = e->timeMicros;
+      }
+      lastPressed = e->pressed;
+    }
+
+    if (presses == 0) {
+      score.missedPresses++;
+    } else {
+      score.falsePresses += presses - 1;
+      int64_t latency = firstPress - truth->pressMicros;
+      total->pressLatencies[total->pressCount++] = latency;
+      if (latency > score.maxPressLatency) score.maxPressLatency = latency;
+      if (lastPressed) score.missedReleases++;
+    }
+    if (firstRelease >= 0) {
+      int64_t latency = firstRelease - truth->releaseMicros;
+      total->releaseLatencies[total->releaseCount++] = latency;
+      if (latency > score.maxReleaseLatency) score.maxReleaseLatency = latency;
+    }
+  }
+
+  total->falsePresses += score.falsePresses;
+  total->missedPresses += score.missedPresses;
+  total->missedReleases += score.missedReleases;
+  return score;
+}
+
+static double eval_nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int eval_compareInt64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static double eval_percentileMs(int64_t* samples, int count, int percent) {
+  if (count == 0) return 0;
+  qsort(samples, count, sizeof(int64_t), eval_compareInt64);
+  return samples[(count - 1) * percent / 100] / 1000.0;
+}
+
+// ----------------------------------------------------------------------------
+// Expected results (regression gate)
+// ----------------------------------------------------------------------------
+
+typedef struct {
+  char policy[32];
+  char waveform[64];
+  EvalWaveformScore score;
+} EvalExpected;
+
+static EvalExpected g_results[EVAL_POLICY_COUNT * EVAL_MAX_WAVEFORMS];
+static int g_resultCount = 0;
+
+static int eval_checkExpected(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    printf("No expected results at %s (run with --update to create them)\n", path);
+    return 0;
+  }
+
+  int regressions = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#') continue;
+    EvalExpected expected;
+    long long maxPress, maxRelease;
+    if (sscanf(line, "%31s %63s %d %d %d %lld %lld", expected.policy, expected.waveform,
+               &expected.score.falsePresses, &expected.score.missedPresses, &expected.score.missedReleases,
+               &maxPress, &maxRelease) != 7) {
+      continue;
+    }
+    for (int i = 0; i < g_resultCount; i++) {
+      const EvalExpected* actual = &g_results[i];
+      if (strcmp(actual->policy, expected.policy) != 0 || strcmp(actual->waveform, expected.waveform) != 0) continue;
+      if (actual->score.falsePresses > expected.score.falsePresses ||
+          actual->score.missedPresses > expected.score.missedPresses ||
+          actual->score.missedReleases > expected.score.missedReleases ||
+          actual->score.maxPressLatency > maxPress || actual->score.maxReleaseLatency > maxRelease) {
+        printf("REGRESSION %s on %s: false %d (was %d), missed %d (was %d), missed releases %d (was %d), "
+               "max latency %lld/%lld us (was %lld/%lld)\n",
+               actual->policy, actual->waveform, actual->score.falsePresses, expected.score.falsePresses,
+               actual->score.missedPresses, expected.score.missedPresses,
+               actual->score.missedReleases, expected.score.missedReleases,
+               (long long)actual->score.maxPressLatency, (long long)actual->score.maxReleaseLatency,
+               maxPress, maxRelease);
+        regressions++;
+      }
+    }
+  }
+  fclose(file);
+  return regressions;
+}
+
+static bool eval_writeExpected(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  fprintf(file, "# policy waveform false_presses missed_presses missed_releases max_press_us max_release_us "
+                "(regenerate with --update)\n");
+  for (int i = 0; i < g_resultCount; i++) {
+    const EvalExpected* result = &g_results[i];
+    fprintf(file, "%s %s %d %d %d %lld %lld\n", result->policy, result->waveform, result->score.falsePresses,
+            result->score.missedPresses, result->score.missedReleases,
+            (long long)result->score.maxPressLatency, (long long)result->score.maxReleaseLatency);
+  }
+  fclose(file);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Synthetic corpus
+// ----------------------------------------------------------------------------
+
+typedef struct {
+  const char* name;
+  const char* description;
+  bool spdt;               // Writes NC edges too
+  int presses;
+  int64_t holdMinUs, holdMaxUs;
+  int64_t gapMinUs, gapMaxUs;
+  int64_t bounceMaxUs;     // Bounce duration on closing
+  int bounceEdgesMax;      // Extra edge pairs on closing
+  int64_t releaseBounceMaxUs;
+  int64_t travelMinUs, travelMaxUs;  // NC opening -> NO closing (SPDT)
+  int chatterPerHold;      // Brief NO dropouts while held (worn contacts)
+  int glitches;            // Isolated NO spikes with no press (EMI)
+} EvalSwitchModel;
+
+static const EvalSwitchModel kSwitchModels[] = {
+  {"microswitch_clean", "Snap-action microswitch, short bounce", true,
+   24, 80000, 200000, 150000, 400000, 1200, 3, 400, 1500, 3000, 0, 0},
+  {"tactile_cheap", "Low-cost NO-only switch, several ms of bounce", false,
+   24, 80000, 200000, 150000, 400000, 6000, 8, 2000, 0, 0, 0, 0},
+  {"worn_contacts", "Worn SPDT contacts: long bounce and dropouts while held", true,
+   24, 150000, 400000, 150000, 400000, 12000, 12, 5000, 1500, 3000, 2, 0},
+  {"heel_stomp", "Fast stomps: short holds and gaps, hard rebound", true,
+   32, 25000, 60000, 30000, 70000, 8000, 10, 6000, 800, 2000, 0, 0},
+  {"long_hold_chatter", "Holds of 1-2 s with occasional contact chatter", true,
+   8, 1000000, 2000000, 300000, 600000, 3000, 5, 1500, 1500, 3000, 6, 0},
+  {"emi_glitch", "No presses; isolated 5-50 us spikes on the NO line", false,
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 40},
+};
+
+static uint64_t g_generateState = 1;
+
+static int64_t eval_random(int64_t min, int64_t max) {
+  g_generateState ^= g_generateState >> 12;
+  g_generateState ^= g_generateState << 25;
+  g_generateState ^= g_generateState >> 27;
+  uint64_t value = g_generateState * 0x2545F4914F6CDD1DULL;
+  return max <= min ? min : min + (int64_t)(value % (uint64_t)(max - min + 1));
+}
+
+// A contact settling at `level` starting at t, with up to `pairs` rebounds within `window`
+static int64_t eval_writeBounce(FILE* file, const char* contact, int64_t t, bool level, int pairs, int64_t window) {
+  fprintf(file, "%lld %s %d\n", (long long)t, contact, level ? 1 : 0);
+  int count = pairs > 0 ? (int)eval_random(0, pairs) : 0;
+  int64_t end = t + (window > 0 ? eval_random(window / 4, window) : 0);
+  int64_t at = t;
+  for (int i = 0; i < count && at < end; i++) {
+    // Rebounds get shorter as the contact settles
+    int64_t step = (end - at) / (count - i + 1);
+    if (step < 20) break;
+    at += eval_random(step / 2, step);
+    fprintf(file, "%lld %s %d\n", (long long)at, contact, level ? 0 : 1);
+    at += eval_random(10, step / 2 > 10 ? step / 2 : 10);
+    fprintf(file, "%lld %s %d\n", (long long)at, contact, level ? 1 : 0);
+  }
+  return at;
+}
+
+static bool eval_generate(const char* dirPath, uint64_t seed) {
+  for (size_t m = 0; m < sizeof(kSwitchModels) / sizeof(kSwitchModels[0]); m++) {
+    const EvalSwitchModel* model = &kSwitchModels[m];
+    g_generateState = seed * 0x9E3779B97F4A7C15ULL + m + 1;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.txt", dirPath, model->name);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+      fprintf(stderr, "Cannot write %s\n", path);
+      return false;
+    }
+    fprintf(file, "# %s\n# Synthetic (debounce_eval --generate --seed=%llu)\n", model->description,
+            (unsigned long long)seed);
+
+    int64_t t = 100000;
+    for (int i = 0; i < model->presses; i++) {
+      int64_t noClose = t;
+      if (model->spdt) {
+        fprintf(file, "%lld NC 1\n", (long long)(noClose - eval_random(model->travelMinUs, model->travelMaxUs)));
+      }
+      fprintf(file, "press %lld\n", (long long)noClose);
+      eval_writeBounce(file, "NO", noClose, false, model->bounceEdgesMax, model->bounceMaxUs);
+
+      int64_t noOpen = noClose + eval_random(model->holdMinUs, model->holdMaxUs);
+      for (int c = 0; c < model->chatterPerHold; c++) {
+        int64_t at = noClose + model->bounceMaxUs + eval_random(0, noOpen - noClose - 2 * model->bounceMaxUs);
+        fprintf(file, "%lld NO 1\n%lld NO 0\n", (long long)at, (long long)(at + eval_random(50, 300)));
+      }
+
+      fprintf(file, "release %lld\n", (long long)noOpen);
+      int64_t settled = eval_writeBounce(file, "NO", noOpen, true, model->bounceEdgesMax / 3, model->releaseBounceMaxUs);
+      if (model->spdt) {
+        int64_t ncClose = settled + eval_random(model->travelMinUs, model->travelMaxUs);
+        eval_writeBounce(file, "NC", ncClose, false, model->bounceEdgesMax / 2, model->bounceMaxUs / 2);
+      }
+      t = noOpen + eval_random(model->gapMinUs, model->gapMaxUs);
+    }
+
+    for (int i = 0; i < model->glitches; i++) {
+      int64_t at = t + eval_random(50000, 250000);
+      fprintf(file, "%lld NO 0\n%lld NO 1\n", (long long)at, (long long)(at + eval_random(5, 50)));
+      t = at;
+    }
+    fprintf(file, "end %lld\n", (long long)(t + 100000));
+    fclose(file);
+    printf("Wrote %s\n", path);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  const char* corpusPath = EVAL_CORPUS_PATH;
+  const char* expectedPath = EVAL_EXPECTED_PATH;
+  const char* generatePath = nullptr;
+  uint64_t seed = 1;
+  bool verbose = false;
+  bool update = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--verbose") == 0) verbose = true;
+    else if (strcmp(argv[i], "--update") == 0) update = true;
+    else if (strncmp(argv[i], "--corpus=", 9) == 0) corpusPath = argv[i] + 9;
+    else if (strncmp(argv[i], "--expected=", 11) == 0) expectedPath = argv[i] + 11;
+    else if (strncmp(argv[i], "--generate=", 11) == 0) generatePath = argv[i] + 11;
+    else if (strncmp(argv[i], "--seed=", 7) == 0) seed = strtoull(argv[i] + 7, nullptr, 10);
+    else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  halHost_setLogEnabled(false);
+  halHost_setDelayAdvancesClock(false);
+
+  if (generatePath) return eval_generate(generatePath, seed) ? 0 : 1;
+  if (!eval_loadCorpus(corpusPath)) return 1;
+
+  printf("%-16s %8s %8s %8s %8s %6s %6s %8s %10s\n", "policy", "press50", "pressMax", "rel50", "relMax",
+         "false", "missed", "stuck", "ns/update");
+
+  static EvalScore score;
+  int unsafe = 0;
+  for (int p = 0; p < EVAL_POLICY_COUNT; p++) {
+    const EvalPolicy* policy = &kPolicies[p];
+    memset(&score, 0, sizeof(score));
+    int64_t updates = 0;
+    double elapsedNs = 0;
+
+    for (int w = 0; w < g_waveformCount; w++) {
+      const Waveform* waveform = &g_waveforms[w];
+      if (policy->needsNC && !waveform->hasNC) continue;
+
+      double start = eval_nowNs();
+      for (int r = 0; r < EVAL_CPU_REPEATS; r++) {
+        updates += eval_replay(waveform, policy);
+      }
+      elapsedNs += eval_nowNs() - start;
+
+      EvalWaveformScore result = eval_score(waveform, &score);
+      score.waveforms++;
+
+      EvalExpected* record = &g_results[g_resultCount++];
+      snprintf(record->policy, sizeof(record->policy), "%s", policy->name);
+      snprintf(record->waveform, sizeof(record->waveform), "%s", waveform->name);
+      record->score = result;
+
+      if (policy->shipped && (result.falsePresses > 0 || result.missedReleases > 0)) {
+        printf("UNSAFE %s on %s: %d false presses, %d stuck keys\n", policy->name, waveform->name,
+               result.falsePresses, result.missedReleases);
+        unsafe++;
+      }
+
+      if (verbose) {
+        printf("  %-14s %-20s false %3d  missed %3d  stuck %3d  max press %7.2f ms  max release %7.2f ms\n",
+               policy->name, waveform->name, result.falsePresses, result.missedPresses, result.missedReleases,
+               result.maxPressLatency / 1000.0, result.maxReleaseLatency / 1000.0);
+      }
+    }
+
+    score.nsPerUpdate = updates > 0 ? elapsedNs / updates : 0;
+    printf("%-16s %8.2f %8.2f %8.2f %8.2f %6d %6d %8d %10.1f\n", policy->name,
+           eval_percentileMs(score.pressLatencies, score.pressCount, 50),
+           eval_percentileMs(score.pressLatencies, score.pressCount, 100),
+           eval_percentileMs(score.releaseLatencies, score.releaseCount, 50),
+           eval_percentileMs(score.releaseLatencies, score.releaseCount, 100),
+           score.falsePresses, score.missedPresses, score.missedReleases, score.nsPerUpdate);
+  }
+  printf("Latencies in ms from the first contact edge; %d waveforms; \"stuck\" = missed releases\n",
+         g_waveformCount);
+
+  if (unsafe > 0) {
+    // Never recorded as expected: a shipped policy must not invent or hold keys
+    printf("%d shipped result(s) with false presses or stuck keys\n", unsafe);
+    return 1;
+  }
+
+  if (update) {
+    if (!eval_writeExpected(expectedPath)) {
+      fprintf(stderr, "Cannot write %s\n", expectedPath);
+      return 1;
+    }
+    printf("Updated %s\n", expectedPath);
+    return 0;
+  }
+
+  int regressions = eval_checkExpected(expectedPath);
+  if (regressions > 0) {
+    printf("%d result(s) worse than %s\n", regressions, expectedPath);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,7 @@
+// Host build of esp32/firebeetle2/firebeetle2.ino against the HAL fakes.
+
+#include "../shared/hal/host/HalHost.cpp"
+#include "../firebeetle2/firebeetle2.ino"
+
+#define HOST_PEDAL_PIN PEDAL_1_PIN
+#include "TransmitterHostMain.h"
@@ -0,0 +1,181 @@
+// Host build of esp32/panicpedal-pro/panicpedal-pro.ino against the HAL fakes.
+// After the switch checks, flips the profile switch and checks the receiver is
+// sent the profile's keys, then swaps in a hall-effect sensor on the left pedal
+// and checks rapid trigger and the position stream.
+
+#include "../shared/hal/host/HalHost.cpp"
+#include "../panicpedal-pro/panicpedal-pro.ino"
+
+#define HOST_PEDAL_PIN PEDAL_LEFT_NO_PIN
+#define HOST_PEDAL_NC_PIN PEDAL_LEFT_NC_PIN
+#define HOST_EXTRA_CHECK hostCheckPanicPedalPro
+static bool hostCheckPanicPedalPro();
+#include "TransmitterHostMain.h"
+
+#define HOST_ANALOG_REST 2200
+#define HOST_ANALOG_PRESSED 3600
+#define HOST_ANALOG_NOISE 4  // ADC counts either side of the filtered level, under one position
+
+static pedal_profile_message g_lastProfile;
+static int g_profileFrames = 0;
+
+static bool hostProfileSendHook(void* context, HalHostNode* sender, const uint8_t* dstMAC, const uint8_t* data, int len) {
+  (void)context;
+  (void)sender;
+  (void)dstMAC;
+  if (data[0] == MSG_PEDAL_PROFILE && len == (int)sizeof(pedal_profile_message)) {
+    memcpy(&g_lastProfile, data, sizeof(g_lastProfile));
+    g_profileFrames++;
+  }
+  return true;
+}
+
+// Moves the switch and runs loop() for `ms` of virtual time
+static void hostFlipProfileSwitch(bool pos2, int ms) {
+  halHost_setPin(SWITCH_POS2_PIN, pos2 ? HAL_GPIO_LOW : HAL_GPIO_HIGH);
+  int64_t until = halClock_micros() + (int64_t)ms * 1000;
+  while (halClock_micros() < until) loop();
+}
+
+static bool hostCheckProfileSwitch() {
+  halHost_setSendHook(hostProfileSendHook, nullptr);
+  
+  // Contact bounce shorter than the settle time changes nothing
+  halHost_setPin(SWITCH_POS2_PIN, HAL_GPIO_LOW);
+  loop();
+  hostFlipProfileSwitch(false, PROFILE_SWITCH_SETTLE_MS * 3);
+  if (g_profileFrames != 0 || profileSwitch.position != 0) {
+    fprintf(stderr, "transmitter_host: switch bounce changed the profile\n");
+    return false;
+  }
+  
+  hostFlipProfileSwitch(true, PROFILE_SWITCH_SETTLE_MS * 3);
+  bool sent = g_profileFrames > 0 && g_lastProfile.profile == 2 && g_lastProfile.keys[0] == 'z' &&
+              g_lastProfile.keys[1] == 'x';
+  if (!sent || activeProfile != &kProfiles[2] || pedalReader.pedal2State.debouncePolicy != DEBOUNCE_POLICY_DEFERRED) {
+    fprintf(stderr, "transmitter_host: profile 2 not applied (%d profile frames)\n", g_profileFrames);
+    return false;
+  }
+  int frames = g_profileFrames;
+  
+  // Back to the middle restores the receiver's own keys, still paired
+  hostFlipProfileSwitch(false, PROFILE_SWITCH_SETTLE_MS * 3);
+  if (g_lastProfile.profile != 0 || g_lastProfile.keys[0] != 0 || activeProfile != &kProfiles[0] ||
+      !pairingState_isPaired(&pairingState)) {
+    fprintf(stderr, "transmitter_host: middle position did not restore profile 0\n");
+    return false;
+  }
+  
+  printf("transmitter_host: profile switch 0 -> 2 -> 0 applied live, %d frames per profile burst\n", frames);
+  return true;
+}
+
+// The receiver's view: snapshot masks in seq order and the rebuilt positions
+static uint8_t g_snapshotMasks[16];
+static int g_snapshotCount = 0;
+static uint8_t g_lastSnapshotSeq = 0;
+static uint8_t g_rebuiltPosition = 0;
+static uint8_t g_lastPositionSeq = 0;
+static bool g_positionsValid = false;
+static int g_keyframes = 0;
+static int g_deltas = 0;
+static int g_positionBytes = 0;
+
+static bool hostAnalogSendHook(void* context, HalHostNode* sender, const uint8_t* dstMAC, const uint8_t* data, int len) {
+  (void)context;
+  (void)sender;
+  (void)dstMAC;
+  if (data[0] == MSG_PEDAL_SNAPSHOT) {
+    const pedal_snapshot_message* snapshot = (const pedal_snapshot_message*)data;
+    if (snapshot->seq != g_lastSnapshotSeq && g_snapshotCount < 16) {
+      g_snapshotMasks[g_snapshotCount++] = snapshot->pedalMask;
+    }
+    g_lastSnapshotSeq = snapshot->seq;
+  } else if (data[0] == MSG_PEDAL_POSITION) {
+    const pedal_position_message* position = (const pedal_position_message*)data;
+    uint8_t seq = position->seq & PEDAL_POSITION_SEQ_MASK;
+    if (position->seq & PEDAL_POSITION_KEYFRAME) {
+      g_rebuiltPosition = position->positions[0];
+      g_positionsValid = true;
+      g_keyframes++;
+    } else {
+      g_positionsValid &= seq == ((g_lastPositionSeq + 1) & PEDAL_POSITION_SEQ_MASK);
+      g_rebuiltPosition += messageCodec_positionDelta(position->positions[0], 0);
+      g_deltas++;
+    }
+    g_lastPositionSeq = seq;
+    g_positionBytes += len;
+  }
+  return true;
+}
+
+// Moves the magnet to `raw` in small steps, one per loop(), with sensor noise
+static void hostMoveAnalog(int raw) {
+  static int current = HOST_ANALOG_REST;
+  static int noise = HOST_ANALOG_NOISE;
+  do {
+    current += raw > current ? (raw - current < 10 ? raw - current : 10) : (current - raw < 10 ? raw - current : -10);
+    noise = -noise;
+    halHost_setAnalog(PEDAL_LEFT_NO_PIN, (uint16_t)(current + noise));
+    loop();
+  } while (current != raw);
+  for (int i = 0; i < 100; i++) {  // Hold, long enough for the settling keyframe
+    noise = -noise;
+    halHost_setAnalog(PEDAL_LEFT_NO_PIN, (uint16_t)(current + noise));
+    loop();
+  }
+}
+
+static bool hostCheckAnalogPedal() {
+  halHost_setSendHook(hostAnalogSendHook, nullptr);
+  uint8_t pins[1] = {PEDAL_LEFT_NO_PIN};
+  
+  // The timer wake from deep sleep boots only for a pedal past the deadzone
+  halHost_setAnalog(PEDAL_LEFT_NO_PIN, HOST_ANALOG_PRESSED);
+  bool wakes = analogPedals_anyPressed(pins, 1, HOST_ANALOG_REST, HOST_ANALOG_PRESSED, ANALOG_DEADZONE);
+  halHost_setAnalog(PEDAL_LEFT_NO_PIN, HOST_ANALOG_REST + HOST_ANALOG_NOISE);
+  if (!wakes || analogPedals_anyPressed(pins, 1, HOST_ANALOG_REST, HOST_ANALOG_PRESSED, ANALOG_DEADZONE)) {
+    fprintf(stderr, "transmitter_host: analog wake check got the pedal wrong\n");
+    return false;
+  }
+  
+  halHost_setAnalog(PEDAL_LEFT_NO_PIN, HOST_ANALOG_REST);
+  if (!analogPedals_init(&analogPedals, pins, 1, ANALOG_SAMPLE_RATE_HZ, HOST_ANALOG_REST, HOST_ANALOG_PRESSED,
+                         ANALOG_RAPID_TRIGGER, ANALOG_DEADZONE)) {
+    fprintf(stderr, "transmitter_host: ADC did not start\n");
+    return false;
+  }
+  pedalService_setAnalogPedals(&pedalService, &analogPedals);
+  
+  // Down to 60% travel, up by twice the rapid-trigger distance, down again, then
+  // back to rest: press, release, press, release without returning to the top
+  int span = HOST_ANALOG_PRESSED - HOST_ANALOG_REST;
+  int deep = HOST_ANALOG_REST + span * 6 / 10;
+  hostMoveAnalog(HOST_ANALOG_REST);
+  hostMoveAnalog(deep);
+  hostMoveAnalog(deep - span * 2 * ANALOG_RAPID_TRIGGER / ANALOG_POSITION_MAX);
+  hostMoveAnalog(deep);
+  hostMoveAnalog(HOST_ANALOG_REST);
+  
+  static const uint8_t expected[] = {0x01, 0x00, 0x01, 0x00};
+  bool triggered = g_snapshotCount == 4 && memcmp(g_snapshotMasks, expected, sizeof(expected)) == 0;
+  if (!triggered) {
+    fprintf(stderr, "transmitter_host: rapid trigger sent %d changes, expected press/release twice\n", g_snapshotCount);
+    return false;
+  }
+  int error = g_rebuiltPosition - analogPedals_position(&analogPedals, 0);
+  if (!g_positionsValid || g_deltas == 0 || error > PEDAL_POSITION_DEADBAND || error < -PEDAL_POSITION_DEADBAND) {
+    fprintf(stderr, "transmitter_host: position stream rebuilt %d, pedal at %d\n", g_rebuiltPosition,
+            analogPedals_position(&analogPedals, 0));
+    return false;
+  }
+  
+  int frames = g_keyframes + g_deltas;
+  printf("transmitter_host: analog rapid trigger 4/4 changes; %d position frames (%d keyframes), %.2f bytes/frame\n",
+         frames, g_keyframes, (double)g_positionBytes / frames);
+  return true;
+}
+
+static bool hostCheckPanicPedalPro() {
+  return hostCheckProfileSwitch() && hostCheckAnalogPedal();
+}
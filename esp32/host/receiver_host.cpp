@@ -0,0 +1,604 @@
+// Host build of esp32/receiver/receiver.ino against the HAL fakes.
+// Pairs a current and a legacy pedal, checks the negotiated capabilities, replays press/release bursts through
+// onMessageReceived and checks that each comes out of the HID fake once, in order, then overflows the receive ring
+// and checks that simultaneous key changes share one HID report. Reports arrival -> USB pickup latency with
+// immediate and frame-aligned report scheduling, switches to gamepad output with the mode button, and streams
+// analog pedal positions to a gamepad axis. Last, a pedal slot types a frame-timed macro, two slots autofire at
+// different rates at once, slot 0 autofires gamepad button 0, both pedals held resolve per SOCD policy, a pedal
+// profile rebinds a held pedal, a remapped pedal keeps its binding, a full receiver keeps every pedal's ID and
+// slot through a removal, and records saved before transmitter IDs migrate and are erased.
+
+#include <stdio.h>
+#include <time.h>
+#include "../shared/hal/host/HalHost.cpp"
+#include "../receiver/receiver.ino"
+
+#define HOST_PEDAL_EVENTS 10000
+#define HOST_STOMPS 200
+#define HOST_STOMP_PHASE_STEP_US 37  // Walks the stomps across the host's 1 ms polling phase
+
+static const uint8_t kPedalMAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x01};
+static const uint8_t kLegacyPedalMAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x02};
+
+static int64_t hostNowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// One counter across the whole run, like a transmitter that never reboots
+static uint8_t nextSeq() {
+  static uint8_t seq = 0;
+  seq = (seq == 255) ? 1 : seq + 1;
+  return seq;
+}
+
+// Virtual time passes in small steps so the HID task's timed wake-ups run on time
+static void hostStepMicros(int64_t micros) {
+  for (int64_t elapsed = 0; elapsed < micros; elapsed += 10) {
+    halClock_delayMicros(10);
+  }
+}
+
+static void injectFrameFrom(const uint8_t* mac, const void* frame, int len) {
+  halHost_deliver(halHost_currentNode(), mac, (const uint8_t*)frame, len, 1);
+}
+
+static void injectFrame(const void* frame, int len) {
+  injectFrameFrom(kPedalMAC, frame, len);
+}
+
+int main() {
+  halHost_setLogEnabled(false);
+  setup();
+  loop();
+  
+  // Pair during the grace period as SINGLE pedals: one current, one from
+  // before protocol negotiation
+  handshake_message discovery = {MSG_DISCOVERY_REQ, 0, false, 1, 0, PROTOCOL_VERSION, PROTOCOL_CAPABILITIES};
+  injectFrame(&discovery, sizeof(discovery));
+  struct_message legacyDiscovery = {MSG_DISCOVERY_REQ, 0, false, 1, 0};
+  injectFrameFrom(kLegacyPedalMAC, &legacyDiscovery, STRUCT_MESSAGE_MIN_SIZE);
+  int index = transmitterManager_findIndex(&transmitterManager, kPedalMAC);
+  int legacyIndex = transmitterManager_findIndex(&transmitterManager, kLegacyPedalMAC);
+  if (index < 0 || legacyIndex < 0) {
+    fprintf(stderr, "receiver_host: pedal failed to pair\n");
+    return 1;
+  }
+  if (transmitterManager.transmitters[index].capabilities != PROTOCOL_CAPABILITIES ||
+      transmitterManager.transmitters[legacyIndex].capabilities != 0) {
+    fprintf(stderr, "receiver_host: wrong negotiated capabilities\n");
+    return 1;
+  }
+  int slot = transmitterManager_binding(&transmitterManager, index, '1')->slot;
+  int legacySlot = transmitterManager_binding(&transmitterManager, legacyIndex, '1')->slot;
+  
+  HalHostNode* node = halHost_currentNode();
+  halHost_clearHidEvents(node);
+  
+  int64_t totalNanos = 0;
+  int errors = 0;
+  for (int i = 0; i < HOST_PEDAL_EVENTS; i++) {
+    bool pressed = (i % 2) == 0;
+    struct_message event = {MSG_PEDAL_EVENT, '1', pressed, 1, nextSeq()};
+    
+    int64_t start = hostNowNanos();
+    for (int copy = 0; copy < PEDAL_EVENT_BURST_COUNT; copy++) {
+      injectFrame(&event, sizeof(event));
+    }
+    totalNanos += hostNowNanos() - start;
+    
+    if (node->hidEventCount != 1 || node->hidEvents[0].pressed != pressed || node->hidEvents[0].key != 'l') {
+      errors++;
+    }
+    halHost_clearHidEvents(node);
+    halHost_advanceMillis(5);
+  }
+  
+  // Same again with state snapshots, the frame current transmitters send
+  for (int i = 0; i < HOST_PEDAL_EVENTS; i++) {
+    bool pressed = (i % 2) == 0;
+    pedal_snapshot_message snapshot = {MSG_PEDAL_SNAPSHOT, (uint8_t)(pressed ? 0x01 : 0x00), 1, nextSeq()};
+    
+    int64_t start = hostNowNanos();
+    for (int copy = 0; copy < PEDAL_EVENT_BURST_COUNT; copy++) {
+      injectFrame(&snapshot, sizeof(snapshot));
+    }
+    totalNanos += hostNowNanos() - start;
+    
+    if (node->hidEventCount != 1 || node->hidEvents[0].pressed != pressed || node->hidEvents[0].key != 'l') {
+      errors++;
+    }
+    halHost_clearHidEvents(node);
+    halHost_advanceMillis(5);
+  }
+  
+  // A transmitter that goes silent with the pedal held gets released by the HID task
+  pedal_snapshot_message held = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  injectFrame(&held, sizeof(held));
+  halHost_clearHidEvents(node);
+  for (int i = 0; i < 50; i++) {
+    loop();  // 10 ms each
+  }
+  if (node->hidEventCount != 1 || node->hidEvents[0].pressed || node->hidEvents[0].key != 'l') {
+    fprintf(stderr, "receiver_host: held key not released after the transmitter went silent\n");
+    errors++;
+  }
+  
+  // A copy of the press that straggles in well after the release must not press again
+  struct_message latePress = {MSG_PEDAL_EVENT, '1', true, 1, nextSeq()};
+  struct_message release = {MSG_PEDAL_EVENT, '1', false, 1, nextSeq()};
+  pedal_snapshot_message lateHeld = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  pedal_snapshot_message up = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+  injectFrame(&latePress, sizeof(latePress));
+  injectFrame(&release, sizeof(release));
+  injectFrame(&lateHeld, sizeof(lateHeld));
+  injectFrame(&up, sizeof(up));
+  halHost_clearHidEvents(node);
+  halHost_advanceMillis(200);
+  injectFrame(&latePress, sizeof(latePress));
+  injectFrame(&lateHeld, sizeof(lateHeld));
+  if (node->hidEventCount != 0) {
+    fprintf(stderr, "receiver_host: late burst copy pressed a released key\n");
+    errors++;
+  }
+  
+  // A stalled HID task: the ring fills, drops and counts the overflow, then
+  // drains in order once the task runs again
+  halHost_clearHidEvents(node);
+  HalTask* stalledTask = hidTask;
+  hidTask = nullptr;
+  uint32_t droppedBefore = receiveRing.dropped;
+  for (int i = 0; i < RECEIVE_RING_SIZE + 4; i++) {
+    pedal_snapshot_message snapshot = {MSG_PEDAL_SNAPSHOT, (uint8_t)(i % 2 ? 0x00 : 0x01), 1, nextSeq()};
+    injectFrame(&snapshot, sizeof(snapshot));
+  }
+  hidTask = stalledTask;
+  if (receiveRing_occupancy(&receiveRing) != RECEIVE_RING_SIZE || receiveRing.dropped - droppedBefore != 4) {
+    fprintf(stderr, "receiver_host: receive ring did not fill and count drops\n");
+    errors++;
+  }
+  halTask_notify(hidTask);
+  if (receiveRing_occupancy(&receiveRing) != 0 || node->hidEventCount != RECEIVE_RING_SIZE) {
+    fprintf(stderr, "receiver_host: receive ring not drained\n");
+    errors++;
+  }
+  
+  // Two pedals that change in the same drain share one HID report
+  hidTask = nullptr;
+  pedal_snapshot_message stomp = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  injectFrame(&stomp, sizeof(stomp));
+  struct_message legacyStomp = {MSG_PEDAL_EVENT, '1', true, 1, 0};
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  hidTask = stalledTask;
+  halHost_clearHidEvents(node);
+  int reportsBefore = node->hidReportCount;
+  halTask_notify(hidTask);
+  hostStepMicros(HAL_HID_POLL_INTERVAL_US);
+  if (node->hidEventCount != 2 || node->hidReportCount - reportsBefore != 1) {
+    fprintf(stderr, "receiver_host: simultaneous presses not coalesced into one HID report\n");
+    errors++;
+  }
+  stomp.pedalMask = 0x00;
+  stomp.seq = nextSeq();
+  injectFrame(&stomp, sizeof(stomp));
+  legacyStomp.pressed = false;
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  hostStepMicros(HAL_HID_POLL_INTERVAL_US);
+  
+  // Two players stomping 300 us apart, at every phase of the host's polling:
+  // arrival -> pickup per key change with each report schedule
+  node->hidPollPhaseMicros = 370;
+  const uint8_t schedules[2] = {HID_SCHEDULE_IMMEDIATE, HID_SCHEDULE_FRAME_ALIGNED};
+  for (int s = 0; s < 2; s++) {
+    keyboardService_setScheduleMode(&keyboardService, schedules[s]);
+    HidLatencyStats latency;
+    keyboardService_takeLatency(&keyboardService, &latency);
+    for (int i = 0; i < HOST_STOMPS; i++) {
+      bool pressed = (i % 2) == 0;
+      pedal_snapshot_message first = {MSG_PEDAL_SNAPSHOT, (uint8_t)(pressed ? 0x01 : 0x00), 1, nextSeq()};
+      struct_message second = {MSG_PEDAL_EVENT, '1', pressed, 1, 0};
+      hostStepMicros(HOST_STOMP_PHASE_STEP_US);
+      injectFrame(&first, sizeof(first));
+      hostStepMicros(300);
+      injectFrameFrom(kLegacyPedalMAC, &second, STRUCT_MESSAGE_MIN_SIZE);
+      hostStepMicros(5 * HAL_HID_POLL_INTERVAL_US);
+    }
+    keyboardService_takeLatency(&keyboardService, &latency);
+    if (latency.events != 2 * HOST_STOMPS) {
+      fprintf(stderr, "receiver_host: %lu of %d key changes reached a HID report\n",
+              (unsigned long)latency.events, 2 * HOST_STOMPS);
+      errors++;
+      continue;
+    }
+    printf("receiver_host: %s reports: ring %.0f us, hold %.0f us, USB %.0f us avg; worst %lu us arrival -> pickup\n",
+           schedules[s] == HID_SCHEDULE_IMMEDIATE ? "immediate" : "frame-aligned",
+           (double)latency.ringMicros / latency.events, (double)latency.holdMicros / latency.events,
+           (double)latency.usbMicros / latency.events, (unsigned long)latency.worstMicros);
+  }
+  keyboardService_setScheduleMode(&keyboardService, HID_REPORT_SCHEDULE);
+  
+  // Holding the mode button switches to gamepad output and saves it; the
+  // held pedal moves from its key to its button
+  pedal_snapshot_message hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  halHost_clearHidEvents(node);
+  halHost_setPin(MODE_BUTTON_PIN, HAL_GPIO_LOW);
+  for (int i = 0; i < MODE_BUTTON_HOLD_MS / 10 + 2; i++) {
+    hold.seq = nextSeq();
+    injectFrame(&hold, sizeof(hold));  // Keepalive
+    loop();
+  }
+  halHost_setPin(MODE_BUTTON_PIN, HAL_GPIO_HIGH);
+  if (keyboardService.outputMode != HID_OUTPUT_GAMEPAD || persistence_loadOutputMode(HID_OUTPUT_KEYBOARD) != HID_OUTPUT_GAMEPAD ||
+      node->hidEventCount != 2 || node->hidEvents[0].gamepad || node->hidEvents[0].pressed ||
+      !node->hidEvents[1].gamepad || !node->hidEvents[1].pressed || node->hidEvents[1].key != 0) {
+    fprintf(stderr, "receiver_host: mode button did not switch the held pedal to gamepad output\n");
+    errors++;
+  }
+  hold.pedalMask = 0x00;
+  hold.seq = nextSeq();
+  halHost_clearHidEvents(node);
+  injectFrame(&hold, sizeof(hold));
+  if (node->hidEventCount != 1 || !node->hidEvents[0].gamepad || node->hidEvents[0].pressed) {
+    fprintf(stderr, "receiver_host: gamepad button not released\n");
+    errors++;
+  }
+  
+  // Analog travel drives the pedal's axis: a keyframe, then deltas on top of
+  // it; after a lost frame, deltas are ignored until the next keyframe
+  pedal_position_message position = {MSG_PEDAL_POSITION, PEDAL_POSITION_KEYFRAME | 1, {100, 0}};
+  injectFrame(&position, sizeof(position));
+  position = {MSG_PEDAL_POSITION, 2, {messageCodec_packPositionDeltas(-5, 0), 0}};
+  injectFrame(&position, PEDAL_POSITION_DELTA_SIZE);
+  bool deltaApplied = node->hidAxes[slot] == 95;
+  position = {MSG_PEDAL_POSITION, 4, {messageCodec_packPositionDeltas(7, 0), 0}};
+  injectFrame(&position, PEDAL_POSITION_DELTA_SIZE);
+  bool gapIgnored = node->hidAxes[slot] == 95;
+  position = {MSG_PEDAL_POSITION, PEDAL_POSITION_KEYFRAME | 5, {0, 0}};
+  injectFrame(&position, sizeof(position));
+  if (!deltaApplied || !gapIgnored || node->hidAxes[slot] != 0) {
+    fprintf(stderr, "receiver_host: pedal position stream not tracked on the gamepad axis\n");
+    errors++;
+  }
+  keyboardService_setOutputMode(&keyboardService, HID_OUTPUT_KEYBOARD);
+  
+  // A macro on the pedal's slot types its combo on the frame grid, once per
+  // press however many snapshots repeat it
+  keyboardService_setMacro(&keyboardService, slot, &kComboMacro);
+  MacroJitterStats jitter;
+  keyboardService_takeMacroJitter(&keyboardService, &jitter);
+  halClock_delay(HID_TASK_PERIOD_MS);
+  halHost_clearHidEvents(node);
+  hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  int64_t pressMicros = halClock_micros();
+  injectFrame(&hold, sizeof(hold));
+  for (int i = 0; i < 6; i++) {
+    hostStepMicros(20000);
+    hold.seq = nextSeq();
+    injectFrame(&hold, sizeof(hold));  // Keepalive
+  }
+  hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  keyboardService_takeMacroJitter(&keyboardService, &jitter);
+  int comboSteps = sizeof(kComboSteps) / sizeof(kComboSteps[0]);
+  bool comboTyped = node->hidEventCount == comboSteps && jitter.steps == (uint32_t)comboSteps;
+  for (int i = 0; comboTyped && i < comboSteps; i++) {
+    int64_t due = pressMicros + (int64_t)kComboSteps[i].frame * 1000000 / MACRO_FRAME_RATE_HZ;
+    comboTyped = node->hidEvents[i].key == (uint8_t)kComboSteps[i].key &&
+                 node->hidEvents[i].pressed == kComboSteps[i].pressed &&
+                 node->hidEvents[i].timeMicros >= due && node->hidEvents[i].timeMicros - due < 100;
+  }
+  if (!comboTyped) {
+    fprintf(stderr, "receiver_host: macro typed %d HID events, expected its %d steps on time\n", node->hidEventCount,
+            comboSteps);
+    errors++;
+  } else {
+    printf("receiver_host: macro %d steps at %d Hz frames, %lu us late avg, worst %lu us\n", comboSteps,
+           MACRO_FRAME_RATE_HZ, (unsigned long)(jitter.lateMicros / jitter.steps), (unsigned long)jitter.worstLateMicros);
+  }
+  keyboardService_setMacro(&keyboardService, slot, nullptr);
+  
+  // Autofire on two slots at once, 30 and 15 presses a second: each toggles
+  // on its own frame grid from its press, on the one shared timer
+  keyboardService_setAutofire(&keyboardService, slot, 1);
+  keyboardService_setAutofire(&keyboardService, legacySlot, 2);
+  keyboardService_takeMacroJitter(&keyboardService, &jitter);
+  halClock_delay(HID_TASK_PERIOD_MS);
+  halHost_clearHidEvents(node);
+  hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  int64_t fastPressMicros = halClock_micros();
+  injectFrame(&hold, sizeof(hold));
+  hostStepMicros(300);
+  legacyStomp.pressed = true;
+  int64_t slowPressMicros = halClock_micros();
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  for (int i = 0; i < 9; i++) {
+    hostStepMicros(21000);
+    hold.seq = nextSeq();
+    injectFrame(&hold, sizeof(hold));  // Keepalive
+  }
+  hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  legacyStomp.pressed = false;
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  hostStepMicros(HAL_HID_POLL_INTERVAL_US);
+  keyboardService_takeMacroJitter(&keyboardService, &jitter);
+  
+  // Held 189 ms: frames 0-11 toggle the fast slot, even frames 0-10 the slow
+  // one, and each ends released
+  uint8_t fastKey = (uint8_t)transmitterManager_binding(&transmitterManager, index, '1')->key;
+  uint8_t slowKey = (uint8_t)transmitterManager_binding(&transmitterManager, legacyIndex, '1')->key;
+  int fastToggles = 0, slowToggles = 0;
+  bool autofireOnGrid = true;
+  for (int i = 0; i < node->hidEventCount; i++) {
+    const HalHostHidEvent* event = &node->hidEvents[i];
+    int* toggles = event->key == fastKey ? &fastToggles : &slowToggles;
+    int64_t start = event->key == fastKey ? fastPressMicros : slowPressMicros;
+    int framesPerToggle = event->key == fastKey ? 1 : 2;
+    int64_t due = start + (int64_t)*toggles * framesPerToggle * 1000000 / MACRO_FRAME_RATE_HZ;
+    autofireOnGrid = autofireOnGrid && (event->key == fastKey || event->key == slowKey) &&
+                     event->pressed == (*toggles % 2 == 0) && event->timeMicros >= due &&
+                     event->timeMicros - due < 100;
+    (*toggles)++;
+  }
+  if (!autofireOnGrid || fastToggles != 12 || slowToggles != 6) {
+    fprintf(stderr, "receiver_host: autofire toggled %d and %d times, expected 12 and 6 on the frame grid\n",
+            fastToggles, slowToggles);
+    errors++;
+  } else {
+    printf("receiver_host: autofire %d + %d presses on two slots, %lu us late avg, worst %lu us\n", fastToggles / 2,
+           slowToggles / 2, (unsigned long)(jitter.lateMicros / jitter.steps), (unsigned long)jitter.worstLateMicros);
+  }
+  keyboardService_setAutofire(&keyboardService, legacySlot, 0);
+  
+  // In gamepad mode autofire toggles the slot's button, button 0 included,
+  // and the release lets the slot go
+  keyboardService_setOutputMode(&keyboardService, HID_OUTPUT_GAMEPAD);
+  halClock_delay(HID_TASK_PERIOD_MS);
+  halHost_clearHidEvents(node);
+  hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  for (int i = 0; i < 3; i++) {
+    hostStepMicros(21000);
+    hold.seq = nextSeq();
+    injectFrame(&hold, sizeof(hold));  // Keepalive
+  }
+  hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  hostStepMicros(HAL_HID_POLL_INTERVAL_US);
+  int buttonToggles = 0;
+  bool buttonToggled = slot == 0;
+  for (int i = 0; i < node->hidEventCount; i++) {
+    const HalHostHidEvent* event = &node->hidEvents[i];
+    buttonToggled = buttonToggled && event->gamepad && event->key == slot && event->pressed == (buttonToggles % 2 == 0);
+    buttonToggles++;
+  }
+  if (!buttonToggled || buttonToggles < 4 || buttonToggles % 2 != 0 ||
+      (keyboardService.macroSlotsHeld & (1u << slot))) {
+    fprintf(stderr, "receiver_host: gamepad autofire on slot %d toggled button %d times, expected 4 or more ending "
+            "released\n", slot, buttonToggles);
+    errors++;
+  }
+  keyboardService_setOutputMode(&keyboardService, HID_OUTPUT_KEYBOARD);
+  keyboardService_setAutofire(&keyboardService, slot, 0);
+  
+  // Both pedals held: each SOCD policy sends its own key changes, on the cycle
+  // of the pedal change that caused them. '+'/'-' = first pedal's key, '<'/'>'
+  // = second's.
+  static const struct {
+    uint8_t policy;
+    const char* expected;
+  } kSocdCases[] = {
+    {SOCD_LAST_INPUT, "+-><+-"},
+    {SOCD_FIRST_INPUT, "+-"},
+    {SOCD_NEUTRAL, "+-+-"},
+  };
+  int socdErrors = errors;
+  for (size_t c = 0; c < sizeof(kSocdCases) / sizeof(kSocdCases[0]); c++) {
+    socdResolver_init(&keyboardService.socd);
+    keyboardService_setSocd(&keyboardService, fastKey, slowKey, kSocdCases[c].policy);
+    halClock_delay(HID_TASK_PERIOD_MS);
+    halHost_clearHidEvents(node);
+    hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+    injectFrame(&hold, sizeof(hold));
+    legacyStomp.pressed = true;
+    injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+    hold.seq = nextSeq();
+    injectFrame(&hold, sizeof(hold));  // A repeat does not reorder the pair
+    legacyStomp.pressed = false;
+    injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+    hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+    injectFrame(&hold, sizeof(hold));
+    
+    char sent[16] = {0};
+    for (int i = 0; i < node->hidEventCount && i < 15; i++) {
+      bool first = node->hidEvents[i].key == fastKey;
+      sent[i] = node->hidEvents[i].pressed ? (first ? '+' : '>') : (first ? '-' : '<');
+    }
+    if (strcmp(sent, kSocdCases[c].expected) != 0) {
+      fprintf(stderr, "receiver_host: SOCD policy %d sent \"%s\", expected \"%s\"\n", kSocdCases[c].policy, sent,
+              kSocdCases[c].expected);
+      errors++;
+    }
+  }
+  if (errors == socdErrors) {
+    printf("receiver_host: SOCD last-input, first-input and neutral policies resolved on the pedal's cycle\n");
+  }
+  socdResolver_init(&keyboardService.socd);
+  
+  // A profile switch on the pedal rebinds it while held: the old key lets go and
+  // the new one presses. Key 0 brings back the slot's default.
+  halHost_clearHidEvents(node);
+  hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  pedal_profile_message profile = {MSG_PEDAL_PROFILE, 2, {'q', 0}, {0, 0}};
+  injectFrame(&profile, sizeof(profile));
+  injectFrame(&profile, sizeof(profile));  // Burst copies change nothing
+  profile = {MSG_PEDAL_PROFILE, 0, {0, 0}, {0, 0}};
+  injectFrame(&profile, sizeof(profile));
+  hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+  injectFrame(&hold, sizeof(hold));
+  char defaultKey = transmitterManager_defaultKey(slot);
+  static const char kProfileExpected[] = "+d-d+q-q+d-d";
+  char profileSent[16] = {0};
+  for (int i = 0; i < node->hidEventCount && i < 7; i++) {
+    char key = node->hidEvents[i].key == defaultKey ? 'd' : node->hidEvents[i].key;
+    profileSent[2 * i] = node->hidEvents[i].pressed ? '+' : '-';
+    profileSent[2 * i + 1] = key;
+  }
+  if (strcmp(profileSent, kProfileExpected) != 0 || node->hidModifiers != 0) {
+    fprintf(stderr, "receiver_host: profile switch sent \"%s\", expected \"%s\"\n", profileSent, kProfileExpected);
+    errors++;
+  } else {
+    printf("receiver_host: pedal profile rebound a held pedal '%c' -> 'q' -> '%c' without a stuck key\n", defaultKey,
+           defaultKey);
+  }
+  
+  // A remapped pedal types its key with modifiers. The binding is saved with
+  // its transmitter, which keeps its ID when an earlier one is removed.
+  // The standard profile every pairing resends leaves that binding alone.
+  int legacyId = legacyIndex;
+  transmitterManager_setBinding(&transmitterManager, legacyIndex, '1', 'x', HAL_HID_MOD_LEFT_SHIFT);
+  pedal_profile_message standardProfile = {MSG_PEDAL_PROFILE, 0, {0, 0}, {0, 0}};
+  injectFrameFrom(kLegacyPedalMAC, &standardProfile, sizeof(standardProfile));
+  transmitterManager_remove(&transmitterManager, index);
+  persistence_save(&transmitterManager);
+  char removedKey[12];
+  uint8_t removedRecord[16];
+  snprintf(removedKey, sizeof(removedKey), "tx%d", index);
+  halNvs_begin("pedal", true);
+  bool removedKept = halNvs_getBytes(removedKey, removedRecord, sizeof(removedRecord)) != 0;
+  halNvs_end();
+  transmitterManager_init(&transmitterManager);
+  persistence_load(&transmitterManager);
+  legacyIndex = transmitterManager_findIndex(&transmitterManager, kLegacyPedalMAC);
+  halHost_clearHidEvents(node);
+  legacyStomp.pressed = true;
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  bool shifted = node->hidModifiers == HAL_HID_MOD_LEFT_SHIFT;
+  legacyStomp.pressed = false;
+  injectFrameFrom(kLegacyPedalMAC, &legacyStomp, STRUCT_MESSAGE_MIN_SIZE);
+  if (removedKept) {
+    fprintf(stderr, "receiver_host: record %s outlived its removed pedal\n", removedKey);
+    errors++;
+  }
+  if (legacyIndex != legacyId || transmitterManager_binding(&transmitterManager, legacyIndex, '1')->slot != legacySlot ||
+      !shifted || node->hidModifiers != 0 || node->hidEventCount != 2 || node->hidEvents[0].key != 'x' ||
+      !node->hidEvents[0].pressed || node->hidEvents[1].pressed) {
+    fprintf(stderr, "receiver_host: remapped pedal binding not kept across removal and reload\n");
+    errors++;
+  } else {
+    printf("receiver_host: remapped pedal kept ID %d and slot %d across removal and reload, typed shift+x\n",
+           legacyId, legacySlot);
+  }
+  
+  // Fill every free slot. Each pedal types its own slot's key; a removal
+  // leaves the other IDs and slots alone, the next pedal takes the freed
+  // ones, and all of it survives a reload.
+  uint8_t fillMACs[MAX_PEDAL_SLOTS + 1][6];
+  int fillIds[MAX_PEDAL_SLOTS + 1] = {};
+  int fillCount = 0;
+  while (transmitterManager_hasFreeSlots(&transmitterManager, 1)) {
+    uint8_t fillMAC[6] = {0x02, 0x00, 0x00, (uint8_t)(0x40 + fillCount * 7), 0x00, (uint8_t)fillCount};
+    memcpy(fillMACs[fillCount], fillMAC, 6);
+    fillIds[fillCount++] = transmitterManager_add(&transmitterManager, fillMAC, 1);
+  }
+  halHost_clearHidEvents(node);
+  for (int i = 0; i < fillCount; i++) {
+    hold = {MSG_PEDAL_SNAPSHOT, 0x01, 1, nextSeq()};
+    injectFrameFrom(fillMACs[i], &hold, sizeof(hold));
+    hold = {MSG_PEDAL_SNAPSHOT, 0x00, 1, nextSeq()};
+    injectFrameFrom(fillMACs[i], &hold, sizeof(hold));
+  }
+  int fillErrors = errors;
+  bool slotTaken[MAX_PEDAL_SLOTS] = {};
+  slotTaken[legacySlot] = true;
+  for (int i = 0; i < fillCount; i++) {
+    const PedalBinding* binding = transmitterManager_binding(&transmitterManager, fillIds[i], '1');
+    bool typed = node->hidEventCount == 2 * fillCount && node->hidEvents[2 * i].key == (uint8_t)binding->key &&
+                 node->hidEvents[2 * i].pressed && !node->hidEvents[2 * i + 1].pressed;
+    if (fillIds[i] < 0 || binding->slot >= MAX_PEDAL_SLOTS || slotTaken[binding->slot] || !typed) {
+      fprintf(stderr, "receiver_host: pedal %d of a full receiver has ID %d, slot %d\n", i, fillIds[i], binding->slot);
+      errors++;
+      break;
+    }
+    slotTaken[binding->slot] = true;
+  }
+  
+  int removed = fillCount / 2;
+  int fillSlots[MAX_PEDAL_SLOTS + 1];
+  for (int i = 0; i < fillCount; i++) {
+    fillSlots[i] = transmitterManager_binding(&transmitterManager, fillIds[i], '1')->slot;
+  }
+  transmitterManager_remove(&transmitterManager, fillIds[removed]);
+  uint8_t replacementMAC[6] = {0x02, 0x00, 0x00, 0x7F, 0x00, 0x7F};
+  memcpy(fillMACs[removed], replacementMAC, 6);
+  int replacementId = transmitterManager_add(&transmitterManager, replacementMAC, 1);
+  persistence_save(&transmitterManager);
+  transmitterManager_init(&transmitterManager);
+  persistence_load(&transmitterManager);
+  for (int i = 0; i < fillCount; i++) {
+    int id = transmitterManager_findIndex(&transmitterManager, fillMACs[i]);
+    if (id != fillIds[i] || transmitterManager_binding(&transmitterManager, id, '1')->slot != fillSlots[i]) {
+      fprintf(stderr, "receiver_host: pedal %d moved to ID %d after a removal and reload\n", i, id);
+      errors++;
+      break;
+    }
+  }
+  if (replacementId != fillIds[removed] || transmitterManager.slotsUsed != MAX_PEDAL_SLOTS) {
+    fprintf(stderr, "receiver_host: replacement pedal got ID %d, expected the freed %d\n", replacementId,
+            fillIds[removed]);
+    errors++;
+  }
+  if (errors == fillErrors) {
+    printf("receiver_host: %d pedals on %d slots, IDs and slots kept across removal and reload\n",
+           transmitterManager.count, MAX_PEDAL_SLOTS);
+  }
+  
+  // A receiver saved by firmware from before transmitter IDs: its per-field
+  // records load, and the first save replaces them with one record per ID
+  const uint8_t* legacyMACs[2] = {kPedalMAC, kLegacyPedalMAC};
+  halNvs_begin("pedal", false);
+  halNvs_remove("txMask");
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    char key[12];
+    snprintf(key, sizeof(key), "tx%d", i);
+    halNvs_remove(key);
+  }
+  halNvs_putInt("pairedCount", 2);
+  for (int i = 0; i < 2; i++) {
+    char key[15];
+    for (int j = 0; j < 6; j++) {
+      snprintf(key, sizeof(key), "mac%d_%d", i, j);
+      halNvs_putUChar(key, legacyMACs[i][j]);
+    }
+    snprintf(key, sizeof(key), "mode%d", i);
+    halNvs_putUChar(key, 1);
+  }
+  halNvs_end();
+  persistence_load(&transmitterManager);
+  bool migrated = transmitterManager.count == 2 && transmitterManager_findIndex(&transmitterManager, kPedalMAC) == 0 &&
+                  transmitterManager_findIndex(&transmitterManager, kLegacyPedalMAC) == 1;
+  persistence_save(&transmitterManager);
+  halNvs_begin("pedal", true);
+  bool legacyErased = halNvs_getInt("pairedCount", -1) < 0 && halNvs_getUChar("mac1_5", 0xFF) == 0xFF &&
+                      halNvs_getUChar("mode0", 0xFF) == 0xFF;
+  halNvs_end();
+  transmitterManager_init(&transmitterManager);
+  persistence_load(&transmitterManager);
+  migrated = migrated && transmitterManager.count == 2 &&
+             transmitterManager_findIndex(&transmitterManager, kLegacyPedalMAC) == 1;
+  if (!migrated || !legacyErased) {
+    fprintf(stderr, "receiver_host: legacy records %s, %s after the first save\n",
+            migrated ? "migrated" : "not migrated", legacyErased ? "erased" : "still there");
+    errors++;
+  } else {
+    printf("receiver_host: legacy records migrated to one record per ID and erased\n");
+  }
+  
+  int frames = 2 * HOST_PEDAL_EVENTS * PEDAL_EVENT_BURST_COUNT;
+  printf("receiver_host: %d pedal frames (%d events), %.1f ns/frame onMessageReceived -> HID, %d errors\n",
+         frames, 2 * HOST_PEDAL_EVENTS, (double)totalNanos / frames, errors);
+  return errors ? 1 : 0;
+}
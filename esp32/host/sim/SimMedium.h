@@ -0,0 +1,242 @@
+#ifndef SIM_MEDIUM_H
+#define SIM_MEDIUM_H
+
+// Discrete-event core and ESP-NOW medium model for radio_sim.cpp.
+//
+// Every node shares one channel. A send waits a random backoff, then defers
+// until the medium is idle if it senses another frame on the air. Two frames
+// that start within collisionWindowUs of each other cannot sense each other;
+// they collide and are lost for every receiver. Surviving frames reach each
+// receiver after baseDelayUs plus uniform jitter, unless dropped by the
+// independent per-link loss probability. A unicast frame reports back to its
+// sender's send callback after ackDelayUs: delivered if it survived and the
+// peer is awake. The firmware's own retransmits go through that callback;
+// the MAC's internal retries and lost ACKs are not modelled.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define SIM_MAX_EVENTS 8192
+#define SIM_MAX_FRAME_LEN 250   // ESP-NOW payload limit
+#define SIM_MAX_TRANSMISSIONS 256
+
+typedef enum {
+  SIM_EVENT_DELIVER = 0,
+  SIM_EVENT_SEND_DONE,
+  SIM_EVENT_RECEIVER_TICK,
+  SIM_EVENT_TRANSMITTER_TICK,
+  SIM_EVENT_PEDAL_DOWN,
+  SIM_EVENT_PEDAL_UP,
+  SIM_EVENT_RECEIVER_BOOT,
+  SIM_EVENT_RECEIVER_POWER_OFF,
+  SIM_EVENT_TRANSMITTER_BOOT,
+  SIM_EVENT_TRANSMITTER_POWER_OFF
+} SimEventType;
+
+typedef struct {
+  int64_t timeMicros;
+  uint32_t sequence;      // Tie-breaker: equal times run in scheduling order
+  SimEventType type;
+  int node;               // Receiver or transmitter index (by event type)
+  int transmission;       // DELIVER/SEND_DONE: slot in SimMedium.transmissions; ticks: node generation
+} SimEvent;
+
+typedef struct {
+  SimEvent heap[SIM_MAX_EVENTS];
+  int count;
+  uint32_t nextSequence;
+  int dropped;
+} SimEventQueue;
+
+typedef struct {
+  uint8_t srcMAC[6];
+  uint8_t data[SIM_MAX_FRAME_LEN];
+  int len;
+  int64_t startMicros;
+  bool collided;
+  int pendingDeliveries;  // Includes the pending SEND_DONE
+  uint8_t dstMAC[6];
+  int ackNode;            // Unicast destination node id, -1 if none
+  bool ackLinkOk;         // The destination's link did not drop it
+} SimTransmission;
+
+typedef struct {
+  double lossProbability;
+  int64_t baseDelayUs;
+  int64_t jitterUs;
+  int64_t backoffMaxUs;
+  int64_t collisionWindowUs;
+  double bitRateMbps;
+  int64_t ackDelayUs;
+} SimMediumConfig;
+
+typedef struct {
+  SimMediumConfig config;
+  SimTransmission transmissions[SIM_MAX_TRANSMISSIONS];
+  int nextTransmission;
+  int lastTransmission;
+  int64_t mediumFreeAt;
+  uint64_t rngState;
+  
+  // Statistics
+  int framesSent;
+  int framesCollided;
+  int deliveriesLost;
+  int deliveries;
+} SimMedium;
+
+// ----------------------------------------------------------------------------
+// Random numbers (xorshift64*, deterministic per seed)
+// ----------------------------------------------------------------------------
+
+static inline uint64_t simRandom_next(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+static inline double simRandom_unit(uint64_t* state) {
+  return (simRandom_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline int64_t simRandom_range(uint64_t* state, int64_t minValue, int64_t maxValue) {
+  if (maxValue <= minValue) return minValue;
+  return minValue + (int64_t)(simRandom_next(state) % (uint64_t)(maxValue - minValue + 1));
+}
+
+// ----------------------------------------------------------------------------
+// Event queue (binary min-heap on time, then sequence)
+// ----------------------------------------------------------------------------
+
+static inline bool simEvent_before(const SimEvent* a, const SimEvent* b) {
+  if (a->timeMicros != b->timeMicros) return a->timeMicros < b->timeMicros;
+  return a->sequence < b->sequence;
+}
+
+static void simQueue_init(SimEventQueue* queue) {
+  queue->count = 0;
+  queue->nextSequence = 0;
+  queue->dropped = 0;
+}
+
+static bool simQueue_push(SimEventQueue* queue, int64_t timeMicros, SimEventType type, int node, int transmission) {
+  if (queue->count >= SIM_MAX_EVENTS) {
+    queue->dropped++;
+    return false;
+  }
+  
+  int i = queue->count++;
+  SimEvent event = {timeMicros, queue->nextSequence++, type, node, transmission};
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!simEvent_before(&event, &queue->heap[parent])) break;
+    queue->heap[i] = queue->heap[parent];
+    i = parent;
+  }
+  queue->heap[i] = event;
+  return true;
+}
+
+static bool simQueue_pop(SimEventQueue* queue, SimEvent* out) {
+  if (queue->count == 0) return false;
+  
+  *out = queue->heap[0];
+  SimEvent last = queue->heap[--queue->count];
+  int i = 0;
+  while (true) {
+    int child = 2 * i + 1;
+    if (child >= queue->count) break;
+    if (child + 1 < queue->count && simEvent_before(&queue->heap[child + 1], &queue->heap[child])) child++;
+    if (!simEvent_before(&queue->heap[child], &last)) break;
+    queue->heap[i] = queue->heap[child];
+    i = child;
+  }
+  queue->heap[i] = last;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Medium
+// ----------------------------------------------------------------------------
+
+static void simMedium_init(SimMedium* medium, const SimMediumConfig* config, uint64_t seed) {
+  memset(medium, 0, sizeof(SimMedium));
+  medium->config = *config;
+  medium->lastTransmission = -1;
+  medium->rngState = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+// Time on air: 802.11 preamble/header plus vendor-action framing plus payload
+static inline int64_t simMedium_airtimeUs(const SimMedium* medium, int len) {
+  const int overheadBytes = 43;
+  return 50 + (int64_t)((len + overheadBytes) * 8 / medium->config.bitRateMbps);
+}
+
+// Puts a frame on the air; returns its transmission slot, or -1 if the pool is full.
+// *endMicros is set to when the frame leaves the air.
+static int simMedium_transmit(SimMedium* medium, int64_t nowMicros, const uint8_t* srcMAC,
+                              const uint8_t* data, int len, int64_t* endMicros) {
+  int slot = -1;
+  for (int i = 0; i < SIM_MAX_TRANSMISSIONS; i++) {
+    int candidate = (medium->nextTransmission + i) % SIM_MAX_TRANSMISSIONS;
+    if (medium->transmissions[candidate].pendingDeliveries == 0) {
+      slot = candidate;
+      break;
+    }
+  }
+  if (slot < 0 || len > SIM_MAX_FRAME_LEN) return -1;
+  medium->nextTransmission = (slot + 1) % SIM_MAX_TRANSMISSIONS;
+  
+  SimTransmission* tx = &medium->transmissions[slot];
+  memcpy(tx->srcMAC, srcMAC, 6);
+  memcpy(tx->data, data, len);
+  tx->len = len;
+  tx->collided = false;
+  tx->pendingDeliveries = 0;
+  tx->ackNode = -1;
+  tx->ackLinkOk = false;
+  
+  // Carrier sense happens when the backoff expires. Starting within the
+  // collision window of the previous frame means neither sender could hear
+  // the other; later than that, a busy medium defers us until it goes idle.
+  int64_t start = nowMicros + simRandom_range(&medium->rngState, 0, medium->config.backoffMaxUs);
+  if (medium->lastTransmission >= 0) {
+    SimTransmission* previous = &medium->transmissions[medium->lastTransmission];
+    int64_t gap = start - previous->startMicros;
+    if (gap < 0) gap = -gap;
+    if (gap < medium->config.collisionWindowUs) {
+      if (!previous->collided) medium->framesCollided++;
+      previous->collided = true;
+      tx->collided = true;
+      medium->framesCollided++;
+    } else if (start < medium->mediumFreeAt) {
+      start = medium->mediumFreeAt + simRandom_range(&medium->rngState, 0, medium->config.backoffMaxUs);
+    }
+  }
+  tx->startMicros = start;
+  
+  int64_t end = start + simMedium_airtimeUs(medium, len);
+  if (end > medium->mediumFreeAt) medium->mediumFreeAt = end;
+  medium->lastTransmission = slot;
+  medium->framesSent++;
+  
+  *endMicros = end;
+  return slot;
+}
+
+// Per-receiver fate of a transmission: returns false if lost, else the delivery time
+static bool simMedium_linkDelivery(SimMedium* medium, int64_t endMicros, int64_t* deliverAt) {
+  if (simRandom_unit(&medium->rngState) < medium->config.lossProbability) {
+    medium->deliveriesLost++;
+    return false;
+  }
+  *deliverAt = endMicros + medium->config.baseDelayUs +
+               simRandom_range(&medium->rngState, 0, medium->config.jitterUs);
+  return true;
+}
+
+#endif // SIM_MEDIUM_H
@@ -0,0 +1,830 @@
+// Multi-node discrete-event simulator for pairing and pedal-event latency.
+//
+// Runs many instances of the real receiver modules (TransmitterManager,
+// ReceiverPairingService, KeyboardService, Persistence) and FireBeetle 2
+// transmitter modules (PairingState, PedalReader, PairingService, PedalService)
+// against the lossy shared medium in SimMedium.h. The per-message dispatch
+// mirrors onMessageReceived() in receiver.ino and firebeetle2.ino.
+//
+//   g++ -std=c++17 -O2 -DHAL_HOST -o radio_sim esp32/host/sim/radio_sim.cpp
+//   ./radio_sim --scenario=room|reboot|replacement [--seed=N] [--loss=0.02]
+//               [--delay-us=300] [--jitter-us=500] [--collision-us=9]
+//               [--duration-s=S] [--receivers=N] [--pedals=N]
+//               [--debounce=eager|deferred]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../shared/hal/host/HalHost.cpp"
+#include "../../receiver/domain/TransmitterManager.h"
+// Receivers and transmitters share one tracker type here: give it the receiver's peer table
+#define SEND_TRACKER_MAX_PEERS (MAX_TRANSMITTERS + 1)
+#include "../../shared/EspNowSendTracker.cpp"
+#include "../../shared/PedalEventQueue.cpp"
+
+// Receiver modules (receiver.ino without LED and debug monitor)
+#include "../../receiver/domain/TransmitterManager.cpp"
+#include "../../receiver/domain/MacroEngine.cpp"
+#include "../../receiver/domain/SocdResolver.cpp"
+#include "../../receiver/infrastructure/EspNowTransport.cpp"
+#include "../../receiver/infrastructure/Persistence.cpp"
+#include "../../receiver/application/PairingService.cpp"
+#include "../../receiver/application/KeyboardService.cpp"
+
+// Transmitter modules (firebeetle2.ino)
+#include "../../firebeetle2/domain/PairingState.cpp"
+#include "../../shared/PedalReader.cpp"
+#include "../../firebeetle2/infrastructure/EspNowTransport.cpp"
+#include "../../firebeetle2/application/PairingService.cpp"
+#include "../../firebeetle2/application/PedalService.cpp"
+
+#include "../../shared/MessageCodec.h"
+#include "SimMedium.h"
+
+#define SIM_MAX_RECEIVERS 8
+#define SIM_MAX_TRANSMITTERS 32
+#define SIM_MAX_SAMPLES 65536
+
+#define SIM_RECEIVER_LOOP_MS 10               // receiver.ino loop() delay
+#define SIM_RECEIVER_SETUP_MS 2600            // setup() until the receive callback is registered (USB/HID)
+#define SIM_TRANSMITTER_LOOP_PAIRED_MS 20     // firebeetle2.ino IDLE_DELAY_PAIRED
+#define SIM_TRANSMITTER_LOOP_UNPAIRED_MS 200  // firebeetle2.ino IDLE_DELAY_UNPAIRED
+#define SIM_PEDAL_PIN 13
+#define SIM_MS 1000LL
+#define SIM_S 1000000LL
+
+// PedalService expects these from the sketch
+bool debugEnabled = false;
+void debugPrint(const char* format, ...) {
+  (void)format;
+}
+
+typedef enum {
+  SIM_NODE_RECEIVER = 0,
+  SIM_NODE_TRANSMITTER
+} SimNodeKind;
+
+typedef struct {
+  SimNodeKind kind;
+  int index;
+  HalHostNode hal;
+  bool powered;
+  int generation;  // Bumped on power-off so stale ticks are ignored
+  TransmitterManager manager;
+  ReceiverEspNowTransport transport;
+  ReceiverPairingService pairingService;
+  KeyboardService keyboardService;
+} SimReceiver;
+
+typedef struct {
+  SimNodeKind kind;
+  int index;
+  HalHostNode hal;
+  bool powered;
+  int generation;
+  PairingState pairingState;
+  PedalReader reader;
+  EspNowTransport transport;
+  PairingService pairingService;
+  PedalService pedalService;
+  unsigned long lastActivityTime;
+
+  int64_t bootMicros;
+  int64_t pairedMicros;         // First time paired since boot, -1 if never
+  int64_t pendingPressMicros;   // Switch edge not yet seen as HID press, -1 if none
+  int64_t pendingReleaseMicros;
+  int presses;
+  int pressesDelivered;
+  int releases;
+  int releasesDelivered;
+  int64_t pressesUntilMicros;
+} SimTransmitter;
+
+typedef struct {
+  SimMedium medium;
+  SimEventQueue queue;
+  SimReceiver receivers[SIM_MAX_RECEIVERS];
+  int receiverCount;
+  SimTransmitter transmitters[SIM_MAX_TRANSMITTERS];
+  int transmitterCount;
+  uint64_t rngState;
+  int64_t endMicros;
+  uint8_t debouncePolicy;
+  int deliveringFrom;  // Transmitter whose frame is being delivered, -1 otherwise
+  int acked;           // Unicast send callbacks reporting delivered
+  int unacked;         // ...and failed
+
+  int64_t pressLatencies[SIM_MAX_SAMPLES];
+  int pressLatencyCount;
+  int64_t releaseLatencies[SIM_MAX_SAMPLES];
+  int releaseLatencyCount;
+} Simulator;
+
+typedef struct {
+  const char* scenario;
+  uint64_t seed;
+  SimMediumConfig medium;
+  int64_t durationMicros;
+  int receivers;
+  int pedals;
+  uint8_t debouncePolicy;
+} SimOptions;
+
+static Simulator g_sim;
+
+// ----------------------------------------------------------------------------
+// Node helpers
+// ----------------------------------------------------------------------------
+
+static void sim_makeMAC(uint8_t* mac, uint8_t kind, int index) {
+  uint8_t value[6] = {0x02, 0x51, 0x4D, kind, (uint8_t)(index >> 8), (uint8_t)index};
+  memcpy(mac, value, 6);
+}
+
+static SimTransmitter* sim_findTransmitter(const uint8_t* mac) {
+  for (int i = 0; i < g_sim.transmitterCount; i++) {
+    if (memcmp(g_sim.transmitters[i].hal.mac, mac, 6) == 0) return &g_sim.transmitters[i];
+  }
+  return nullptr;
+}
+
+static SimReceiver* sim_findReceiver(const uint8_t* mac) {
+  for (int i = 0; i < g_sim.receiverCount; i++) {
+    if (memcmp(g_sim.receivers[i].hal.mac, mac, 6) == 0) return &g_sim.receivers[i];
+  }
+  return nullptr;
+}
+
+static void sim_selectReceiver(SimReceiver* rx) {
+  halHost_selectNode(&rx->hal);
+}
+
+// PedalService keeps its instance in file-level statics; point them at this node
+static void sim_selectTransmitter(SimTransmitter* tx) {
+  halHost_selectNode(&tx->hal);
+  g_pedalService = &tx->pedalService;
+  g_pairingService = &tx->pairingService;
+}
+
+static void sim_notePaired(SimTransmitter* tx) {
+  if (tx->pairedMicros < 0 && pairingState_isPaired(&tx->pairingState)) {
+    tx->pairedMicros = halClock_micros();
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Message dispatch (mirrors the sketches' onMessageReceived)
+// ----------------------------------------------------------------------------
+
+static void sim_receiverOnMessage(SimReceiver* rx, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const struct_message* msg = (const struct_message*)data;
+  int transmitterIndex = transmitterManager_findIndex(&rx->manager, senderMAC);
+  receiverPairingService_noteFrame(&rx->pairingService, transmitterIndex);
+
+  switch (messageCodec_validate(data, len)) {
+    case MSG_PEDAL_SNAPSHOT:
+      keyboardService_handlePedalSnapshot(&rx->keyboardService, transmitterIndex, (const pedal_snapshot_message*)data);
+      break;
+    case MSG_TRANSMITTER_ONLINE:
+      receiverPairingService_handleTransmitterOnline(&rx->pairingService, senderMAC, transmitterIndex,
+                                                     messageCodec_peerProtocol(data, len), channel);
+      break;
+    case MSG_TRANSMITTER_PAIRED:
+      receiverPairingService_handleTransmitterPaired(&rx->pairingService, transmitterIndex,
+                                                     (const transmitter_paired_message*)data);
+      break;
+    case MSG_DELETE_RECORD:
+      if (transmitterIndex >= 0) {
+        transmitterManager_remove(&rx->manager, transmitterIndex);
+        persistence_save(&rx->manager);
+      }
+      break;
+    case MSG_DISCOVERY_REQ:
+      receiverPairingService_handleDiscoveryRequest(&rx->pairingService, senderMAC, transmitterIndex, msg->pedalMode,
+                                                    messageCodec_peerProtocol(data, len), channel, halClock_millis());
+      persistence_save(&rx->manager);
+      break;
+    case MSG_PEDAL_EVENT:
+      keyboardService_handlePedalEvent(&rx->keyboardService, transmitterIndex, msg, len);
+      break;
+    case MSG_ALIVE:
+      receiverPairingService_handleAlive(&rx->pairingService, transmitterIndex);
+      break;
+  }
+  keyboardService_flush(&rx->keyboardService);
+}
+
+static void sim_transmitterOnMessage(SimTransmitter* tx, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  int msgType = messageCodec_validate(data, len);
+  if (msgType == MSG_BEACON) {
+    pairingService_handleBeacon(&tx->pairingService, senderMAC, (const beacon_message*)data);
+    return;
+  }
+  if (msgType != MSG_ALIVE && msgType != MSG_DISCOVERY_RESP) return;
+
+  PeerProtocol receiver = messageCodec_peerProtocol(data, len);
+  if (pairingState_isPaired(&tx->pairingState)) {
+    if (memcmp(senderMAC, tx->pairingState.pairedReceiverMAC, 6) != 0) {
+      espNowTransport_addPeer(&tx->transport, senderMAC, channel);
+      struct_message deleteMsg = {MSG_DELETE_RECORD, 0, false, 0, 0};
+      espNowTransport_post(&tx->transport, senderMAC, (uint8_t*)&deleteMsg, sizeof(deleteMsg));
+    } else if (msgType == MSG_ALIVE) {
+      pairingService_handleAlive(&tx->pairingService, senderMAC, receiver, channel);
+    }
+  } else if (msgType == MSG_DISCOVERY_RESP) {
+    pairingService_handleDiscoveryResponse(&tx->pairingService, senderMAC, receiver, channel);
+  } else {
+    pairingService_handleAlive(&tx->pairingService, senderMAC, receiver, channel);
+  }
+  sim_notePaired(tx);
+}
+
+static void sim_onReceive(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  SimNodeKind kind = *(SimNodeKind*)halHost_currentNode()->userData;
+  if (kind == SIM_NODE_RECEIVER) {
+    SimReceiver* rx = (SimReceiver*)halHost_currentNode()->userData;
+    sim_selectReceiver(rx);
+    sim_receiverOnMessage(rx, senderMAC, data, len, channel);
+  } else {
+    SimTransmitter* tx = (SimTransmitter*)halHost_currentNode()->userData;
+    sim_selectTransmitter(tx);
+    sim_transmitterOnMessage(tx, senderMAC, data, len, channel);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Medium and HID hooks
+// ----------------------------------------------------------------------------
+
+// Returns false if the link dropped the frame
+static bool sim_scheduleDelivery(HalHostNode* node, int nodeId, int slot, int64_t endMicros) {
+  int64_t deliverAt;
+  if (!simMedium_linkDelivery(&g_sim.medium, endMicros, &deliverAt)) return false;
+  if (simQueue_push(&g_sim.queue, deliverAt, SIM_EVENT_DELIVER, nodeId, slot)) {
+    g_sim.medium.transmissions[slot].pendingDeliveries++;
+  }
+  (void)node;
+  return true;
+}
+
+static int sim_nodeId(const HalHostNode* node) {
+  for (int i = 0; i < g_sim.receiverCount; i++) {
+    if (&g_sim.receivers[i].hal == node) return i;
+  }
+  for (int i = 0; i < g_sim.transmitterCount; i++) {
+    if (&g_sim.transmitters[i].hal == node) return g_sim.receiverCount + i;
+  }
+  return -1;
+}
+
+static HalHostNode* sim_node(int nodeId) {
+  if (nodeId < g_sim.receiverCount) return &g_sim.receivers[nodeId].hal;
+  return &g_sim.transmitters[nodeId - g_sim.receiverCount].hal;
+}
+
+static bool sim_onSend(void* context, HalHostNode* sender, const uint8_t* dstMAC, const uint8_t* data, int len) {
+  (void)context;
+  static const uint8_t broadcastMAC[6] = BROADCAST_MAC;
+  bool broadcast = memcmp(dstMAC, broadcastMAC, 6) == 0;
+
+  int64_t endMicros;
+  int slot = simMedium_transmit(&g_sim.medium, halClock_micros(), sender->mac, data, len, &endMicros);
+  if (slot < 0) return false;
+  SimTransmission* transmission = &g_sim.medium.transmissions[slot];
+  memcpy(transmission->dstMAC, dstMAC, 6);
+
+  // Node ids: receivers first, then transmitters
+  int nodeCount = g_sim.receiverCount + g_sim.transmitterCount;
+  for (int i = 0; i < nodeCount; i++) {
+    HalHostNode* node = sim_node(i);
+    if (node == sender) continue;
+    if (broadcast) {
+      sim_scheduleDelivery(node, i, slot, endMicros);
+    } else if (memcmp(dstMAC, node->mac, 6) == 0) {
+      transmission->ackNode = i;
+      transmission->ackLinkOk = sim_scheduleDelivery(node, i, slot, endMicros);
+    }
+  }
+
+  // Unicast frames report back through the sender's send callback
+  if (!broadcast && simQueue_push(&g_sim.queue, endMicros + g_sim.medium.config.ackDelayUs,
+                                  SIM_EVENT_SEND_DONE, sim_nodeId(sender), slot)) {
+    transmission->pendingDeliveries++;
+  }
+  return true;
+}
+
+static void sim_onHid(void* context, HalHostNode* node, const HalHostHidEvent* event) {
+  (void)context;
+  (void)node;
+  if (g_sim.deliveringFrom < 0) return;
+
+  SimTransmitter* tx = &g_sim.transmitters[g_sim.deliveringFrom];
+  if (event->pressed && tx->pendingPressMicros >= 0) {
+    if (g_sim.pressLatencyCount < SIM_MAX_SAMPLES) {
+      g_sim.pressLatencies[g_sim.pressLatencyCount++] = event->timeMicros - tx->pendingPressMicros;
+    }
+    tx->pendingPressMicros = -1;
+    tx->pressesDelivered++;
+  } else if (!event->pressed && tx->pendingReleaseMicros >= 0) {
+    if (g_sim.releaseLatencyCount < SIM_MAX_SAMPLES) {
+      g_sim.releaseLatencies[g_sim.releaseLatencyCount++] = event->timeMicros - tx->pendingReleaseMicros;
+    }
+    tx->pendingReleaseMicros = -1;
+    tx->releasesDelivered++;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Node lifecycle (mirrors the sketches' setup() and loop())
+// ----------------------------------------------------------------------------
+
+static void sim_receiverBoot(SimReceiver* rx) {
+  sim_selectReceiver(rx);
+  rx->hal.asleep = false;
+  rx->powered = true;
+
+  // Grace period counts from the start of setup(), before USB/HID enumeration
+  unsigned long bootTime = halClock_millis() - SIM_RECEIVER_SETUP_MS;
+
+  transmitterManager_init(&rx->manager);
+  receiverEspNowTransport_init(&rx->transport);
+  persistence_load(&rx->manager);
+  receiverPairingService_init(&rx->pairingService, &rx->manager, &rx->transport, bootTime);
+  keyboardService_init(&rx->keyboardService, &rx->manager);
+  receiverEspNowTransport_registerReceiveCallback(&rx->transport, sim_onReceive);
+
+  uint8_t broadcastMAC[] = BROADCAST_MAC;
+  receiverEspNowTransport_addPeer(&rx->transport, broadcastMAC, 0);
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (rx->manager.transmitters[i].paired) {
+      receiverEspNowTransport_addPeer(&rx->transport, rx->manager.transmitters[i].mac, 0);
+    }
+  }
+
+  simQueue_push(&g_sim.queue, halClock_micros(), SIM_EVENT_RECEIVER_TICK, rx->index, rx->generation);
+}
+
+static void sim_receiverPowerOff(SimReceiver* rx) {
+  rx->powered = false;
+  rx->hal.asleep = true;
+  rx->generation++;
+}
+
+static void sim_receiverTick(SimReceiver* rx, int generation) {
+  if (!rx->powered || generation != rx->generation) return;
+
+  sim_selectReceiver(rx);
+  receiverPairingService_update(&rx->pairingService, halClock_millis());
+  keyboardService_update(&rx->keyboardService, halClock_millis());
+  keyboardService_flush(&rx->keyboardService);
+  simQueue_push(&g_sim.queue, halClock_micros() + SIM_RECEIVER_LOOP_MS * SIM_MS,
+                SIM_EVENT_RECEIVER_TICK, rx->index, rx->generation);
+}
+
+static void sim_transmitterBoot(SimTransmitter* tx) {
+  sim_selectTransmitter(tx);
+  tx->hal.asleep = false;
+  tx->powered = true;
+  tx->bootMicros = halClock_micros();
+  tx->pairedMicros = -1;
+  tx->pendingPressMicros = -1;
+  tx->pendingReleaseMicros = -1;
+  halHost_setPin(SIM_PEDAL_PIN, HAL_GPIO_HIGH);
+
+  unsigned long bootTime = halClock_millis();
+  tx->lastActivityTime = bootTime;
+
+  pairingState_init(&tx->pairingState);
+  pedalReader_init(&tx->reader, SIM_PEDAL_PIN, SIM_PEDAL_PIN + 1, 1);
+  pedalReader_setDebouncePolicy(&tx->reader, 0, g_sim.debouncePolicy, DEBOUNCE_LOCKOUT);
+  pedalReader_enableInterruptCapture(&tx->reader);
+  espNowTransport_init(&tx->transport);
+
+  uint8_t broadcastMAC[] = BROADCAST_MAC;
+  espNowTransport_addPeer(&tx->transport, broadcastMAC, 0);
+  espNowTransport_registerReceiveCallback(&tx->transport, sim_onReceive);
+
+  pairingService_init(&tx->pairingService, &tx->pairingState, &tx->transport, 1, bootTime);
+  pedalService_init(&tx->pedalService, &tx->reader, &tx->pairingState, &tx->transport, &tx->lastActivityTime, bootTime);
+  pedalService_setPairingService(&tx->pairingService);
+
+  pairingService_broadcastOnline(&tx->pairingService);
+  tx->hal.wakePending = false;
+
+  simQueue_push(&g_sim.queue, halClock_micros(), SIM_EVENT_TRANSMITTER_TICK, tx->index, tx->generation);
+}
+
+static void sim_transmitterPowerOff(SimTransmitter* tx) {
+  tx->powered = false;
+  tx->hal.asleep = true;
+  tx->generation++;
+}
+
+static void sim_transmitterTick(SimTransmitter* tx, int generation) {
+  if (!tx->powered || generation != tx->generation) return;
+
+  sim_selectTransmitter(tx);
+  espNowTransport_flush(&tx->transport);
+  pairingService_checkDiscoveryTimeout(&tx->pairingService, halClock_millis());
+  pairingService_checkOnline(&tx->pairingService, halClock_millis());
+  pedalService_update(&tx->pedalService);
+  sim_notePaired(tx);
+
+  unsigned long idleDelay = pairingState_isPaired(&tx->pairingState) ? SIM_TRANSMITTER_LOOP_PAIRED_MS
+                                                                      : SIM_TRANSMITTER_LOOP_UNPAIRED_MS;
+  int64_t delayMs = pedalReader_idleTimeout(&tx->reader, idleDelay);
+  simQueue_push(&g_sim.queue, halClock_micros() + delayMs * SIM_MS,
+                SIM_EVENT_TRANSMITTER_TICK, tx->index, tx->generation);
+}
+
+// An edge ISR or a failed send cut the loop() idle short: replace the pending tick with one now
+static void sim_wakeTransmitter(SimTransmitter* tx) {
+  if (!tx->hal.wakePending) return;
+  tx->hal.wakePending = false;
+  tx->generation++;
+  simQueue_push(&g_sim.queue, halClock_micros(), SIM_EVENT_TRANSMITTER_TICK, tx->index, tx->generation);
+}
+
+// A player stepping on the pedal: press, hold, release, pause, repeat
+static void sim_pedalDown(SimTransmitter* tx) {
+  if (!tx->powered) return;
+
+  sim_selectTransmitter(tx);
+  halHost_setPin(SIM_PEDAL_PIN, HAL_GPIO_LOW);
+  sim_wakeTransmitter(tx);
+  if (pairingState_isPaired(&tx->pairingState)) {
+    tx->presses++;
+    tx->pendingPressMicros = halClock_micros();
+  }
+
+  // A player pairing a pedal holds it down deliberately
+  int64_t hold = pairingState_isPaired(&tx->pairingState)
+                     ? simRandom_range(&g_sim.rngState, 60 * SIM_MS, 160 * SIM_MS)
+                     : simRandom_range(&g_sim.rngState, 500 * SIM_MS, 900 * SIM_MS);
+  simQueue_push(&g_sim.queue, halClock_micros() + hold, SIM_EVENT_PEDAL_UP, tx->index, 0);
+}
+
+static void sim_pedalUp(SimTransmitter* tx) {
+  if (!tx->powered) return;
+
+  sim_selectTransmitter(tx);
+  halHost_setPin(SIM_PEDAL_PIN, HAL_GPIO_HIGH);
+  sim_wakeTransmitter(tx);
+  if (pairingState_isPaired(&tx->pairingState)) {
+    tx->releases++;
+    tx->pendingReleaseMicros = halClock_micros();
+  }
+
+  int64_t pause = simRandom_range(&g_sim.rngState, 200 * SIM_MS, 800 * SIM_MS);
+  int64_t next = halClock_micros() + pause;
+  if (next < tx->pressesUntilMicros) {
+    simQueue_push(&g_sim.queue, next, SIM_EVENT_PEDAL_DOWN, tx->index, 0);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Setup and main loop
+// ----------------------------------------------------------------------------
+
+static void sim_init(const SimOptions* options) {
+  memset(&g_sim, 0, sizeof(g_sim));
+  simQueue_init(&g_sim.queue);
+  simMedium_init(&g_sim.medium, &options->medium, options->seed);
+  g_sim.rngState = options->seed * 0x9E3779B97F4A7C15ULL + 1;
+  g_sim.endMicros = options->durationMicros;
+  g_sim.debouncePolicy = options->debouncePolicy;
+  g_sim.deliveringFrom = -1;
+
+  halHost_setDelayAdvancesClock(false);
+  halHost_setLogEnabled(false);
+  halHost_setMicros(0);
+  halHost_setSendHook(sim_onSend, nullptr);
+  halHost_setHidHook(sim_onHid, nullptr);
+}
+
+static SimReceiver* sim_addReceiver(int64_t bootMicros) {
+  SimReceiver* rx = &g_sim.receivers[g_sim.receiverCount];
+  rx->kind = SIM_NODE_RECEIVER;
+  rx->index = g_sim.receiverCount++;
+  uint8_t mac[6];
+  sim_makeMAC(mac, 0xA0, rx->index);
+  halHost_initNode(&rx->hal, mac);
+  rx->hal.userData = rx;
+  rx->hal.asleep = true;
+  rx->hal.deferSendCompletion = true;
+  simQueue_push(&g_sim.queue, bootMicros, SIM_EVENT_RECEIVER_BOOT, rx->index, 0);
+  return rx;
+}
+
+static SimTransmitter* sim_addTransmitter(int64_t bootMicros, int64_t firstPressMicros, int64_t pressesUntilMicros) {
+  SimTransmitter* tx = &g_sim.transmitters[g_sim.transmitterCount];
+  tx->kind = SIM_NODE_TRANSMITTER;
+  tx->index = g_sim.transmitterCount++;
+  uint8_t mac[6];
+  sim_makeMAC(mac, 0xB0, tx->index);
+  halHost_initNode(&tx->hal, mac);
+  tx->hal.userData = tx;
+  tx->hal.asleep = true;
+  tx->hal.deferSendCompletion = true;
+  tx->pairedMicros = -1;
+  tx->pendingPressMicros = -1;
+  tx->pendingReleaseMicros = -1;
+  tx->pressesUntilMicros = pressesUntilMicros;
+  simQueue_push(&g_sim.queue, bootMicros, SIM_EVENT_TRANSMITTER_BOOT, tx->index, 0);
+  if (firstPressMicros >= 0) {
+    simQueue_push(&g_sim.queue, firstPressMicros, SIM_EVENT_PEDAL_DOWN, tx->index, 0);
+  }
+  return tx;
+}
+
+static void sim_deliver(const SimEvent* event) {
+  SimTransmission* transmission = &g_sim.medium.transmissions[event->transmission];
+  transmission->pendingDeliveries--;
+  if (transmission->collided) return;
+  g_sim.medium.deliveries++;
+
+  HalHostNode* node;
+  if (event->node < g_sim.receiverCount) {
+    node = &g_sim.receivers[event->node].hal;
+    SimTransmitter* from = sim_findTransmitter(transmission->srcMAC);
+    g_sim.deliveringFrom = from ? from->index : -1;
+  } else {
+    node = &g_sim.transmitters[event->node - g_sim.receiverCount].hal;
+    g_sim.deliveringFrom = -1;
+  }
+
+  halHost_deliver(node, transmission->srcMAC, transmission->data, transmission->len, 1);
+  g_sim.deliveringFrom = -1;
+}
+
+static void sim_sendDone(const SimEvent* event) {
+  SimTransmission* transmission = &g_sim.medium.transmissions[event->transmission];
+  transmission->pendingDeliveries--;
+  bool delivered = transmission->ackLinkOk && !transmission->collided &&
+                   transmission->ackNode >= 0 && !sim_node(transmission->ackNode)->asleep;
+  if (delivered) g_sim.acked++;
+  else g_sim.unacked++;
+
+  if (event->node < g_sim.receiverCount) {
+    sim_selectReceiver(&g_sim.receivers[event->node]);
+    halHost_completeSend(sim_node(event->node), transmission->dstMAC, delivered);
+  } else {
+    SimTransmitter* tx = &g_sim.transmitters[event->node - g_sim.receiverCount];
+    sim_selectTransmitter(tx);
+    halHost_completeSend(sim_node(event->node), transmission->dstMAC, delivered);
+    sim_wakeTransmitter(tx);  // A failed frame is resent from loop()
+  }
+}
+
+// Runs every event due by untilMicros; later ones stay queued for the next call
+static void sim_runUntil(int64_t untilMicros) {
+  SimEvent event;
+  while (g_sim.queue.count > 0 && g_sim.queue.heap[0].timeMicros <= untilMicros) {
+    simQueue_pop(&g_sim.queue, &event);
+    halHost_setMicros(event.timeMicros);
+
+    switch (event.type) {
+      case SIM_EVENT_DELIVER: sim_deliver(&event); break;
+      case SIM_EVENT_SEND_DONE: sim_sendDone(&event); break;
+      case SIM_EVENT_RECEIVER_TICK: sim_receiverTick(&g_sim.receivers[event.node], event.transmission); break;
+      case SIM_EVENT_TRANSMITTER_TICK: sim_transmitterTick(&g_sim.transmitters[event.node], event.transmission); break;
+      case SIM_EVENT_PEDAL_DOWN: sim_pedalDown(&g_sim.transmitters[event.node]); break;
+      case SIM_EVENT_PEDAL_UP: sim_pedalUp(&g_sim.transmitters[event.node]); break;
+      case SIM_EVENT_RECEIVER_BOOT: sim_receiverBoot(&g_sim.receivers[event.node]); break;
+      case SIM_EVENT_RECEIVER_POWER_OFF: sim_receiverPowerOff(&g_sim.receivers[event.node]); break;
+      case SIM_EVENT_TRANSMITTER_BOOT: sim_transmitterBoot(&g_sim.transmitters[event.node]); break;
+      case SIM_EVENT_TRANSMITTER_POWER_OFF: sim_transmitterPowerOff(&g_sim.transmitters[event.node]); break;
+    }
+  }
+}
+
+static void sim_run() {
+  sim_runUntil(g_sim.endMicros);
+}
+
+// ----------------------------------------------------------------------------
+// Reporting
+// ----------------------------------------------------------------------------
+
+static int sim_compareInt64(const void* a, const void* b) {
+  int64_t x = *(const int64_t*)a;
+  int64_t y = *(const int64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void sim_printPercentiles(const char* label, int64_t* samples, int count) {
+  if (count == 0) {
+    printf("  %-22s no samples\n", label);
+    return;
+  }
+  qsort(samples, count, sizeof(int64_t), sim_compareInt64);
+  printf("  %-22s n=%-6d p50=%6.2f ms  p90=%6.2f ms  p99=%6.2f ms  max=%6.2f ms\n", label, count,
+         samples[count / 2] / 1000.0, samples[(count * 9) / 10] / 1000.0,
+         samples[(count * 99) / 100] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+static const char* sim_receiverName(const uint8_t* mac, char* buffer, size_t size) {
+  SimReceiver* rx = sim_findReceiver(mac);
+  if (rx) {
+    snprintf(buffer, size, "rx%d", rx->index);
+  } else {
+    snprintf(buffer, size, "-");
+  }
+  return buffer;
+}
+
+static void sim_report() {
+  printf("Medium: %d frames sent, %d collided, %d deliveries, %d lost on link, %d events dropped\n",
+         g_sim.medium.framesSent, g_sim.medium.framesCollided, g_sim.medium.deliveries,
+         g_sim.medium.deliveriesLost, g_sim.queue.dropped);
+  printf("Send callbacks: %d unicast frames acknowledged, %d failed\n", g_sim.acked, g_sim.unacked);
+
+  printf("Receivers:\n");
+  for (int i = 0; i < g_sim.receiverCount; i++) {
+    SimReceiver* rx = &g_sim.receivers[i];
+    printf("  rx%d: %s, slots %d/%d, transmitters:", i, rx->powered ? "on " : "off",
+           rx->manager.slotsUsed, MAX_PEDAL_SLOTS);
+    for (int t = 0; t < MAX_TRANSMITTERS; t++) {
+      if (!rx->manager.transmitters[t].paired) continue;
+      SimTransmitter* tx = sim_findTransmitter(rx->manager.transmitters[t].mac);
+      printf(" tx%d", tx ? tx->index : -1);
+    }
+    int held = 0;
+    for (int k = 0; k < 256; k++) held += rx->keyboardService.keysPressed[k] ? 1 : 0;
+    printf("%s\n", held ? " (keys held at end)" : "");
+  }
+
+  printf("Transmitters:\n");
+  int64_t pairTimes[SIM_MAX_TRANSMITTERS];
+  int pairedCount = 0;
+  int presses = 0, pressesDelivered = 0, releases = 0, releasesDelivered = 0;
+  for (int i = 0; i < g_sim.transmitterCount; i++) {
+    SimTransmitter* tx = &g_sim.transmitters[i];
+    char name[8];
+    if (tx->pairedMicros >= 0) {
+      pairTimes[pairedCount++] = tx->pairedMicros - tx->bootMicros;
+      printf("  tx%-2d paired with %-4s after %7.2f s, presses %d/%d, releases %d/%d delivered\n", i,
+             sim_receiverName(tx->pairingState.pairedReceiverMAC, name, sizeof(name)),
+             (tx->pairedMicros - tx->bootMicros) / (double)SIM_S,
+             tx->pressesDelivered, tx->presses, tx->releasesDelivered, tx->releases);
+    } else {
+      printf("  tx%-2d never paired%s\n", i, tx->powered ? "" : " (powered off)");
+    }
+    presses += tx->presses;
+    pressesDelivered += tx->pressesDelivered;
+    releases += tx->releases;
+    releasesDelivered += tx->releasesDelivered;
+  }
+
+  printf("Pairing: %d/%d transmitters paired\n", pairedCount, g_sim.transmitterCount);
+  sim_printPercentiles("time-to-pair", pairTimes, pairedCount);
+  printf("Pedal events: presses %d/%d delivered, releases %d/%d delivered\n",
+         pressesDelivered, presses, releasesDelivered, releases);
+  sim_printPercentiles("press -> HID", g_sim.pressLatencies, g_sim.pressLatencyCount);
+  sim_printPercentiles("release -> HID", g_sim.releaseLatencies, g_sim.releaseLatencyCount);
+}
+
+// ----------------------------------------------------------------------------
+// Scenarios
+// ----------------------------------------------------------------------------
+
+// Several receivers and their pedals in one room, all booting together
+static void sim_scenarioRoom(const SimOptions* options) {
+  for (int i = 0; i < options->receivers; i++) {
+    sim_addReceiver(SIM_RECEIVER_SETUP_MS * SIM_MS + simRandom_range(&g_sim.rngState, 0, 1 * SIM_S));
+  }
+  for (int i = 0; i < options->pedals; i++) {
+    int64_t boot = simRandom_range(&g_sim.rngState, 1 * SIM_S, 6 * SIM_S);
+    int64_t firstPress = boot + simRandom_range(&g_sim.rngState, 1 * SIM_S, 4 * SIM_S);
+    sim_addTransmitter(boot, firstPress, options->durationMicros);
+  }
+  sim_run();
+  sim_report();
+}
+
+// One receiver, two pedals; the receiver power-cycles mid-session
+static void sim_scenarioReboot(const SimOptions* options) {
+  const int64_t rebootAt = 40 * SIM_S;
+  const int64_t rebootDowntime = 500 * SIM_MS;
+
+  sim_addReceiver(SIM_RECEIVER_SETUP_MS * SIM_MS);
+  for (int i = 0; i < 2; i++) {
+    int64_t boot = (1 + i) * SIM_S;
+    sim_addTransmitter(boot, boot + 2 * SIM_S, options->durationMicros);
+  }
+  simQueue_push(&g_sim.queue, rebootAt, SIM_EVENT_RECEIVER_POWER_OFF, 0, 0);
+  simQueue_push(&g_sim.queue, rebootAt + rebootDowntime + SIM_RECEIVER_SETUP_MS * SIM_MS,
+                SIM_EVENT_RECEIVER_BOOT, 0, 0);
+
+  sim_run();
+  printf("Receiver rx0 off at %.1f s, listening again at %.1f s\n", rebootAt / (double)SIM_S,
+         (rebootAt + rebootDowntime + SIM_RECEIVER_SETUP_MS * SIM_MS) / (double)SIM_S);
+  sim_report();
+}
+
+// A full receiver loses one pedal for good; a new pedal boots and announces itself
+// with MSG_TRANSMITTER_ONLINE, which should replace the dead one and leave the
+// others where they were. Returns whether all of that happened.
+static bool sim_scenarioReplacement(const SimOptions* options) {
+  const int64_t deadAt = 45 * SIM_S;
+  const int64_t newPedalAt = 50 * SIM_S;
+
+  SimReceiver* rx = sim_addReceiver(SIM_RECEIVER_SETUP_MS * SIM_MS);
+  SimTransmitter* survivors[MAX_PEDAL_SLOTS - 1];
+  for (int i = 0; i < MAX_PEDAL_SLOTS - 1; i++) {
+    int64_t boot = SIM_S + i * 200 * SIM_MS;
+    survivors[i] = sim_addTransmitter(boot, boot + 2 * SIM_S, options->durationMicros);
+  }
+  SimTransmitter* dead = sim_addTransmitter(SIM_S + MAX_PEDAL_SLOTS * 200 * SIM_MS, 7 * SIM_S, deadAt);
+  SimTransmitter* replacement = sim_addTransmitter(newPedalAt, newPedalAt + 1 * SIM_S, options->durationMicros);
+  simQueue_push(&g_sim.queue, deadAt, SIM_EVENT_TRANSMITTER_POWER_OFF, dead->index, 0);
+
+  // Each survivor's ID once the receiver is full, before the dead pedal goes
+  sim_runUntil(deadAt - SIM_S);
+  int survivorIds[MAX_PEDAL_SLOTS - 1];
+  for (int i = 0; i < MAX_PEDAL_SLOTS - 1; i++) {
+    survivorIds[i] = transmitterManager_findIndex(&rx->manager, survivors[i]->hal.mac);
+  }
+  int deadId = transmitterManager_findIndex(&rx->manager, dead->hal.mac);
+
+  sim_run();
+  sim_report();
+
+  bool survivorKept = true;
+  for (int i = 0; i < MAX_PEDAL_SLOTS - 1; i++) {
+    int id = transmitterManager_findIndex(&rx->manager, survivors[i]->hal.mac);
+    survivorKept &= id >= 0 && id == survivorIds[i];
+  }
+  bool deadRemoved = transmitterManager_findIndex(&rx->manager, dead->hal.mac) < 0;
+  bool replacementAdded = deadId >= 0 && transmitterManager_findIndex(&rx->manager, replacement->hal.mac) == deadId;
+  bool replacementPaired = pairingState_isPaired(&replacement->pairingState) &&
+                           memcmp(replacement->pairingState.pairedReceiverMAC, rx->hal.mac, 6) == 0;
+  printf("Replacement flow: %d survivors %s, dead pedal %s, new pedal %s on receiver and %s\n", MAX_PEDAL_SLOTS - 1,
+         survivorKept ? "kept their IDs" : "MOVED OR REMOVED", deadRemoved ? "removed" : "STILL LISTED",
+         replacementAdded ? "added in its place" : "NOT IN ITS PLACE", replacementPaired ? "paired" : "NOT PAIRED");
+  return survivorKept && deadRemoved && replacementAdded && replacementPaired;
+}
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  SimOptions options;
+  options.scenario = "room";
+  options.seed = 1;
+  options.medium.lossProbability = 0.02;
+  options.medium.baseDelayUs = 300;
+  options.medium.jitterUs = 500;
+  options.medium.backoffMaxUs = 170;     // DIFS + 15 slots
+  options.medium.collisionWindowUs = 9;  // One 802.11 slot
+  options.medium.bitRateMbps = 1.0;      // ESP-NOW default rate
+  options.medium.ackDelayUs = 100;       // SIFS + ACK at the basic rate
+  options.durationMicros = 90 * SIM_S;
+  options.receivers = 4;
+  options.pedals = 12;
+  options.debouncePolicy = DEBOUNCE_POLICY_DEFERRED;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strncmp(arg, "--scenario=", 11) == 0) options.scenario = arg + 11;
+    else if (strncmp(arg, "--seed=", 7) == 0) options.seed = strtoull(arg + 7, nullptr, 10);
+    else if (strncmp(arg, "--loss=", 7) == 0) options.medium.lossProbability = atof(arg + 7);
+    else if (strncmp(arg, "--delay-us=", 11) == 0) options.medium.baseDelayUs = atoll(arg + 11);
+    else if (strncmp(arg, "--jitter-us=", 12) == 0) options.medium.jitterUs = atoll(arg + 12);
+    else if (strncmp(arg, "--collision-us=", 15) == 0) options.medium.collisionWindowUs = atoll(arg + 15);
+    else if (strncmp(arg, "--duration-s=", 13) == 0) options.durationMicros = atoll(arg + 13) * SIM_S;
+    else if (strncmp(arg, "--receivers=", 12) == 0) options.receivers = atoi(arg + 12);
+    else if (strncmp(arg, "--pedals=", 9) == 0) options.pedals = atoi(arg + 9);
+    else if (strcmp(arg, "--debounce=eager") == 0) options.debouncePolicy = DEBOUNCE_POLICY_EAGER;
+    else if (strcmp(arg, "--debounce=deferred") == 0) options.debouncePolicy = DEBOUNCE_POLICY_DEFERRED;
+    else {
+      fprintf(stderr, "Unknown option: %s\n", arg);
+      return 2;
+    }
+  }
+  if (options.receivers < 1 || options.receivers > SIM_MAX_RECEIVERS ||
+      options.pedals < 1 || options.pedals > SIM_MAX_TRANSMITTERS) {
+    fprintf(stderr, "Supports 1-%d receivers and 1-%d pedals\n", SIM_MAX_RECEIVERS, SIM_MAX_TRANSMITTERS);
+    return 2;
+  }
+
+  sim_init(&options);
+  printf("Scenario %s, seed %llu, loss %.1f%%, delay %lld us + jitter %lld us, %s debounce\n", options.scenario,
+         (unsigned long long)options.seed, options.medium.lossProbability * 100,
+         (long long)options.medium.baseDelayUs, (long long)options.medium.jitterUs,
+         options.debouncePolicy == DEBOUNCE_POLICY_EAGER ? "eager" : "deferred");
+
+  if (strcmp(options.scenario, "room") == 0) {
+    sim_scenarioRoom(&options);
+  } else if (strcmp(options.scenario, "reboot") == 0) {
+    sim_scenarioReboot(&options);
+  } else if (strcmp(options.scenario, "replacement") == 0) {
+    if (!sim_scenarioReplacement(&options)) return 1;
+  } else {
+    fprintf(stderr, "Unknown scenario: %s\n", options.scenario);
+    return 2;
+  }
+  return 0;
+}
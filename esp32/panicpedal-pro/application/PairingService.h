@@ -6,23 +6,31 @@
 #include "../domain/PairingState.h"
 #include "../infrastructure/EspNowTransport.h"
 #include "../shared/messages.h"
+#include "../shared/MessageCodec.h"
+
+#define DISCOVERY_RESPONSE_TIMEOUT 2000  // 2 seconds
+#define ONLINE_REPEAT_INTERVAL 5000  // While no receiver has answered
 
 typedef struct {
   PairingState* pairingState;
   EspNowTransport* transport;
   uint8_t pedalMode;  // 0=DUAL, 1=SINGLE
   unsigned long bootTime;
+  unsigned long lastOnlineTime;
   void (*onPaired)(const uint8_t* receiverMAC);
 } PairingService;
 
 void pairingService_init(PairingService* service, PairingState* state, EspNowTransport* transport, uint8_t pedalMode, unsigned long bootTime);
 void pairingService_handleBeacon(PairingService* service, const uint8_t* senderMAC, const beacon_message* beacon);
-void pairingService_handleDiscoveryResponse(PairingService* service, const uint8_t* senderMAC, uint8_t channel);
-void pairingService_handleAlive(PairingService* service, const uint8_t* senderMAC, uint8_t channel);
+void pairingService_handleDiscoveryResponse(PairingService* service, const uint8_t* senderMAC, PeerProtocol receiver,
+                                            uint8_t channel);
+void pairingService_handleAlive(PairingService* service, const uint8_t* senderMAC, PeerProtocol receiver,
+                                uint8_t channel);
 void pairingService_initiatePairing(PairingService* service, const uint8_t* receiverMAC, uint8_t channel);
 void pairingService_broadcastOnline(PairingService* service);
 void pairingService_broadcastPaired(PairingService* service, const uint8_t* receiverMAC);
 bool pairingService_checkDiscoveryTimeout(PairingService* service, unsigned long currentTime);
+bool pairingService_checkOnline(PairingService* service, unsigned long currentTime);
 
 #endif // PAIRING_SERVICE_H
 
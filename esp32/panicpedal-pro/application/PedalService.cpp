@@ -3,10 +3,12 @@
 #include "../infrastructure/LEDService.h"
 #include <string.h>
 #include <stdarg.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 #include "../shared/messages.h"
+#include "../shared/utils.h"
+#include "../shared/MessageCodec.h"
 
-// Forward declaration - debugPrint is defined in transmitter.ino
+// Forward declaration - debugPrint is defined in the sketch (.ino)
 extern void debugPrint(const char* format, ...);
 extern bool debugEnabled;
 
@@ -22,16 +24,35 @@ void pedalService_setLEDService(void* ledService) {
   g_ledService = (LEDService*)ledService;
 }
 
+void pedalService_setAnalogPedals(PedalService* service, AnalogPedals* analog) {
+  service->analog = analog;
+}
+
+static uint8_t pedalService_pressedMask(const PedalService* service) {
+  return service->analog ? analogPedals_pressedMask(service->analog) : pedalReader_pressedMask(service->reader);
+}
+
+// Switch pedals report how long after the edge the change was seen; analog
+// pedals where in their travel rapid trigger flipped them
+static void pedalService_logChange(PedalService* service, char key, bool pressed) {
+  const char* paired = pairingState_isPaired(service->pairingState) ? "" : "not paired, ";
+  const char* change = pressed ? "PRESSED" : "RELEASED";
+  if (service->analog) {
+    debugPrint("Pedal %c %s (%sat %d/%d travel)\n", key, change, paired,
+               analogPedals_position(service->analog, key - '1'), ANALOG_POSITION_MAX);
+    return;
+  }
+  PedalState* state = pedalReader_stateForKey(service->reader, key);
+  long latency = (long)(pressed ? state->pressLatency.lastMicros : state->releaseLatency.lastMicros);
+  debugPrint("Pedal %c %s (%s%ld us after edge)\n", key, change, paired, latency);
+}
+
 void onPedalPress(char key) {
   if (!g_pedalService) return;
   
   // Log pedal press
   if (debugEnabled) {
-    if (pairingState_isPaired(g_pedalService->pairingState)) {
-      debugPrint("Pedal %c PRESSED\n", key);
-    } else {
-      debugPrint("Pedal %c PRESSED (not paired)\n", key);
-    }
+    pedalService_logChange(g_pedalService, key, true);
   }
   
   // If not paired and we have a discovered receiver, initiate pairing
@@ -48,10 +69,8 @@ void onPedalPress(char key) {
     }
   }
   
-  // Send pedal event if paired
-  if (pairingState_isPaired(g_pedalService->pairingState)) {
-    pedalService_sendPedalEvent(g_pedalService, key, true);
-  }
+  // Sent now if paired, otherwise queued until pairing completes
+  pedalService_sendPedalEvent(g_pedalService, key, true);
   
   // LED stays off during pedal press (battery saving)
   
@@ -65,17 +84,10 @@ void onPedalRelease(char key) {
   
   // Log pedal release
   if (debugEnabled) {
-    if (pairingState_isPaired(g_pedalService->pairingState)) {
-      debugPrint("Pedal %c RELEASED\n", key);
-    } else {
-      debugPrint("Pedal %c RELEASED (not paired)\n", key);
-    }
+    pedalService_logChange(g_pedalService, key, false);
   }
   
-  // Send pedal event if paired
-  if (pairingState_isPaired(g_pedalService->pairingState)) {
-    pedalService_sendPedalEvent(g_pedalService, key, false);
-  }
+  pedalService_sendPedalEvent(g_pedalService, key, false);
   
   // LED stays off after pedal release (battery saving)
   
@@ -87,43 +99,189 @@ void onPedalRelease(char key) {
 void pedalService_init(PedalService* service, PedalReader* reader, PairingState* pairingState, 
                        EspNowTransport* transport, unsigned long* lastActivityTime, unsigned long bootTime) {
   service->reader = reader;
+  service->analog = nullptr;
   service->pairingState = pairingState;
   service->transport = transport;
   service->lastActivityTime = lastActivityTime;
   service->bootTime = bootTime;
+  service->lastSeq = 0;
+  service->lastSnapshotTime = 0;
+  pedalEventQueue_init(&service->eventQueue, PEDAL_EVENT_QUEUE_STALE_MS);
+  service->positionSeq = 0;
+  memset(service->streamedPositions, 0, sizeof(service->streamedPositions));
+  service->lastPositionTime = 0;
+  service->lastKeyframeTime = 0;
+  service->deltaSinceKeyframe = false;
+  memset(&service->profile, 0, sizeof(service->profile));
+  service->profilePending = false;
   service->onActivity = nullptr;
   g_pedalService = service;
 }
 
-void pedalService_update(PedalService* service) {
-  pedalReader_update(service->reader, onPedalPress, onPedalRelease);
+// Sends a frame to the paired receiver; copies > 1 queue back-to-back as a
+// redundant burst, each contending for the channel on its own, so loop() never waits
+static bool pedalService_sendFrame(PedalService* service, const void* frame, int len, int copies, uint8_t retries) {
+  bool sent = false;
+  for (int copy = 0; copy < copies; copy++) {
+    sent |= espNowTransport_sendWithRetry(service->transport, service->pairingState->pairedReceiverMAC, 
+                                          (const uint8_t*)frame, len, retries);
+  }
+  
+  unsigned long now = halClock_millis();
+  service->lastSnapshotTime = now;
+  if (service->lastActivityTime) {
+    *service->lastActivityTime = now;
+  }
+  return sent;
 }
 
-void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed) {
-  if (!pairingState_isPaired(service->pairingState)) {
-    return;  // Not paired
-  }
-  
-  // Note: pedalMode field is not used by receiver (it uses transmitterManager data)
-  // but we set it for consistency
-  // Use designated initializer for better code generation
-  struct_message msg = {
-    .msgType = MSG_PEDAL_EVENT,
-    .key = key,
-    .pressed = pressed,
-    .pedalMode = service->reader->pedalMode
+// Sends the state of every pedal
+static bool pedalService_sendSnapshot(PedalService* service, uint8_t pedalMask, int copies, uint8_t retries) {
+  pedal_snapshot_message msg = {
+    .msgType = MSG_PEDAL_SNAPSHOT,
+    .pedalMask = pedalMask,
+    .pedalMode = service->reader->pedalMode,
+    .seq = service->lastSeq
   };
+  return pedalService_sendFrame(service, &msg, sizeof(msg), copies, retries);
+}
+
+// Sends in the fastest format the paired receiver supports. Sequence numbers
+// skip 0, which marks frames without one.
+static bool pedalService_sendEvent(PedalService* service, char key, bool pressed, uint8_t pedalMask) {
+  service->lastSeq = service->lastSeq == 255 ? 1 : service->lastSeq + 1;
+  uint8_t capabilities = service->pairingState->linkCapabilities;
   
-  bool sent = espNowTransport_send(service->transport, service->pairingState->pairedReceiverMAC, 
-                                   (uint8_t*)&msg, sizeof(msg));
+  // The snapshot carries every pedal's state, so a lost one is repaired by the
+  // next. The first copy goes out immediately; the others cover a lost frame
+  // without waiting for a retry timeout. The receiver drops the duplicates by
+  // seq, and the transport resends any copy the MAC layer reports as failed.
+  if (capabilities & CAP_SNAPSHOT) {
+    return pedalService_sendSnapshot(service, pedalMask, PEDAL_EVENT_BURST_COUNT, PEDAL_EVENT_RETRY_BUDGET);
+  }
   
-  // Only log failures (successful sends are routine)
-  if (debugEnabled && !sent) {
-    debugPrint("Pedal event send FAILED: key='%c', %s\n", key, pressed ? "PRESSED" : "RELEASED");
+  // Older receivers take one struct_message per edge, and only drop burst
+  // copies if they understand seq
+  bool sequenced = capabilities & CAP_SEQUENCE;
+  struct_message msg = {MSG_PEDAL_EVENT, key, pressed, service->reader->pedalMode,
+                        (uint8_t)(sequenced ? service->lastSeq : 0)};
+  return pedalService_sendFrame(service, &msg, sizeof(msg), sequenced ? PEDAL_EVENT_BURST_COUNT : 1,
+                                PEDAL_EVENT_RETRY_BUDGET);
+}
+
+// Streams analog travel: a delta frame when every pedal moved by at most
+// PEDAL_POSITION_DELTA_MAX since the last frame, otherwise a keyframe, plus a
+// keyframe every PEDAL_POSITION_KEYFRAME_MS while moving and one once the
+// pedals settle, which repairs a lost delta. Nothing goes out at rest.
+static void pedalService_streamPositions(PedalService* service) {
+  unsigned long now = halClock_millis();
+  if (now - service->lastPositionTime < PEDAL_POSITION_INTERVAL_MS) return;
+  
+  int8_t deltas[2] = {0, 0};
+  bool changed = false;
+  bool fits = true;
+  for (uint8_t pedal = 0; pedal < service->analog->count; pedal++) {
+    int delta = analogPedals_position(service->analog, pedal) - service->streamedPositions[pedal];
+    changed |= delta > PEDAL_POSITION_DEADBAND || delta < -PEDAL_POSITION_DEADBAND;
+    fits &= delta >= -PEDAL_POSITION_DELTA_MAX && delta <= PEDAL_POSITION_DELTA_MAX;
+    deltas[pedal] = (int8_t)delta;
   }
+  bool keyframeDue = now - service->lastKeyframeTime >= PEDAL_POSITION_KEYFRAME_MS;
+  if (!changed && !(keyframeDue && service->deltaSinceKeyframe)) return;
   
-  if (service->lastActivityTime) {
-    *service->lastActivityTime = millis();
+  service->positionSeq = (service->positionSeq + 1) & PEDAL_POSITION_SEQ_MASK;
+  pedal_position_message msg = {MSG_PEDAL_POSITION, service->positionSeq, {0, 0}};
+  int len;
+  if (!fits || keyframeDue) {
+    msg.seq |= PEDAL_POSITION_KEYFRAME;
+    for (uint8_t pedal = 0; pedal < service->analog->count; pedal++) {
+      msg.positions[pedal] = analogPedals_position(service->analog, pedal);
+      service->streamedPositions[pedal] = msg.positions[pedal];
+    }
+    len = sizeof(msg);
+    service->lastKeyframeTime = now;
+    service->deltaSinceKeyframe = false;
+  } else {
+    msg.positions[0] = messageCodec_packPositionDeltas(deltas[0], deltas[1]);
+    service->streamedPositions[0] += deltas[0];
+    service->streamedPositions[1] += deltas[1];
+    len = PEDAL_POSITION_DELTA_SIZE;
+    service->deltaSinceKeyframe = true;
+  }
+  
+  // Best effort: the next frame supersedes this one, so no burst or retries
+  espNowTransport_send(service->transport, service->pairingState->pairedReceiverMAC, (const uint8_t*)&msg, len);
+  service->lastPositionTime = now;
+  if (changed && service->lastActivityTime) {
+    *service->lastActivityTime = now;
   }
 }
 
+void pedalService_update(PedalService* service) {
+  if (service->analog) {
+    analogPedals_update(service->analog, onPedalPress, onPedalRelease);
+  } else {
+    pedalReader_update(service->reader, onPedalPress, onPedalRelease);
+  }
+  
+  if (!pairingState_isPaired(service->pairingState)) return;
+  
+  if (service->analog && (service->pairingState->linkCapabilities & CAP_POSITION)) {
+    pedalService_streamPositions(service);
+  }
+  
+  // Drain one queued event per pass, so a replayed tap still reaches the
+  // host as a press and a release a loop period apart
+  QueuedPedalEvent queued;
+  if (pedalEventQueue_peek(&service->eventQueue, halClock_millis(), &queued)) {
+    if (pedalService_sendEvent(service, queued.key, queued.pressed, queued.pedalMask)) {
+      pedalEventQueue_pop(&service->eventQueue);
+    }
+    return;
+  }
+  
+  // Profile keys after any queued events, as a burst like a snapshot; an
+  // older receiver keeps its own keys
+  if (service->profilePending) {
+    if (!(service->pairingState->linkCapabilities & CAP_PROFILE) ||
+        pedalService_sendFrame(service, &service->profile, sizeof(service->profile), PEDAL_EVENT_BURST_COUNT,
+                               PEDAL_EVENT_RETRY_BUDGET)) {
+      service->profilePending = false;
+    }
+    return;
+  }
+  
+  // Keepalive: lets the receiver release our keys if we go silent while held
+  uint8_t pedalMask = pedalService_pressedMask(service);
+  if ((service->pairingState->linkCapabilities & CAP_SNAPSHOT) && pedalMask != 0 &&
+      halClock_millis() - service->lastSnapshotTime >= PEDAL_SNAPSHOT_KEEPALIVE_MS) {
+    pedalService_sendSnapshot(service, pedalMask, 1, 0);
+  }
+}
+
+void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed) {
+  uint8_t pedalMask = pedalService_pressedMask(service);
+  
+  // Nothing overtakes an event that is still waiting
+  if (!pairingState_isPaired(service->pairingState) || !pedalEventQueue_isEmpty(&service->eventQueue)) {
+    pedalEventQueue_push(&service->eventQueue, key, pressed, pedalMask, halClock_millis());
+    return;
+  }
+  
+  if (!pedalService_sendEvent(service, key, pressed, pedalMask)) {
+    pedalEventQueue_push(&service->eventQueue, key, pressed, pedalMask, halClock_millis());
+    
+    // Only log failures (successful sends are routine)
+    if (debugEnabled) {
+      debugPrint("Pedal event send FAILED, queued: key='%c', %s\n", key, pressed ? "PRESSED" : "RELEASED");
+    }
+  }
+}
+
+void pedalService_setProfile(PedalService* service, uint8_t profile, const char* keys, const uint8_t* modifiers) {
+  service->profile.msgType = MSG_PEDAL_PROFILE;
+  service->profile.profile = profile;
+  memcpy(service->profile.keys, keys, sizeof(service->profile.keys));
+  memcpy(service->profile.modifiers, modifiers, sizeof(service->profile.modifiers));
+  service->profilePending = true;
+}
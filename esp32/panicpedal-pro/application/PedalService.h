@@ -3,25 +3,43 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "../domain/PedalReader.h"
+#include "../shared/PedalReader.h"
+#include "../domain/AnalogPedal.h"
 #include "../domain/PairingState.h"
 #include "../infrastructure/EspNowTransport.h"
 #include "../shared/messages.h"
+#include "../shared/PedalEventQueue.h"
 #include "PairingService.h"
 
 typedef struct {
   PedalReader* reader;
+  AnalogPedals* analog;  // Set: pedal state comes from here instead of reader
   PairingState* pairingState;
   EspNowTransport* transport;
   unsigned long* lastActivityTime;
+  unsigned long bootTime;
+  uint8_t lastSeq;  // Sequence number of the last pedal event sent
+  unsigned long lastSnapshotTime;
+  PedalEventQueue eventQueue;  // Events waiting for the link, sent in order
+  uint8_t positionSeq;          // Last MSG_PEDAL_POSITION seq, without the keyframe bit
+  uint8_t streamedPositions[2]; // What the receiver rebuilds from the frames sent so far
+  unsigned long lastPositionTime;
+  unsigned long lastKeyframeTime;
+  bool deltaSinceKeyframe;
+  pedal_profile_message profile;  // Keys of the selected profile
+  bool profilePending;            // Not yet delivered since it changed or the link (re)paired
   void (*onActivity)();
 } PedalService;
 
 void pedalService_init(PedalService* service, PedalReader* reader, PairingState* pairingState, 
-                       EspNowTransport* transport, unsigned long* lastActivityTime);
-void pedalService_setPairingService(PedalService* pairingService);
+                       EspNowTransport* transport, unsigned long* lastActivityTime, unsigned long bootTime);
+void pedalService_setPairingService(PairingService* pairingService);
 void pedalService_setLEDService(void* ledService);
+void pedalService_setAnalogPedals(PedalService* service, AnalogPedals* analog);
 void pedalService_update(PedalService* service);
 void pedalService_sendPedalEvent(PedalService* service, char key, bool pressed);
+// Tells the receiver the profile's keys once the link allows; call again with
+// the same profile after pairing to resend them
+void pedalService_setProfile(PedalService* service, uint8_t profile, const char* keys, const uint8_t* modifiers);
 
 #endif // PEDAL_SERVICE_H
@@ -0,0 +1,117 @@
+#include "AnalogPedal.h"
+#include <string.h>
+#include "../shared/hal/Hal.h"
+
+bool analogPedals_init(AnalogPedals* pedals, const uint8_t* pins, uint8_t count, uint32_t sampleRateHz,
+                       uint16_t restRaw, uint16_t pressedRaw, uint8_t sensitivity, uint8_t deadzone) {
+  memset(pedals, 0, sizeof(AnalogPedals));
+  if (count > ANALOG_PEDAL_MAX) count = ANALOG_PEDAL_MAX;
+  pedals->count = count;
+  pedals->sensitivity = sensitivity ? sensitivity : 1;
+  pedals->deadzone = deadzone;
+  for (uint8_t i = 0; i < count; i++) {
+    pedals->pedals[i].pin = pins[i];
+    pedals->pedals[i].restRaw = restRaw;
+    pedals->pedals[i].pressedRaw = pressedRaw;
+  }
+  return halAdc_beginContinuous(pins, count, sampleRateHz);
+}
+
+// Filtered counts as travel from rest; the pressed end widens to the deepest
+// reading so a strong magnet still reaches full travel
+static uint8_t analogPedal_position(AnalogPedalState* pedal) {
+  int32_t reading = pedal->filtered >> ANALOG_FILTER_FRACTION_BITS;
+  int32_t span = (int32_t)pedal->pressedRaw - pedal->restRaw;
+  int32_t travel = reading - pedal->restRaw;
+  if (span < 0) {
+    span = -span;
+    travel = -travel;
+  }
+  if (travel > span) {
+    pedal->pressedRaw = (uint16_t)reading;
+    return ANALOG_POSITION_MAX;
+  }
+  if (travel <= 0 || span == 0) return 0;
+  return (uint8_t)(travel * ANALOG_POSITION_MAX / span);
+}
+
+// Rapid trigger: reverse by `sensitivity` from the extreme to flip the state
+static void analogPedal_track(AnalogPedals* pedals, uint8_t index, int64_t now,
+                              void (*onPedalPress)(char key), void (*onPedalRelease)(char key)) {
+  AnalogPedalState* pedal = &pedals->pedals[index];
+  uint8_t position = pedal->position;
+
+  if (pedal->actuated) {
+    if (position > pedal->extreme) pedal->extreme = position;
+    if (position > pedals->deadzone && position + pedals->sensitivity > pedal->extreme) return;
+  } else {
+    // Travel out of the deadzone counts from its edge, so noise there cannot
+    // press and release in turn
+    if (position < pedal->extreme) pedal->extreme = position;
+    uint8_t from = pedal->extreme > pedals->deadzone ? pedal->extreme : pedals->deadzone;
+    if (position < from + pedals->sensitivity) return;
+  }
+
+  pedal->actuated = !pedal->actuated;
+  pedal->extreme = position;
+  pedal->actuatedMicros = now;
+  if (pedal->actuated) {
+    if (onPedalPress) onPedalPress('1' + index);
+  } else {
+    if (onPedalRelease) onPedalRelease('1' + index);
+  }
+}
+
+void analogPedals_update(AnalogPedals* pedals, void (*onPedalPress)(char key), void (*onPedalRelease)(char key)) {
+  HalAdcSample samples[ANALOG_READ_BATCH];
+  int count;
+  do {
+    count = halAdc_read(samples, ANALOG_READ_BATCH);
+    int64_t now = halClock_micros();
+    pedals->conversions += count;
+
+    for (int i = 0; i < count; i++) {
+      uint8_t index = 0;
+      while (index < pedals->count && pedals->pedals[index].pin != samples[i].pin) index++;
+      if (index == pedals->count) continue;
+
+      AnalogPedalState* pedal = &pedals->pedals[index];
+      int32_t value = (int32_t)samples[i].value << ANALOG_FILTER_FRACTION_BITS;
+      if (!pedal->primed) {
+        pedal->filtered = value;
+        pedal->primed = true;
+      } else {
+        pedal->filtered += (value - pedal->filtered) >> ANALOG_FILTER_SHIFT;
+      }
+      pedal->position = analogPedal_position(pedal);
+      analogPedal_track(pedals, index, now, onPedalPress, onPedalRelease);
+    }
+  } while (count == ANALOG_READ_BATCH);
+}
+
+uint8_t analogPedals_pressedMask(const AnalogPedals* pedals) {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < pedals->count; i++) {
+    if (pedals->pedals[i].actuated) mask |= (uint8_t)(1 << i);
+  }
+  return mask;
+}
+
+uint8_t analogPedals_position(const AnalogPedals* pedals, uint8_t pedal) {
+  return pedal < pedals->count ? pedals->pedals[pedal].position : 0;
+}
+
+bool analogPedals_anyPressed(const uint8_t* pins, uint8_t count, uint16_t restRaw, uint16_t pressedRaw,
+                             uint8_t deadzone) {
+  for (uint8_t i = 0; i < count; i++) {
+    int reading = halAdc_readOnce(pins[i]);
+    if (reading < 0) return true;
+
+    AnalogPedalState pedal = {};
+    pedal.filtered = (int32_t)reading << ANALOG_FILTER_FRACTION_BITS;
+    pedal.restRaw = restRaw;
+    pedal.pressedRaw = pressedRaw;
+    if (analogPedal_position(&pedal) > deadzone) return true;
+  }
+  return false;
+}
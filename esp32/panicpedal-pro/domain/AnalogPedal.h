@@ -0,0 +1,53 @@
+#ifndef ANALOG_PEDAL_H
+#define ANALOG_PEDAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hall-effect pedals read by the ADC. Each conversion goes through an
+// exponential filter and becomes a travel position; rapid trigger turns the
+// positions into presses and releases. A pedal actuates once it has moved
+// `sensitivity` down from the shallowest point since it last reset, and resets
+// once it has come `sensitivity` back up from the deepest point since it
+// actuated - wherever in its travel that happens. Within `deadzone` of the top
+// it is always released, and a press from there counts from the deadzone's
+// edge, so sensor noise at rest never actuates it.
+
+#define ANALOG_PEDAL_MAX 2
+#define ANALOG_FILTER_SHIFT 3          // Each conversion moves the filter 1/8 of the way
+#define ANALOG_FILTER_FRACTION_BITS 4  // Filtered counts keep this much sub-LSB precision
+#define ANALOG_POSITION_MAX 255        // Fully pressed
+#define ANALOG_READ_BATCH 64           // Conversions drained per halAdc_read call
+
+typedef struct {
+  uint8_t pin;
+  int32_t filtered;     // ADC counts << ANALOG_FILTER_FRACTION_BITS
+  bool primed;          // filtered holds a reading
+  uint16_t restRaw;     // Counts at rest and fully pressed, in either order (sensor polarity);
+  uint16_t pressedRaw;  // pressedRaw widens to the deepest reading seen
+  uint8_t position;     // 0 = at rest, ANALOG_POSITION_MAX = fully pressed
+  uint8_t extreme;      // Deepest point while actuated, shallowest while reset
+  bool actuated;
+  int64_t actuatedMicros;  // Conversion batch that last changed `actuated`
+} AnalogPedalState;
+
+typedef struct {
+  AnalogPedalState pedals[ANALOG_PEDAL_MAX];
+  uint8_t count;
+  uint8_t sensitivity;  // Travel against the last direction that flips the state
+  uint8_t deadzone;     // Positions at or above this close to rest are released
+  uint32_t conversions;
+} AnalogPedals;
+
+// Starts the ADC on pins (pedal '1' first); false if the ADC refused them
+bool analogPedals_init(AnalogPedals* pedals, const uint8_t* pins, uint8_t count, uint32_t sampleRateHz,
+                       uint16_t restRaw, uint16_t pressedRaw, uint8_t sensitivity, uint8_t deadzone);
+void analogPedals_update(AnalogPedals* pedals, void (*onPedalPress)(char key), void (*onPedalRelease)(char key));
+uint8_t analogPedals_pressedMask(const AnalogPedals* pedals);  // Bit 0 = pedal '1', bit 1 = pedal '2'
+uint8_t analogPedals_position(const AnalogPedals* pedals, uint8_t pedal);
+// One conversion per pin, without starting the ADC: true if any pedal is past
+// the deadzone (or could not be read). Decides whether a timer wake boots.
+bool analogPedals_anyPressed(const uint8_t* pins, uint8_t count, uint16_t restRaw, uint16_t pressedRaw,
+                             uint8_t deadzone);
+
+#endif // ANALOG_PEDAL_H
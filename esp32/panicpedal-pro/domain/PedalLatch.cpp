@@ -0,0 +1,20 @@
+#include "PedalLatch.h"
+#include "../shared/hal/Hal.h"
+
+static bool HAL_ISR_ATTR pedalLatch_level(PedalState* state, bool noLevel) {
+  if (noLevel == HAL_GPIO_LOW) return HAL_GPIO_LOW;
+  if (halGpio_read(state->contactPin) == HAL_GPIO_LOW) return HAL_GPIO_HIGH;
+  return state->contactLevel;
+}
+
+bool pedalLatch_enable(PedalReader* reader, uint8_t pedal, uint8_t ncPin) {
+  uint8_t noPin = pedal == 0 ? reader->pedal1Pin : reader->pedal2Pin;
+
+  halGpio_inputPullup(ncPin);
+  if (halGpio_read(ncPin) != HAL_GPIO_LOW || halGpio_read(noPin) != HAL_GPIO_HIGH) {
+    return false;
+  }
+  pedalReader_setContact(reader, pedal, pedalLatch_level, ncPin);
+  pedalReader_setDebouncePolicy(reader, pedal, DEBOUNCE_POLICY_LATCH, 0);
+  return true;
+}
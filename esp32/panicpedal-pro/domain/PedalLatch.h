@@ -0,0 +1,16 @@
+#ifndef PEDAL_LATCH_H
+#define PEDAL_LATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../shared/PedalReader.h"
+
+// SPDT set/reset latch on the PanicPedal Pro's NO/NC contact pairs: NO closed
+// sets, NC closed resets, both open (contact in transit or bouncing) holds.
+// Bounce on one contact never reaches the other, so no debounce delay is needed.
+
+// Switches the pedal to DEBOUNCE_POLICY_LATCH. The NC contact must read closed
+// now (pedal at rest); otherwise it may not be wired and the current policy is kept.
+bool pedalLatch_enable(PedalReader* reader, uint8_t pedal, uint8_t ncPin);
+
+#endif // PEDAL_LATCH_H
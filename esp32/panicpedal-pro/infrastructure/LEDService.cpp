@@ -1,5 +1,5 @@
 #include "LEDService.h"
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 
 // APA102 protocol constants
 #define APA102_START_FRAME 0x00000000
@@ -8,11 +8,11 @@
 // Send a byte via bit-banging SPI for APA102
 void apa102_sendByte(uint8_t dinPin, uint8_t clkPin, uint8_t data) {
   for (int i = 7; i >= 0; i--) {
-    digitalWrite(dinPin, (data >> i) & 0x01);
-    digitalWrite(clkPin, HIGH);
-    delayMicroseconds(1);  // Small delay for timing
-    digitalWrite(clkPin, LOW);
-    delayMicroseconds(1);
+    halGpio_write(dinPin, (data >> i) & 0x01);
+    halGpio_write(clkPin, HAL_GPIO_HIGH);
+    halClock_delayMicros(1);  // Small delay for timing
+    halGpio_write(clkPin, HAL_GPIO_LOW);
+    halClock_delayMicros(1);
   }
 }
 
@@ -53,12 +53,12 @@ void ledService_init(LEDService* service, uint8_t dinPin, uint8_t clkPin) {
   service->lastBlinkToggle = 0;
   
   // Configure pins as outputs
-  pinMode(dinPin, OUTPUT);
-  pinMode(clkPin, OUTPUT);
+  halGpio_output(dinPin);
+  halGpio_output(clkPin);
   
   // Initialize pins to LOW
-  digitalWrite(dinPin, LOW);
-  digitalWrite(clkPin, LOW);
+  halGpio_write(dinPin, HAL_GPIO_LOW);
+  halGpio_write(clkPin, HAL_GPIO_LOW);
   
   // Turn LED off initially
   ledService_setColor(service, 0, 0, 0, 0);
@@ -66,7 +66,7 @@ void ledService_init(LEDService* service, uint8_t dinPin, uint8_t clkPin) {
 
 void ledService_setState(LEDService* service, LEDState state) {
   service->state = state;
-  service->lastBlinkToggle = millis();
+  service->lastBlinkToggle = halClock_millis();
   service->blinkState = false;
 }
 
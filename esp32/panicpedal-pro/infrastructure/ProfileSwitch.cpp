@@ -0,0 +1,34 @@
+#include "ProfileSwitch.h"
+#include "../shared/hal/Hal.h"
+
+static uint8_t profileSwitch_read(const ProfileSwitch* profileSwitch) {
+  if (halGpio_read(profileSwitch->pos1Pin) == HAL_GPIO_LOW) return 1;
+  if (halGpio_read(profileSwitch->pos2Pin) == HAL_GPIO_LOW) return 2;
+  return 0;
+}
+
+// Starts settled on the position it reads now, so boot applies it without waiting
+void profileSwitch_init(ProfileSwitch* profileSwitch, uint8_t pos1Pin, uint8_t pos2Pin) {
+  profileSwitch->pos1Pin = pos1Pin;
+  profileSwitch->pos2Pin = pos2Pin;
+  halGpio_inputPullup(pos1Pin);
+  halGpio_inputPullup(pos2Pin);
+  profileSwitch->position = profileSwitch_read(profileSwitch);
+  profileSwitch->reading = profileSwitch->position;
+  profileSwitch->readingSince = 0;
+}
+
+bool profileSwitch_update(ProfileSwitch* profileSwitch, unsigned long currentTime) {
+  uint8_t reading = profileSwitch_read(profileSwitch);
+  if (reading != profileSwitch->reading) {
+    profileSwitch->reading = reading;
+    profileSwitch->readingSince = currentTime;
+    return false;
+  }
+  
+  if (reading == profileSwitch->position || currentTime - profileSwitch->readingSince < PROFILE_SWITCH_SETTLE_MS) {
+    return false;
+  }
+  profileSwitch->position = reading;
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef PROFILE_SWITCH_H
+#define PROFILE_SWITCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PEDAL_PROFILE_COUNT 3
+#define PROFILE_SWITCH_SETTLE_MS 50  // A position must hold this long; covers contact bounce mid-flip
+
+// Everything one switch position selects. The sketch keeps them in a const
+// table, so a flip only points at another row.
+typedef struct {
+  const char* name;
+  char keys[2];              // Receiver key per pedal; 0 = the receiver's default ('l', 'r')
+  uint8_t modifiers[2];      // HAL_HID_MOD_* bits held with each key
+  uint8_t debouncePolicy[2]; // DEBOUNCE_POLICY_EAGER or _DEFERRED; latched pedals need none and keep theirs
+  uint16_t lockoutMs;        // Eager policy lockout
+  uint8_t rapidTrigger;      // Analog pedals: travel (of 255) that flips the state
+  uint16_t idleDelayMs;      // loop() period while paired: shorter reacts sooner, longer saves battery
+  uint16_t cpuMhz;
+  uint32_t inactivityTimeoutMs;  // Deep sleep after this long without a pedal change
+} PedalProfile;
+
+// On-off-on switch: position 1 or 2 pulls its pin low; neither is the middle,
+// profile 0
+typedef struct {
+  uint8_t pos1Pin;
+  uint8_t pos2Pin;
+  uint8_t position;  // Settled position
+  uint8_t reading;   // Position seen on the last update
+  unsigned long readingSince;
+} ProfileSwitch;
+
+void profileSwitch_init(ProfileSwitch* profileSwitch, uint8_t pos1Pin, uint8_t pos2Pin);
+bool profileSwitch_update(ProfileSwitch* profileSwitch, unsigned long currentTime);  // true when position changed
+
+#endif // PROFILE_SWITCH_H
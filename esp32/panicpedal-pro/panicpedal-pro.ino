@@ -1,14 +1,17 @@
-#include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
-#include "esp_wifi.h"
+#include <stdarg.h>
+#include <string.h>
 
 // Clean Architecture: Include shared and domain modules
+#include "shared/hal/Hal.h"
 #include "shared/messages.h"
+#include "shared/MessageCodec.h"
 #include "domain/PairingState.h"
-#include "domain/PedalReader.h"
+#include "shared/PedalReader.h"
+#include "domain/PedalLatch.h"
+#include "domain/AnalogPedal.h"
 #include "infrastructure/EspNowTransport.h"
 #include "infrastructure/LEDService.h"
+#include "infrastructure/ProfileSwitch.h"
 #include "application/PairingService.h"
 #include "application/PedalService.h"
 
@@ -20,6 +23,19 @@
 #define PEDAL_MODE_SINGLE 1    // Force single pedal mode (GPIO1 only)
 #define PEDAL_MODE PEDAL_MODE_AUTO  // Change to PEDAL_MODE_DUAL or PEDAL_MODE_SINGLE to override auto-detection
 #define DEBUG_ENABLED 1  // Set to 0 to disable Serial output and save battery
+#define PEDAL_INTERRUPT_CAPTURE 1  // 1=GPIO interrupts timestamp pedal edges, 0=poll pins every loop()
+#define PEDAL_LEFT_DEBOUNCE DEBOUNCE_POLICY_DEFERRED  // DEBOUNCE_POLICY_DEFERRED (wait DEBOUNCE_DELAY) or DEBOUNCE_POLICY_EAGER (press once an edge holds DEBOUNCE_CONFIRM_US)
+#define PEDAL_RIGHT_DEBOUNCE DEBOUNCE_POLICY_DEFERRED
+#define DEBOUNCE_LOCKOUT_MS DEBOUNCE_LOCKOUT  // Eager policy: ignore edges for this long after a reported change
+#define PEDAL_LATCH_DEBOUNCE 1  // 1=NO/NC contacts form a set/reset latch (no debounce delay), 0=use the policies above
+#define PEDAL_ANALOG 0  // 1=hall-effect sensors on the NO pins, read by the ADC with rapid trigger; set PEDAL_MODE too (no NC contacts to detect)
+#define ANALOG_SAMPLE_RATE_HZ 20000  // ADC conversions per second, shared by the pedals
+#define ANALOG_REST_RAW 2200     // ADC counts with the pedal up
+#define ANALOG_PRESSED_RAW 3600  // ADC counts fully pressed (below ANALOG_REST_RAW if the sensor falls)
+#define ANALOG_RAPID_TRIGGER 10  // Travel (of 255) against the last direction that presses or releases
+#define ANALOG_DEADZONE 20       // Travel (of 255) from the top where the pedal is always released
+#define ANALOG_UPDATE_MS 1       // loop() period while paired; the DMA buffers conversions in between
+#define ANALOG_WAKE_CHECK_MS 500  // Deep sleep: how often a timer wake checks the sensors for a press
 // ============================================================================
 
 // GPIO Pin Definitions (PanicPedal Pro - ESP32-S3-WROOM)
@@ -38,13 +54,30 @@
 #define IDLE_DELAY_PAIRED 20  // 20ms delay when paired
 #define IDLE_DELAY_UNPAIRED 200  // 200ms delay when not paired
 
+// Profiles, one per position of the switch on SWITCH_POS1_PIN/SWITCH_POS2_PIN:
+// receiver keys, debounce, and how much latency to trade for battery. Flipping
+// the switch takes effect at once, without a reboot or re-pairing.
+static const PedalProfile kProfiles[PEDAL_PROFILE_COUNT] = {
+  // Middle: the receiver's own keys and the settings above
+  {"standard", {0, 0}, {0, 0}, {PEDAL_LEFT_DEBOUNCE, PEDAL_RIGHT_DEBOUNCE}, DEBOUNCE_LOCKOUT_MS,
+   ANALOG_RAPID_TRIGGER, IDLE_DELAY_PAIRED, 80, INACTIVITY_TIMEOUT},
+  // Position 1: shortest lockout and loop period, full clock
+  {"performance", {0, 0}, {0, 0}, {DEBOUNCE_POLICY_EAGER, DEBOUNCE_POLICY_EAGER}, 15,
+   ANALOG_RAPID_TRIGGER / 2, 5, 160, INACTIVITY_TIMEOUT},
+  // Position 2: other keys, deferred debounce and a slow loop for long sessions
+  {"battery", {'z', 'x'}, {0, 0}, {DEBOUNCE_POLICY_DEFERRED, DEBOUNCE_POLICY_DEFERRED}, DEBOUNCE_LOCKOUT_MS,
+   ANALOG_RAPID_TRIGGER, 50, 80, 300000},
+};
+
 // Domain layer instances
 PairingState pairingState;
 PedalReader pedalReader;
+AnalogPedals analogPedals;
 EspNowTransport transport;
 
 // Infrastructure layer instances
 LEDService ledService;
+ProfileSwitch profileSwitch;
 
 // Application layer instances
 PairingService pairingService;
@@ -53,6 +86,8 @@ PedalService pedalService;
 // System state
 unsigned long lastActivityTime = 0;
 unsigned long bootTime = 0;
+bool debugEnabled = DEBUG_ENABLED;
+const PedalProfile* activeProfile = &kProfiles[0];
 
 // Forward declarations
 void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
@@ -60,159 +95,135 @@ void onPaired(const uint8_t* receiverMAC);
 void onActivity();
 uint8_t detectPedalMode();
 
+void debugPrint(const char* format, ...) {
+  #if DEBUG_ENABLED
+  va_list args;
+  va_start(args, format);
+  halLog_vprintf(format, args);
+  va_end(args);
+  #endif
+}
+
 void onPaired(const uint8_t* receiverMAC) {
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(millis() - bootTime);
-  Serial.print(" ms] Successfully paired with receiver: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(receiverMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  debugPrint("[%lu ms] Successfully paired with receiver: %02X:%02X:%02X:%02X:%02X:%02X (link caps 0x%02X)\n",
+             halClock_millis() - bootTime, receiverMAC[0], receiverMAC[1], receiverMAC[2],
+             receiverMAC[3], receiverMAC[4], receiverMAC[5], pairingState.linkCapabilities);
   #endif
   
   // Turn LED off after pairing to save battery
   ledService_setState(&ledService, LED_STATE_PAIRED);
+  
+  // The receiver may have been paired to us with other keys
+  pedalService_setProfile(&pedalService, profileSwitch.position, activeProfile->keys, activeProfile->modifiers);
 }
 
 void onActivity() {
-  lastActivityTime = millis();
+  lastActivityTime = halClock_millis();
 }
 
+// Runs on the receive callback: loop() sends it
 void sendDeleteRecordMessage(const uint8_t* receiverMAC) {
-  struct_message deleteMsg = {MSG_DELETE_RECORD, 0, false, 0};
-  espNowTransport_send(&transport, receiverMAC, (uint8_t*)&deleteMsg, sizeof(deleteMsg));
+  struct_message deleteMsg = {MSG_DELETE_RECORD, 0, false, 0, 0};
+  espNowTransport_post(&transport, receiverMAC, (uint8_t*)&deleteMsg, sizeof(deleteMsg));
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(millis() - bootTime);
-  Serial.print(" ms] Sent delete record message to receiver: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(receiverMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  debugPrint("[%lu ms] Queued delete record message to receiver: %02X:%02X:%02X:%02X:%02X:%02X\n",
+             halClock_millis() - bootTime, receiverMAC[0], receiverMAC[1], receiverMAC[2],
+             receiverMAC[3], receiverMAC[4], receiverMAC[5]);
   #endif
 }
 
-void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
-  if (len < 1) return;
+// Message handlers, one per msgType; the codec has already checked each frame's length
+void onBeacon(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const beacon_message* beacon = (const beacon_message*)data;
+  pairingService_handleBeacon(&pairingService, senderMAC, beacon);
   
   #if DEBUG_ENABLED
-  unsigned long timeSinceBoot = millis() - bootTime;
-  Serial.print("[");
-  Serial.print(timeSinceBoot);
-  Serial.print(" ms] Received ESP-NOW message: len=");
-  Serial.print(len);
-  Serial.print(", sender=");
-  for (int i = 0; i < 6; i++) {
-    Serial.print(senderMAC[i], HEX);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  PeerProtocol receiver = messageCodec_peerProtocol(data, len);
+  debugPrint("[%lu ms] Received MSG_BEACON: slots=%d/%d, protocol v%d, caps 0x%02X\n",
+             halClock_millis() - bootTime, beacon->availableSlots, beacon->totalSlots,
+             receiver.version, receiver.capabilities);
   #endif
-  
-  uint8_t msgType = data[0];
-  
-  // Handle beacon message
-  if (msgType == MSG_BEACON && len >= sizeof(beacon_message)) {
-    beacon_message* beacon = (beacon_message*)data;
-    pairingService_handleBeacon(&pairingService, senderMAC, beacon);
-    
-    #if DEBUG_ENABLED
-    Serial.print("[");
-    Serial.print(timeSinceBoot);
-    Serial.print(" ms] Received MSG_BEACON: slots=");
-    Serial.print(beacon->availableSlots);
-    Serial.print("/");
-    Serial.print(beacon->totalSlots);
-    Serial.println();
-    #endif
-    return;
-  }
-  
-  // Handle other messages
-  if (len < sizeof(struct_message)) {
+}
+
+// Once paired, ALIVE and DISCOVERY_RESP only matter when another receiver
+// still lists us: tell it to delete its record
+static void rejectOtherReceiver(const uint8_t* senderMAC, uint8_t msgType, uint8_t channel) {
+  if (memcmp(senderMAC, pairingState.pairedReceiverMAC, 6) == 0) {
+    // Message from our paired receiver - accept it
     #if DEBUG_ENABLED
-    Serial.print("[");
-    Serial.print(timeSinceBoot);
-    Serial.println(" ms] Message too short");
+    debugPrint("[%lu ms] Received message from paired receiver (type=%d)\n",
+               halClock_millis() - bootTime, msgType);
     #endif
     return;
   }
   
-  struct_message* msg = (struct_message*)data;
-  
   #if DEBUG_ENABLED
-  Serial.print("[");
-  Serial.print(timeSinceBoot);
-  Serial.print(" ms] Message type=");
-  Serial.print(msg->msgType);
-  Serial.print(", isPaired=");
-  Serial.println(pairingState_isPaired(&pairingState));
+  debugPrint("[%lu ms] Received message from different receiver - sending DELETE_RECORD\n",
+             halClock_millis() - bootTime);
   #endif
   
+  espNowTransport_addPeer(&transport, senderMAC, channel);
+  sendDeleteRecordMessage(senderMAC);
+}
+
+void onDiscoveryResponse(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
   if (pairingState_isPaired(&pairingState)) {
-    // Already paired - check if message is from our paired receiver
-    if (memcmp(senderMAC, pairingState.pairedReceiverMAC, 6) == 0) {
-      // Message from our paired receiver - accept it
-      #if DEBUG_ENABLED
-      Serial.print("[");
-      Serial.print(timeSinceBoot);
-      Serial.print(" ms] Received message from paired receiver (type=");
-      Serial.print(msg->msgType);
-      Serial.println(")");
-      #endif
-    } else {
-      // Message from different receiver - send DELETE_RECORD
-      if (msg->msgType == MSG_ALIVE || msg->msgType == MSG_DISCOVERY_RESP) {
-        #if DEBUG_ENABLED
-        Serial.print("[");
-        Serial.print(timeSinceBoot);
-        Serial.println(" ms] Received message from different receiver - sending DELETE_RECORD");
-        #endif
-        
-        espNowTransport_addPeer(&transport, senderMAC, channel);
-        sendDeleteRecordMessage(senderMAC);
-      }
-    }
+    rejectOtherReceiver(senderMAC, MSG_DISCOVERY_RESP, channel);
   } else {
-    // Not paired - handle pairing messages
-    if (msg->msgType == MSG_DISCOVERY_RESP) {
-      pairingService_handleDiscoveryResponse(&pairingService, senderMAC, channel);
-    } else if (msg->msgType == MSG_ALIVE) {
-      pairingService_handleAlive(&pairingService, senderMAC, channel);
-    }
+    pairingService_handleDiscoveryResponse(&pairingService, senderMAC, messageCodec_peerProtocol(data, len), channel);
   }
 }
 
+void onAlive(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  if (pairingState_isPaired(&pairingState)) {
+    rejectOtherReceiver(senderMAC, MSG_ALIVE, channel);
+  }
+  pairingService_handleAlive(&pairingService, senderMAC, messageCodec_peerProtocol(data, len), channel);
+}
+
+static constexpr MessageTable kMessageTable = messageTable_make({
+  {MSG_BEACON, onBeacon},
+  {MSG_DISCOVERY_RESP, onDiscoveryResponse},
+  {MSG_ALIVE, onAlive},
+});
+
+void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  #if DEBUG_ENABLED
+  debugPrint("[%lu ms] Received ESP-NOW message: type=%d, len=%d, sender=%02X:%02X:%02X:%02X:%02X:%02X, isPaired=%d\n",
+             halClock_millis() - bootTime, len > 0 ? data[0] : -1, len, senderMAC[0], senderMAC[1], senderMAC[2],
+             senderMAC[3], senderMAC[4], senderMAC[5], pairingState_isPaired(&pairingState));
+  #endif
+  
+  messageTable_dispatch(&kMessageTable, senderMAC, data, len, channel);
+}
+
 
 bool isCharging() {
   // Read STAT1/LBO pin from MCP73871
   // Pin is LOW when charging, HIGH when not charging or low battery
   // Configure as input with pull-up
-  pinMode(BATTERY_STAT1_PIN, INPUT_PULLUP);
-  delay(1);  // Small delay for pin to stabilize
-  return (digitalRead(BATTERY_STAT1_PIN) == LOW);
+  halGpio_inputPullup(BATTERY_STAT1_PIN);
+  halClock_delay(1);  // Small delay for pin to stabilize
+  return (halGpio_read(BATTERY_STAT1_PIN) == HAL_GPIO_LOW);
 }
 
 uint8_t detectPedalMode() {
   // Configure NC pins as inputs with pull-ups to detect switch connections
-  pinMode(PEDAL_LEFT_NC_PIN, INPUT_PULLUP);
-  pinMode(PEDAL_RIGHT_NC_PIN, INPUT_PULLUP);
+  halGpio_inputPullup(PEDAL_LEFT_NC_PIN);
+  halGpio_inputPullup(PEDAL_RIGHT_NC_PIN);
   
   // Small delay to allow pins to stabilize
-  delay(10);
+  halClock_delay(10);
   
   // Read NC pins - LOW means switch is connected (NC contact is grounded)
-  bool pedal1Connected = (digitalRead(PEDAL_LEFT_NC_PIN) == LOW);
-  bool pedal2Connected = (digitalRead(PEDAL_RIGHT_NC_PIN) == LOW);
+  bool pedal1Connected = (halGpio_read(PEDAL_LEFT_NC_PIN) == HAL_GPIO_LOW);
+  bool pedal2Connected = (halGpio_read(PEDAL_RIGHT_NC_PIN) == HAL_GPIO_LOW);
   
   #if DEBUG_ENABLED
-  Serial.print("Pedal detection: Pedal 1=");
-  Serial.print(pedal1Connected ? "CONNECTED" : "NOT CONNECTED");
-  Serial.print(", Pedal 2=");
-  Serial.println(pedal2Connected ? "CONNECTED" : "NOT CONNECTED");
+  debugPrint("Pedal detection: Pedal 1=%s, Pedal 2=%s\n",
+             pedal1Connected ? "CONNECTED" : "NOT CONNECTED",
+             pedal2Connected ? "CONNECTED" : "NOT CONNECTED");
   #endif
   
   // Determine mode based on detected switches
@@ -227,34 +238,72 @@ uint8_t detectPedalMode() {
   }
   
   #if DEBUG_ENABLED
-  Serial.print("Detected pedal mode: ");
-  Serial.println(detectedMode == PEDAL_MODE_DUAL ? "DUAL" : "SINGLE");
+  debugPrint("Detected pedal mode: %s\n", detectedMode == PEDAL_MODE_DUAL ? "DUAL" : "SINGLE");
   #endif
   
   return detectedMode;
 }
 
+// Takes effect between two loop() passes: held pedals stay held and the link
+// stays up. Latched pedals need no debounce and keep the latch.
+void applyProfile(uint8_t position) {
+  activeProfile = &kProfiles[position];
+  for (uint8_t pedal = 0; pedal < 2; pedal++) {
+    PedalState* state = pedal == 0 ? &pedalReader.pedal1State : &pedalReader.pedal2State;
+    if (state->debouncePolicy != DEBOUNCE_POLICY_LATCH) {
+      pedalReader_setDebouncePolicy(&pedalReader, pedal, activeProfile->debouncePolicy[pedal], activeProfile->lockoutMs);
+    }
+  }
+  analogPedals.sensitivity = activeProfile->rapidTrigger;
+  halPower_setCpuFrequencyMhz(activeProfile->cpuMhz);
+  pedalService_setProfile(&pedalService, position, activeProfile->keys, activeProfile->modifiers);
+  
+  #if DEBUG_ENABLED
+  debugPrint("[%lu ms] Profile %d (%s)\n", halClock_millis() - bootTime, position, activeProfile->name);
+  #endif
+}
+
 void goToDeepSleep() {
   #if DEBUG_ENABLED
-  Serial.println("Going to deep sleep...");
+  const SendPeerStats* link = espNowTransport_peerStats(&transport, pairingState.pairedReceiverMAC);
+  if (link) {
+    debugPrint("Link: %lu sent, %lu delivered, %lu retried, %lu failed\n", (unsigned long)link->sent,
+               (unsigned long)link->delivered, (unsigned long)link->retried, (unsigned long)link->failed);
+  }
+  debugPrint("Going to deep sleep...\n");
+  #endif
+  #if PEDAL_ANALOG
+  // A hall sensor never pulls its pin LOW: wake on a timer and check it instead
+  if (pedalService.analog) {
+    halPower_deepSleepFor(ANALOG_WAKE_CHECK_MS);
+  }
   #endif
-  esp_sleep_enable_ext0_wakeup((gpio_num_t)PEDAL_LEFT_NO_PIN, LOW);
-  esp_deep_sleep_start();
+  halPower_deepSleep(PEDAL_LEFT_NO_PIN);
 }
 
 void setup() {
+  #if PEDAL_ANALOG
+  // Back to sleep straight away unless a pedal moved since the last check
+  uint8_t wakePins[2] = {PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN};
+  if (halPower_wokeByTimer() &&
+      !analogPedals_anyPressed(wakePins, PEDAL_MODE == PEDAL_MODE_SINGLE ? 1 : 2, ANALOG_REST_RAW,
+                               ANALOG_PRESSED_RAW, ANALOG_DEADZONE)) {
+    halPower_deepSleepFor(ANALOG_WAKE_CHECK_MS);
+  }
+  #endif
+  
   #if DEBUG_ENABLED
-  Serial.begin(115200);
-  delay(100);
-  Serial.println("ESP-NOW Pedal Transmitter - PanicPedal Pro");
+  halLog_begin(115200);
+  halClock_delay(100);
+  debugPrint("ESP-NOW Pedal Transmitter - PanicPedal Pro\n");
   #endif
 
   // Battery optimization
-  setCpuFrequencyMhz(80);
-  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+  halPower_setCpuFrequencyMhz(80);
+  halRadio_enablePowerSave();
   
-  bootTime = millis();
-  lastActivityTime = millis();
+  bootTime = halClock_millis();
+  lastActivityTime = halClock_millis();
   
   // Determine pedal mode - detect on every boot
   uint8_t detectedMode = PEDAL_MODE;
@@ -263,20 +312,50 @@ void setup() {
     // Auto-detect pedal mode on every boot
     detectedMode = detectPedalMode();
     #if DEBUG_ENABLED
-    Serial.print("Auto-detected mode: ");
-    Serial.println(detectedMode == PEDAL_MODE_DUAL ? "DUAL (GPIO1 & GPIO2)" : "SINGLE (GPIO1)");
+    debugPrint("Auto-detected mode: %s\n", detectedMode == PEDAL_MODE_DUAL ? "DUAL (GPIO1 & GPIO2)" : "SINGLE (GPIO1)");
     #endif
   } else {
     // Manual override mode
     #if DEBUG_ENABLED
-    Serial.print("Mode (manual override): ");
-    Serial.println(detectedMode == PEDAL_MODE_DUAL ? "DUAL (GPIO1 & GPIO2)" : "SINGLE (GPIO1)");
+    debugPrint("Mode (manual override): %s\n", detectedMode == PEDAL_MODE_DUAL ? "DUAL (GPIO1 & GPIO2)" : "SINGLE (GPIO1)");
     #endif
   }
   
+  // The switch picks the profile the pedals start with
+  profileSwitch_init(&profileSwitch, SWITCH_POS1_PIN, SWITCH_POS2_PIN);
+  activeProfile = &kProfiles[profileSwitch.position];
+  
   // Initialize domain layer
   pairingState_init(&pairingState);
   pedalReader_init(&pedalReader, PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN, detectedMode);
+  pedalReader_setDebouncePolicy(&pedalReader, 0, activeProfile->debouncePolicy[0], activeProfile->lockoutMs);
+  pedalReader_setDebouncePolicy(&pedalReader, 1, activeProfile->debouncePolicy[1], activeProfile->lockoutMs);
+  #if PEDAL_ANALOG
+  // Sensors sit on the NO pins; the switch reader only supplies the mode,
+  // unless the ADC refuses the pins
+  uint8_t analogPins[2] = {PEDAL_LEFT_NO_PIN, PEDAL_RIGHT_NO_PIN};
+  bool analogStarted = analogPedals_init(&analogPedals, analogPins, detectedMode == PEDAL_MODE_DUAL ? 2 : 1,
+                                         ANALOG_SAMPLE_RATE_HZ, ANALOG_REST_RAW, ANALOG_PRESSED_RAW,
+                                         activeProfile->rapidTrigger, ANALOG_DEADZONE);
+  #if DEBUG_ENABLED
+  debugPrint("Analog pedals: %s\n", analogStarted ? "ON (rapid trigger)" : "ADC FAILED, using switches");
+  #endif
+  #else
+  bool analogStarted = false;
+  #endif
+  if (!analogStarted) {
+    #if PEDAL_LATCH_DEBOUNCE
+    // Falls back to the policy above for a pedal whose NC contact is open now
+    bool leftLatch = pedalLatch_enable(&pedalReader, 0, PEDAL_LEFT_NC_PIN);
+    bool rightLatch = detectedMode == PEDAL_MODE_DUAL && pedalLatch_enable(&pedalReader, 1, PEDAL_RIGHT_NC_PIN);
+    #if DEBUG_ENABLED
+    debugPrint("Latch debounce: left=%s, right=%s\n", leftLatch ? "ON" : "OFF", rightLatch ? "ON" : "OFF");
+    #endif
+    #endif
+    #if PEDAL_INTERRUPT_CAPTURE
+    pedalReader_enableInterruptCapture(&pedalReader);
+    #endif
+  }
   
   // Initialize infrastructure layer
   espNowTransport_init(&transport);
@@ -291,10 +370,15 @@ void setup() {
   pairingService_init(&pairingService, &pairingState, &transport, detectedMode, bootTime);
   pairingService.onPaired = onPaired;
   
-  pedalService_init(&pedalService, &pedalReader, &pairingState, &transport, &lastActivityTime);
+  pedalService_init(&pedalService, &pedalReader, &pairingState, &transport, &lastActivityTime, bootTime);
   pedalService.onActivity = onActivity;
   pedalService_setPairingService(&pairingService);
   pedalService_setLEDService(&ledService);
+  if (analogStarted) {
+    pedalService_setAnalogPedals(&pedalService, &analogPedals);
+  }
+  
+  applyProfile(profileSwitch.position);
   
   // Set initial LED state to pairing
   ledService_setState(&ledService, LED_STATE_PAIRING);
@@ -303,25 +387,39 @@ void setup() {
   pairingService_broadcastOnline(&pairingService);
   
   #if DEBUG_ENABLED
-  Serial.println("ESP-NOW initialized");
+  debugPrint("ESP-NOW initialized\n");
   #endif
 }
 
 void loop() {
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halClock_millis();
+  
+  // Replies the receive callback queued, and resends of failed frames
+  espNowTransport_flush(&transport);
   
   // Check discovery timeout
   if (pairingService_checkDiscoveryTimeout(&pairingService, currentTime)) {
     #if DEBUG_ENABLED
-    Serial.println("Discovery response timeout");
+    debugPrint("Discovery response timeout\n");
+    #endif
+  }
+  
+  // Announce ourselves again while no receiver has answered
+  if (pairingService_checkOnline(&pairingService, currentTime)) {
+    #if DEBUG_ENABLED
+    debugPrint("Online announcement repeated\n");
     #endif
   }
   
   // Check inactivity timeout
-  if (currentTime - lastActivityTime > INACTIVITY_TIMEOUT) {
+  if (currentTime - lastActivityTime > activeProfile->inactivityTimeoutMs) {
     goToDeepSleep();
   }
   
+  if (profileSwitch_update(&profileSwitch, currentTime)) {
+    applyProfile(profileSwitch.position);
+  }
+  
   // Update pedal service (handles pedal reading and events)
   pedalService_update(&pedalService);
   
@@ -341,18 +439,33 @@ void loop() {
   // Update LED service
   ledService_update(&ledService, currentTime);
   
-  // Battery optimization: Variable delay based on pairing status
-  if (pairingState_isPaired(&pairingState)) {
-    delay(IDLE_DELAY_PAIRED);
-  } else {
-    delay(IDLE_DELAY_UNPAIRED);
+  // Battery optimization: Variable delay based on pairing status. A pedal edge
+  // ends it early, and a pending press shortens it to its debounce deadline.
+  unsigned long idleDelay = pairingState_isPaired(&pairingState) ? activeProfile->idleDelayMs : IDLE_DELAY_UNPAIRED;
+  if (pedalService.analog) {
+    // Rapid trigger reacts to travel, so drain the conversions often
+    halClock_idle(pairingState_isPaired(&pairingState) ? ANALOG_UPDATE_MS : idleDelay);
+    return;
   }
+  halClock_idle(pedalReader_idleTimeout(&pedalReader, idleDelay));
 }
 
 // Include implementation files (Arduino IDE doesn't auto-compile .cpp files in subdirectories)
 #include "domain/PairingState.cpp"
-#include "domain/PedalReader.cpp"
+#include "domain/PedalLatch.cpp"
+#include "domain/AnalogPedal.cpp"
+#include "shared/PedalReader.cpp"
+#include "shared/EspNowSendTracker.cpp"
+#include "shared/PedalEventQueue.cpp"
 #include "infrastructure/EspNowTransport.cpp"
 #include "infrastructure/LEDService.cpp"
+#include "infrastructure/ProfileSwitch.cpp"
 #include "application/PairingService.cpp"
 #include "application/PedalService.cpp"
+
+// HAL implementation for the target board (host builds define HAL_HOST and link hal/host instead)
+#ifndef HAL_HOST
+#include "shared/hal/esp32/HalSystem.cpp"
+#include "shared/hal/esp32/HalRadio.cpp"
+#include "shared/hal/esp32/HalAdc.cpp"
+#endif
@@ -1,54 +1,431 @@
 #include "KeyboardService.h"
-#include <USB.h>
-#include <USBHIDKeyboard.h>
 #include <string.h>
-#include <Arduino.h>
-
-USBHIDKeyboard Keyboard;
+#include "../shared/hal/Hal.h"
+#include "../shared/MessageCodec.h"
 
 void keyboardService_init(KeyboardService* service, TransmitterManager* manager) {
   service->manager = manager;
   memset(service->keysPressed, 0, sizeof(service->keysPressed));
+  service->buttonsPressed = 0;
+  memset(service->axes, 0, sizeof(service->axes));
+  service->outputMode = HID_OUTPUT_KEYBOARD;
+  service->scheduleMode = HID_SCHEDULE_IMMEDIATE;
+  service->frameArrivalMicros = 0;
+  service->reportPending = false;
+  service->pendingCount = 0;
+  service->lastPickupMicros = -1;
+  memset(&service->latency, 0, sizeof(service->latency));
+  macroEngine_init(&service->macros);
+  service->macroSlotsHeld = 0;
+  socdResolver_init(&service->socd);
+  memset(service->slotModifiers, 0, sizeof(service->slotModifiers));
+  service->modifiersHeld = 0;
+  
+  halHid_begin();
+}
+
+// The pending report changed: remember when, to measure its latency
+static void keyboardService_noteChange(KeyboardService* service) {
+  service->reportPending = true;
+  
+  if (service->pendingCount < HID_LATENCY_MAX_PENDING) {
+    PendingKeyChange* change = &service->pending[service->pendingCount++];
+    change->arrivalMicros = service->frameArrivalMicros;
+    change->handledMicros = halClock_micros();
+  }
+}
+
+static void keyboardService_sendKey(KeyboardService* service, char key, bool pressed) {
+  uint8_t keyIndex = (uint8_t)key;
+  if (service->keysPressed[keyIndex] == pressed) return;
+  
+  if (pressed) {
+    halHid_press(key);
+  } else {
+    halHid_release(key);
+  }
+  service->keysPressed[keyIndex] = pressed;
+  keyboardService_noteChange(service);
+}
+
+// Key changes pass through SOCD resolution on their way out, in the same
+// report; a partner is released before the key that displaces it is pressed
+static void keyboardService_setKey(KeyboardService* service, char key, bool pressed) {
+  bool keyOut;
+  bool partnerOut;
+  char partner = socdResolver_resolve(&service->socd, key, pressed, &keyOut, &partnerOut);
+  if (partner && !partnerOut) keyboardService_sendKey(service, partner, false);
+  keyboardService_sendKey(service, key, keyOut);
+  if (partner && partnerOut) keyboardService_sendKey(service, partner, true);
+}
+
+// Modifiers a slot's binding holds while its pedal is down; the report holds
+// every slot's at once
+static void keyboardService_holdModifiers(KeyboardService* service, uint8_t slot, uint8_t modifiers) {
+  if (slot >= MAX_PEDAL_SLOTS || service->slotModifiers[slot] == modifiers) return;
+  service->slotModifiers[slot] = modifiers;
+  
+  uint8_t held = 0;
+  for (int i = 0; i < MAX_PEDAL_SLOTS; i++) held |= service->slotModifiers[i];
+  if (held == service->modifiersHeld) return;
+  halHid_setModifiers(held);
+  service->modifiersHeld = held;
+  keyboardService_noteChange(service);
+}
+
+static void keyboardService_setButton(KeyboardService* service, int button, bool pressed) {
+  if (button < 0 || button >= HAL_HID_GAMEPAD_BUTTONS) return;
+  uint16_t bit = (uint16_t)(1 << button);
+  if (((service->buttonsPressed & bit) != 0) == pressed) return;
+  
+  halHid_setButton((uint8_t)button, pressed);
+  service->buttonsPressed = pressed ? (service->buttonsPressed | bit) : (service->buttonsPressed & (uint16_t)~bit);
+  keyboardService_noteChange(service);
+}
+
+// Analog travel only has somewhere to go in gamepad mode. Axis changes send a
+// report but are not key changes, so they stay out of the latency figures.
+static void keyboardService_setAxis(KeyboardService* service, int axis, uint8_t value) {
+  if (axis < 0 || axis >= HAL_HID_GAMEPAD_AXES || service->axes[axis] == value) return;
   
-  USB.begin();
-  delay(500);
-  Keyboard.begin();
-  delay(2000);
+  halHid_setAxis((uint8_t)axis, value);
+  service->axes[axis] = value;
+  service->reportPending = true;
 }
 
-void keyboardService_handlePedalEvent(KeyboardService* service, const uint8_t* txMAC, 
-                                       const struct_message* msg) {
-  int transmitterIndex = transmitterManager_findIndex(service->manager, txMAC);
+// Macro steps and autofire toggles count as key changes arriving at their due
+// time, so the latency figures show how long each took to reach the host
+static void keyboardService_applyTimedOutput(void* arg, uint8_t output, bool pressed, int64_t dueMicros) {
+  KeyboardService* service = (KeyboardService*)arg;
+  int64_t arrivalMicros = service->frameArrivalMicros;
+  service->frameArrivalMicros = dueMicros;
+  if (service->outputMode == HID_OUTPUT_GAMEPAD) {
+    keyboardService_setButton(service, output, pressed);
+  } else {
+    keyboardService_setKey(service, (char)output, pressed);
+  }
+  service->frameArrivalMicros = arrivalMicros;
+}
+
+// Tracks the pedal on a macro or autofire slot; true on a press or release,
+// false on a repeat of its current state
+static bool keyboardService_holdSlot(KeyboardService* service, int slot, bool pressed) {
+  uint32_t bit = (uint32_t)1 << slot;
+  bool wasHeld = service->macroSlotsHeld & bit;
+  service->macroSlotsHeld = pressed ? (service->macroSlotsHeld | bit) : (service->macroSlotsHeld & ~bit);
+  return pressed != wasHeld;
+}
+
+// Drives a pedal's output in the current mode; false if the pedal is not mapped
+static bool keyboardService_setPedal(KeyboardService* service, int transmitterIndex, char pedalKey, bool pressed) {
+  const PedalBinding* binding = transmitterManager_binding(service->manager, transmitterIndex, pedalKey);
+  int slot = binding->slot;
+  if (slot >= MAX_PEDAL_SLOTS) return false;
+  
+  // A mapped pedal is '1' or '2'; the pedal's profile overrides its saved key
+  const TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  uint8_t pedal = (uint8_t)(pedalKey - '1');
+  char key = transmitter->profileKeys[pedal] ? transmitter->profileKeys[pedal] : binding->key;
+  uint8_t modifiers = transmitter->profileKeys[pedal] ? transmitter->profileModifiers[pedal] : binding->modifiers;
+  if (service->outputMode == HID_OUTPUT_KEYBOARD) {
+    keyboardService_holdModifiers(service, slot, pressed ? modifiers : 0);
+  }
+  
+  // An autofire slot toggles its key or button on the frame grid while held,
+  // with the first press on this cycle. Every slot has a gamepad button, button
+  // 0 included; only a keyboard slot can be unmapped.
+  if (macroEngine_hasAutofire(&service->macros, slot)) {
+    bool gamepad = service->outputMode == HID_OUTPUT_GAMEPAD;
+    if (pressed && !gamepad && !key) return false;
+    if (!keyboardService_holdSlot(service, slot, pressed)) return true;
+    if (pressed) {
+      uint8_t output = gamepad ? (uint8_t)slot : (uint8_t)key;
+      macroEngine_startAutofire(&service->macros, slot, output, halClock_micros());
+      keyboardService_runMacros(service);
+    } else {
+      macroEngine_stopAutofire(&service->macros, slot, keyboardService_applyTimedOutput, service, halClock_micros());
+    }
+    return true;
+  }
+  
+  if (service->outputMode == HID_OUTPUT_GAMEPAD) {
+    keyboardService_setButton(service, slot, pressed);
+    return true;
+  }
+  
+  // A slot with a macro types its steps, starting on this cycle
+  if (macroEngine_hasMacro(&service->macros, slot)) {
+    if (keyboardService_holdSlot(service, slot, pressed) && pressed &&
+        macroEngine_trigger(&service->macros, slot, halClock_micros())) {
+      keyboardService_runMacros(service);
+    }
+    return true;
+  }
+  
+  if (!key) return false;
+  keyboardService_setKey(service, key, pressed);
+  return true;
+}
+
+// First copy of a burst wins, and a late resend of an older frame must not undo
+// a newer one. A snapshot may repeat the last seq: keepalives carry it again with
+// the same state. seq 0 comes from firmware that does not burst.
+static bool keyboardService_isDuplicate(TransmitterInfo* transmitter, uint8_t seq, bool repeatApplies,
+                                        unsigned long now) {
+  if (seq == 0) return false;
+  if (transmitter->lastSeq != 0 && now - transmitter->lastSeqTime < PEDAL_EVENT_SEQ_RESET_MS) {
+    int8_t newer = (int8_t)(seq - transmitter->lastSeq);  // Serial-number order, wraps past 255
+    if (newer < 0 || (newer == 0 && !repeatApplies)) return true;
+  }
+  transmitter->lastSeq = seq;
+  transmitter->lastSeqTime = now;
+  return false;
+}
+
+bool keyboardService_handlePedalEvent(KeyboardService* service, int transmitterIndex,
+                                      const struct_message* msg, int len) {
   if (transmitterIndex < 0) {
-    return;  // Unknown transmitter
+    return false;  // Unknown transmitter
   }
   
+  TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  unsigned long now = halClock_millis();
+  
   // Update last seen
-  service->manager->transmitters[transmitterIndex].lastSeen = millis();
+  transmitter->lastSeen = now;
+  
+  if (keyboardService_isDuplicate(transmitter, messageCodec_seq(msg, len), false, now)) {
+    return false;
+  }
+  
+  return keyboardService_setPedal(service, transmitterIndex, msg->key, msg->pressed);
+}
+
+bool keyboardService_handlePedalSnapshot(KeyboardService* service, int transmitterIndex,
+                                         const pedal_snapshot_message* msg) {
+  if (transmitterIndex < 0) {
+    return false;  // Unknown transmitter
+  }
+  
+  TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  unsigned long now = halClock_millis();
+  transmitter->lastSeen = now;
+  
+  if (keyboardService_isDuplicate(transmitter, msg->seq, true, now)) {
+    return false;
+  }
+  transmitter->lastSnapshotTime = now;
+  
+  // Reconcile every pedal, not just the one that changed: this repairs any
+  // earlier frame that was lost
+  uint8_t changed = transmitter->pedalMask ^ msg->pedalMask;
+  transmitter->pedalMask = msg->pedalMask;
+  for (uint8_t pedal = 0; pedal < 2; pedal++) {
+    keyboardService_setPedal(service, transmitterIndex, '1' + pedal, msg->pedalMask & (1 << pedal));
+  }
+  return changed != 0;
+}
+
+bool keyboardService_handlePedalPosition(KeyboardService* service, int transmitterIndex,
+                                         const pedal_position_message* msg, int len) {
+  if (transmitterIndex < 0) {
+    return false;  // Unknown transmitter
+  }
+  
+  TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  transmitter->lastSeen = halClock_millis();
   
-  // Determine key to press
-  char keyToPress;
-  if (service->manager->transmitters[transmitterIndex].pedalMode == 0) {
-    // DUAL pedal: '1' -> 'l', '2' -> 'r'
-    keyToPress = (msg->key == '1') ? 'l' : 'r';
+  uint8_t seq = msg->seq & PEDAL_POSITION_SEQ_MASK;
+  if (msg->seq & PEDAL_POSITION_KEYFRAME) {
+    if (len < (int)sizeof(pedal_position_message)) return false;
+    memcpy(transmitter->positions, msg->positions, sizeof(transmitter->positions));
+    transmitter->positionsValid = true;
   } else {
-    // SINGLE pedal: '1' -> assigned key based on pairing order
-    if (msg->key != '1') return;
-    keyToPress = transmitterManager_getAssignedKey(service->manager, transmitterIndex);
+    // A delta only applies on top of the frame right before it
+    if (!transmitter->positionsValid || seq != ((transmitter->positionSeq + 1) & PEDAL_POSITION_SEQ_MASK)) {
+      transmitter->positionsValid = false;
+      return false;
+    }
+    for (uint8_t pedal = 0; pedal < 2; pedal++) {
+      int position = transmitter->positions[pedal] + messageCodec_positionDelta(msg->positions[0], pedal);
+      transmitter->positions[pedal] = (uint8_t)(position < 0 ? 0 : (position > 255 ? 255 : position));
+    }
+  }
+  transmitter->positionSeq = seq;
+  
+  if (service->outputMode == HID_OUTPUT_GAMEPAD) {
+    for (uint8_t pedal = 0; pedal < 2; pedal++) {
+      keyboardService_setAxis(service, transmitterManager_binding(service->manager, transmitterIndex, '1' + pedal)->slot,
+                              transmitter->positions[pedal]);
+    }
+  }
+  return true;
+}
+
+bool keyboardService_handlePedalProfile(KeyboardService* service, int transmitterIndex,
+                                        const pedal_profile_message* msg) {
+  if (transmitterIndex < 0) {
+    return false;  // Unknown transmitter
   }
   
-  uint8_t keyIndex = (uint8_t)keyToPress;
+  TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  transmitter->lastSeen = halClock_millis();
   
-  if (msg->pressed) {
-    if (!service->keysPressed[keyIndex]) {
-      Keyboard.press(keyToPress);
-      service->keysPressed[keyIndex] = true;
+  // The profile overrides the saved binding without replacing it: key 0 goes
+  // back to the binding. A held pedal lets go of its old key and carries over
+  // to the new one.
+  bool changed = false;
+  for (uint8_t pedal = 0; pedal < 2; pedal++) {
+    char key = msg->keys[pedal];
+    uint8_t modifiers = key ? msg->modifiers[pedal] : 0;
+    if (transmitter->profileKeys[pedal] == key && transmitter->profileModifiers[pedal] == modifiers) {
+      continue;
     }
-  } else {
-    if (service->keysPressed[keyIndex]) {
-      Keyboard.release(keyToPress);
-      service->keysPressed[keyIndex] = false;
+    bool held = transmitter->pedalMask & (1 << pedal);
+    if (held) keyboardService_setPedal(service, transmitterIndex, '1' + pedal, false);
+    transmitter->profileKeys[pedal] = key;
+    transmitter->profileModifiers[pedal] = modifiers;
+    if (held) keyboardService_setPedal(service, transmitterIndex, '1' + pedal, true);
+    changed = true;
+  }
+  return changed;
+}
+
+// Releases the keys (and centres the axes) of a transmitter that went silent with pedals held
+void keyboardService_update(KeyboardService* service, unsigned long currentTime) {
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    TransmitterInfo* transmitter = &service->manager->transmitters[i];
+    if (!transmitter->paired || transmitter->pedalMask == 0 ||
+        currentTime - transmitter->lastSnapshotTime <= PEDAL_SNAPSHOT_TIMEOUT_MS) {
+      continue;
+    }
+    for (uint8_t pedal = 0; pedal < 2; pedal++) {
+      if (transmitter->pedalMask & (1 << pedal)) {
+        keyboardService_setPedal(service, i, '1' + pedal, false);
+      }
+      if (transmitter->positionsValid && service->outputMode == HID_OUTPUT_GAMEPAD) {
+        keyboardService_setAxis(service, transmitter->bindings[pedal].slot, 0);
+      }
     }
+    transmitter->pedalMask = 0;
+    transmitter->positionsValid = false;
+    memset(transmitter->positions, 0, sizeof(transmitter->positions));
   }
 }
 
+void keyboardService_setOutputMode(KeyboardService* service, uint8_t mode) {
+  if (mode == service->outputMode) return;
+  
+  // Nothing stays held on the output being left, and no macro keeps typing;
+  // held autofire slots start over on the new output
+  macroEngine_cancelAll(&service->macros);
+  service->macroSlotsHeld = 0;
+  socdResolver_releaseAll(&service->socd);
+  for (int slot = 0; slot < MAX_PEDAL_SLOTS; slot++) {
+    keyboardService_holdModifiers(service, (uint8_t)slot, 0);
+  }
+  for (int key = 0; key < 256; key++) {
+    if (service->keysPressed[key]) keyboardService_sendKey(service, (char)key, false);
+  }
+  for (int button = 0; button < HAL_HID_GAMEPAD_BUTTONS; button++) {
+    keyboardService_setButton(service, button, false);
+  }
+  for (int axis = 0; axis < HAL_HID_GAMEPAD_AXES; axis++) {
+    keyboardService_setAxis(service, axis, 0);
+  }
+  
+  // Pedals held per their last snapshot carry over; pedals on legacy events
+  // come back with their next press
+  service->outputMode = mode;
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (!service->manager->transmitters[i].paired) continue;
+    for (uint8_t pedal = 0; pedal < 2; pedal++) {
+      if (service->manager->transmitters[i].pedalMask & (1 << pedal)) {
+        // A held pedal does not start its macro; the next press will
+        int slot = service->manager->transmitters[i].bindings[pedal].slot;
+        if (macroEngine_hasMacro(&service->macros, slot)) service->macroSlotsHeld |= (uint32_t)1 << slot;
+        keyboardService_setPedal(service, i, '1' + pedal, true);
+      }
+      if (mode == HID_OUTPUT_GAMEPAD && service->manager->transmitters[i].positionsValid) {
+        keyboardService_setAxis(service, service->manager->transmitters[i].bindings[pedal].slot,
+                                service->manager->transmitters[i].positions[pedal]);
+      }
+    }
+  }
+}
+
+void keyboardService_setMacro(KeyboardService* service, int slot, const Macro* macro) {
+  macroEngine_assign(&service->macros, slot, macro);
+  if (slot >= 0 && slot < MACRO_SLOTS) service->macroSlotsHeld &= ~((uint32_t)1 << slot);
+}
+
+void keyboardService_setAutofire(KeyboardService* service, int slot, uint8_t framesPerToggle) {
+  macroEngine_assignAutofire(&service->macros, slot, framesPerToggle);
+  if (slot >= 0 && slot < MACRO_SLOTS) service->macroSlotsHeld &= ~((uint32_t)1 << slot);
+}
+
+bool keyboardService_setSocd(KeyboardService* service, char first, char second, uint8_t policy) {
+  return socdResolver_addPair(&service->socd, first, second, policy);
+}
+
+void keyboardService_setScheduleMode(KeyboardService* service, uint8_t mode) {
+  service->scheduleMode = mode;
+}
+
+void keyboardService_setFrameArrival(KeyboardService* service, int64_t arrivalMicros) {
+  service->frameArrivalMicros = arrivalMicros;
+}
+
+// Time until the report should be staged for the host's next poll, or 0 to
+// send now. Polls follow the last pickup at whole intervals; a report staged
+// any earlier would only sit in the endpoint while later changes miss it.
+static uint32_t keyboardService_untilStage(const KeyboardService* service, int64_t now) {
+  int64_t last = service->lastPickupMicros;
+  if (last < 0 || now - last > HID_POLL_PHASE_VALID_MS * 1000LL) return 0;
+  
+  int64_t nextPoll = last + ((now - last) / HAL_HID_POLL_INTERVAL_US + 1) * HAL_HID_POLL_INTERVAL_US;
+  int64_t stageAt = nextPoll - HID_STAGE_LEAD_US;
+  return stageAt > now ? (uint32_t)(stageAt - now) : 0;
+}
+
+uint32_t keyboardService_flush(KeyboardService* service) {
+  if (!service->reportPending) return 0;
+  
+  int64_t stagedMicros = halClock_micros();
+  if (service->scheduleMode == HID_SCHEDULE_FRAME_ALIGNED) {
+    uint32_t wait = keyboardService_untilStage(service, stagedMicros);
+    if (wait) return wait;
+  }
+  
+  int64_t pickupMicros = halHid_flush();
+  service->reportPending = false;
+  if (pickupMicros >= 0) {
+    service->lastPickupMicros = pickupMicros;
+    for (int i = 0; i < service->pendingCount; i++) {
+      const PendingKeyChange* change = &service->pending[i];
+      HidLatencyStats* latency = &service->latency;
+      latency->events++;
+      latency->ringMicros += change->handledMicros - change->arrivalMicros;
+      latency->holdMicros += stagedMicros - change->handledMicros;
+      latency->usbMicros += pickupMicros - stagedMicros;
+      uint32_t total = (uint32_t)(pickupMicros - change->arrivalMicros);
+      if (total > latency->worstMicros) latency->worstMicros = total;
+    }
+  }
+  service->pendingCount = 0;
+  return 0;
+}
+
+uint32_t keyboardService_runMacros(KeyboardService* service) {
+  if (!service->macros.runningSlots) return 0;  // No clock read on the common path
+  return macroEngine_run(&service->macros, halClock_micros(), keyboardService_applyTimedOutput, service);
+}
+
+void keyboardService_takeMacroJitter(KeyboardService* service, MacroJitterStats* stats) {
+  macroEngine_takeJitter(&service->macros, stats);
+}
+
+void keyboardService_takeLatency(KeyboardService* service, HidLatencyStats* stats) {
+  *stats = service->latency;
+  memset(&service->latency, 0, sizeof(service->latency));
+}
@@ -4,16 +4,93 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../domain/TransmitterManager.h"
+#include "../domain/MacroEngine.h"
+#include "../domain/SocdResolver.h"
 #include "../shared/messages.h"
+#include "../shared/hal/Hal.h"
+
+// A seq that is not newer than the last one accepted from the same transmitter
+// is a burst copy or a late resend, however late it arrives. The counter is
+// trusted afresh once the transmitter re-pairs or announces itself online (it
+// restarted counting), or after this long without a sequenced frame.
+#define PEDAL_EVENT_SEQ_RESET_MS 1000
+
+// What the pedals drive
+#define HID_OUTPUT_KEYBOARD 0  // Each pedal's bound key ('l', 'r' unless remapped)
+#define HID_OUTPUT_GAMEPAD 1   // One gamepad button per pedal slot
+
+// When the pending HID report is handed to USB
+#define HID_SCHEDULE_IMMEDIATE 0      // As soon as the HID task has handled the frames that woke it
+#define HID_SCHEDULE_FRAME_ALIGNED 1  // Just before the host's next poll, so later changes still join it
+#define HID_STAGE_LEAD_US 250         // Frame-aligned: stage this long before the predicted poll
+#define HID_POLL_PHASE_VALID_MS 2000  // Poll timing learned longer ago than this has drifted; send at once
+
+#define HID_LATENCY_MAX_PENDING 8  // Key changes per report whose latency is measured
+
+// Where the time goes between a pedal frame arriving and the host seeing it
+typedef struct {
+  uint32_t events;
+  uint64_t ringMicros;   // onMessageReceived -> handled on the HID task
+  uint64_t holdMicros;   // Handled -> report staged
+  uint64_t usbMicros;    // Staged -> picked up by the host's IN token
+  uint32_t worstMicros;  // onMessageReceived -> picked up
+} HidLatencyStats;
+
+typedef struct {
+  int64_t arrivalMicros;
+  int64_t handledMicros;
+} PendingKeyChange;
 
 typedef struct {
   TransmitterManager* manager;
   bool keysPressed[256];
+  uint16_t buttonsPressed;  // Bit n = gamepad button n
+  uint8_t axes[HAL_HID_GAMEPAD_AXES];  // Gamepad axis n follows the travel of the pedal on button n
+  uint8_t outputMode;
+  uint8_t scheduleMode;
+  int64_t frameArrivalMicros;  // Arrival of the frame being handled
+  bool reportPending;
+  PendingKeyChange pending[HID_LATENCY_MAX_PENDING];
+  int pendingCount;
+  int64_t lastPickupMicros;  // -1 until the first report; host polls are a whole interval apart from it
+  HidLatencyStats latency;
+  MacroEngine macros;
+  uint32_t macroSlotsHeld;  // Bit n = the pedal on macro or autofire slot n is down; both start on the press only
+  SocdResolver socd;  // Between the pedals and keysPressed, which holds what was sent
+  uint8_t slotModifiers[MAX_PEDAL_SLOTS];  // Modifiers each slot's held pedal adds, keyboard output
+  uint8_t modifiersHeld;                   // All of them, as last sent
 } KeyboardService;
 
 void keyboardService_init(KeyboardService* service, TransmitterManager* manager);
-void keyboardService_handlePedalEvent(KeyboardService* service, const uint8_t* txMAC, 
-                                       const struct_message* msg);
+// Frame handlers take the sender's transmitter ID, looked up once per frame;
+// -1 (unknown sender) is ignored
+bool keyboardService_handlePedalEvent(KeyboardService* service, int transmitterIndex,
+                                      const struct_message* msg, int len);  // false if unknown or a duplicate
+bool keyboardService_handlePedalSnapshot(KeyboardService* service, int transmitterIndex,
+                                         const pedal_snapshot_message* msg);  // true if a pedal changed
+bool keyboardService_handlePedalPosition(KeyboardService* service, int transmitterIndex,
+                                         const pedal_position_message* msg, int len);  // true if applied
+bool keyboardService_handlePedalProfile(KeyboardService* service, int transmitterIndex,
+                                        const pedal_profile_message* msg);  // true if a pedal's key changed
+void keyboardService_update(KeyboardService* service, unsigned long currentTime);
+void keyboardService_setOutputMode(KeyboardService* service, uint8_t mode);  // Moves held pedals across
+void keyboardService_setMacro(KeyboardService* service, int slot, const Macro* macro);  // Keyboard output only
+// Either output: toggles the slot's key or button every framesPerToggle frames
+// while held (1 = 30 presses a second, 2 = 15); 0 turns autofire off
+void keyboardService_setAutofire(KeyboardService* service, int slot, uint8_t framesPerToggle);
+// Keyboard output: what a pair of keys sends while both are held (SOCD_*);
+// pairs are set once, before any key is pressed
+bool keyboardService_setSocd(KeyboardService* service, char first, char second, uint8_t policy);
+void keyboardService_setScheduleMode(KeyboardService* service, uint8_t mode);
+void keyboardService_setFrameArrival(KeyboardService* service, int64_t arrivalMicros);  // Before handling a frame
+// Sends every key change so far as one HID report. Returns 0, or in
+// frame-aligned mode the microseconds to wait before calling it again.
+uint32_t keyboardService_flush(KeyboardService* service);
+// Applies the macro steps and autofire toggles due by now. Returns 0, or the
+// microseconds until the next one, when it should be called again.
+uint32_t keyboardService_runMacros(KeyboardService* service);
+void keyboardService_takeMacroJitter(KeyboardService* service, MacroJitterStats* stats);  // Copies and resets
+void keyboardService_takeLatency(KeyboardService* service, HidLatencyStats* stats);  // Copies and resets
 
 #endif // KEYBOARD_SERVICE_H
 
@@ -1,7 +1,6 @@
 #include "PairingService.h"
-#include <WiFi.h>
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 
 void receiverPairingService_init(ReceiverPairingService* service, TransmitterManager* manager, 
                                   ReceiverEspNowTransport* transport, unsigned long bootTime) {
@@ -14,25 +13,55 @@ void receiverPairingService_init(ReceiverPairingService* service, TransmitterMan
   service->waitingForAliveResponses = false;
   service->aliveResponseTimeout = 0;
   memset(service->transmitterResponded, false, sizeof(service->transmitterResponded));
+  service->newTransmitterInvited = false;
+  service->inviteTime = 0;
+  service->lastInviteTime = 0;
 }
 
-void receiverPairingService_handleDiscoveryRequest(ReceiverPairingService* service, const uint8_t* txMAC, 
-                                                    uint8_t pedalMode, uint8_t channel, unsigned long currentTime) {
-  int knownIndex = transmitterManager_findIndex(service->manager, txMAC);
-  bool isKnownTransmitter = (knownIndex >= 0);
+// MSG_DISCOVERY_RESP or MSG_ALIVE carrying what we accept from this
+// transmitter: the negotiated set once it has told us its own, else everything
+static handshake_message receiverPairingService_handshake(ReceiverPairingService* service, uint8_t msgType,
+                                                          int transmitterIndex) {
+  handshake_message msg = {msgType, 0, false, 0, 0, PROTOCOL_VERSION, PROTOCOL_CAPABILITIES};
+  if (transmitterIndex >= 0 && service->manager->transmitters[transmitterIndex].protocolVersion != 0) {
+    msg.capabilities = service->manager->transmitters[transmitterIndex].capabilities;
+  }
+  return msg;
+}
+
+static void receiverPairingService_sendAlive(ReceiverPairingService* service, const uint8_t* txMAC,
+                                             int transmitterIndex) {
+  handshake_message alive = receiverPairingService_handshake(service, MSG_ALIVE, transmitterIndex);
+  receiverEspNowTransport_send(service->transport, txMAC, (uint8_t*)&alive, sizeof(alive));
+}
+
+static void receiverPairingService_setProtocol(ReceiverPairingService* service, int transmitterIndex,
+                                               PeerProtocol peer) {
+  TransmitterInfo* transmitter = &service->manager->transmitters[transmitterIndex];
+  transmitter->protocolVersion = peer.version;
+  transmitter->capabilities = messageCodec_negotiate(peer);
+}
+
+void receiverPairingService_handleDiscoveryRequest(ReceiverPairingService* service, const uint8_t* txMAC,
+                                                    int transmitterIndex, uint8_t pedalMode, PeerProtocol peer,
+                                                    uint8_t channel, unsigned long currentTime) {
+  bool isKnownTransmitter = (transmitterIndex >= 0);
+  bool isInvited = service->newTransmitterInvited && memcmp(txMAC, service->pendingNewTransmitterMAC, 6) == 0;
   
   unsigned long timeSinceBoot = currentTime - service->bootTime;
   bool inDiscoveryPeriod = (timeSinceBoot < TRANSMITTER_TIMEOUT);
   
-  // After grace period, only accept known transmitters
-  if (!inDiscoveryPeriod && !isKnownTransmitter) {
+  // After grace period, only accept known transmitters and the one a
+  // replacement made room for
+  if (!inDiscoveryPeriod && !isKnownTransmitter && !isInvited) {
     return;  // Rejected
   }
   
   if (isKnownTransmitter) {
     // Mark as seen
-    service->manager->transmitters[knownIndex].seenOnBoot = true;
-    service->manager->transmitters[knownIndex].lastSeen = currentTime;
+    service->manager->transmitters[transmitterIndex].seenOnBoot = true;
+    service->manager->transmitters[transmitterIndex].lastSeen = currentTime;
+    service->manager->transmitters[transmitterIndex].lastSeq = 0;  // Its events count afresh
   }
   
   // Check if receiver is full
@@ -48,56 +77,61 @@ void receiverPairingService_handleDiscoveryRequest(ReceiverPairingService* servi
   // Add as peer and send response
   receiverEspNowTransport_addPeer(service->transport, txMAC, channel);
   
-  struct_message response = {MSG_DISCOVERY_RESP, 0, false, 0};
+  handshake_message response = {MSG_DISCOVERY_RESP, 0, false, 0, 0, PROTOCOL_VERSION, messageCodec_negotiate(peer)};
   if (receiverEspNowTransport_send(service->transport, txMAC, (uint8_t*)&response, sizeof(response))) {
-    transmitterManager_add(service->manager, txMAC, pedalMode);
+    int index = transmitterManager_add(service->manager, txMAC, pedalMode);
+    if (index >= 0) receiverPairingService_setProtocol(service, index, peer);
+    if (index >= 0 && isInvited) {
+      service->newTransmitterInvited = false;
+      memset(service->pendingNewTransmitterMAC, 0, 6);
+    }
   }
 }
 
-void receiverPairingService_handleTransmitterOnline(ReceiverPairingService* service, const uint8_t* txMAC, 
-                                                     uint8_t channel) {
-  int transmitterIndex = transmitterManager_findIndex(service->manager, txMAC);
-  
+void receiverPairingService_handleTransmitterOnline(ReceiverPairingService* service, const uint8_t* txMAC,
+                                                     int transmitterIndex, PeerProtocol peer, uint8_t channel) {
   if (transmitterIndex >= 0) {
-    // Known transmitter
+    // Known transmitter, possibly reflashed since it paired; it booted, so its seq restarted
+    receiverPairingService_setProtocol(service, transmitterIndex, peer);
+    service->manager->transmitters[transmitterIndex].lastSeq = 0;
+    
     if (service->manager->slotsUsed >= MAX_PEDAL_SLOTS) {
       return;  // Receiver full, don't send MSG_ALIVE
     }
     
     receiverEspNowTransport_addPeer(service->transport, txMAC, channel);
+    receiverPairingService_sendAlive(service, txMAC, transmitterIndex);
     
-    struct_message alive = {MSG_ALIVE, 0, false, 0};
-    receiverEspNowTransport_send(service->transport, txMAC, (uint8_t*)&alive, sizeof(alive));
-    
-    service->manager->transmitters[transmitterIndex].lastSeen = millis();
+    service->manager->transmitters[transmitterIndex].lastSeen = halClock_millis();
   } else {
-    // Unknown transmitter - if receiver is full, try to replace unresponsive transmitters
-    if (service->manager->slotsUsed >= MAX_PEDAL_SLOTS) {
+    // Unknown transmitter - if receiver is full, try to replace unresponsive
+    // transmitters; one round at a time, or a repeated announcement would
+    // restart it and forget who already answered
+    if (service->manager->slotsUsed >= MAX_PEDAL_SLOTS && !service->waitingForAliveResponses) {
       memcpy(service->pendingNewTransmitterMAC, txMAC, 6);
+      service->newTransmitterInvited = false;
       
-      // Ping all paired transmitters
-      struct_message ping = {MSG_ALIVE, 0, false, 0};
-      for (int i = 0; i < service->manager->count; i++) {
+      // Ping all paired transmitters; they answer, and any frame they send counts
+      for (int i = 0; i < MAX_TRANSMITTERS; i++) {
         service->transmitterResponded[i] = false;
-        receiverEspNowTransport_send(service->transport, service->manager->transmitters[i].mac, 
-                                     (uint8_t*)&ping, sizeof(ping));
+        if (!service->manager->transmitters[i].paired) continue;
+        receiverPairingService_sendAlive(service, service->manager->transmitters[i].mac, i);
       }
       
       service->waitingForAliveResponses = true;
-      service->aliveResponseTimeout = millis() + ALIVE_RESPONSE_TIMEOUT;
+      service->aliveResponseTimeout = halClock_millis() + ALIVE_RESPONSE_TIMEOUT;
     }
   }
 }
 
-void receiverPairingService_handleTransmitterPaired(ReceiverPairingService* service, 
+// The transmitter broadcasts this about itself, so its ID is the sender's
+void receiverPairingService_handleTransmitterPaired(ReceiverPairingService* service, int transmitterIndex,
                                                      const transmitter_paired_message* msg) {
-  const uint8_t* txMAC = msg->transmitterMAC;
   const uint8_t* rxMAC = msg->receiverMAC;
   
   uint8_t ourMAC[6];
-  WiFi.macAddress(ourMAC);
+  halRadio_macAddress(ourMAC);
   
-  int transmitterIndex = transmitterManager_findIndex(service->manager, txMAC);
   bool pairedWithUs = (memcmp(rxMAC, ourMAC, 6) == 0);
   
   if (transmitterIndex >= 0 && !pairedWithUs) {
@@ -105,21 +139,17 @@ void receiverPairingService_handleTransmitterPaired(ReceiverPairingService* serv
     transmitterManager_remove(service->manager, transmitterIndex);
   } else if (transmitterIndex >= 0 && pairedWithUs) {
     // Transmitter paired with us - update last seen
-    service->manager->transmitters[transmitterIndex].lastSeen = millis();
+    service->manager->transmitters[transmitterIndex].lastSeen = halClock_millis();
     if (!service->gracePeriodCheckDone) {
       service->manager->transmitters[transmitterIndex].seenOnBoot = true;
     }
   }
 }
 
-void receiverPairingService_handleAlive(ReceiverPairingService* service, const uint8_t* txMAC) {
-  int transmitterIndex = transmitterManager_findIndex(service->manager, txMAC);
+// The frame itself already counted as a reply (receiverPairingService_noteFrame)
+void receiverPairingService_handleAlive(ReceiverPairingService* service, int transmitterIndex) {
   if (transmitterIndex >= 0) {
-    service->manager->transmitters[transmitterIndex].lastSeen = millis();
-    
-    if (service->waitingForAliveResponses) {
-      service->transmitterResponded[transmitterIndex] = true;
-    }
+    service->manager->transmitters[transmitterIndex].lastSeen = halClock_millis();
     
     if (!service->gracePeriodCheckDone) {
       service->manager->transmitters[transmitterIndex].seenOnBoot = true;
@@ -128,7 +158,7 @@ void receiverPairingService_handleAlive(ReceiverPairingService* service, const u
 }
 
 void receiverPairingService_sendBeacon(ReceiverPairingService* service) {
-  unsigned long timeSinceBoot = millis() - service->bootTime;
+  unsigned long timeSinceBoot = halClock_millis() - service->bootTime;
   if (timeSinceBoot >= TRANSMITTER_TIMEOUT) {
     return;  // Grace period ended
   }
@@ -139,26 +169,26 @@ void receiverPairingService_sendBeacon(ReceiverPairingService* service) {
   
   beacon_message beacon;
   beacon.msgType = MSG_BEACON;
-  WiFi.macAddress(beacon.receiverMAC);
+  halRadio_macAddress(beacon.receiverMAC);
   beacon.availableSlots = transmitterManager_getAvailableSlots(service->manager);
   beacon.totalSlots = MAX_PEDAL_SLOTS;
+  beacon.protocolVersion = PROTOCOL_VERSION;
+  beacon.capabilities = PROTOCOL_CAPABILITIES;
   
   receiverEspNowTransport_broadcast(service->transport, (uint8_t*)&beacon, sizeof(beacon));
 }
 
 void receiverPairingService_pingKnownTransmitters(ReceiverPairingService* service) {
-  unsigned long timeSinceBoot = millis() - service->bootTime;
+  unsigned long timeSinceBoot = halClock_millis() - service->bootTime;
   if (timeSinceBoot >= TRANSMITTER_TIMEOUT) {
     return;  // Grace period ended
   }
   
   if (service->manager->count == 0) return;
   
-  struct_message ping = {MSG_ALIVE, 0, false, 0};
-  for (int i = 0; i < service->manager->count; i++) {
-    if (!service->manager->transmitters[i].seenOnBoot) {
-      receiverEspNowTransport_send(service->transport, service->manager->transmitters[i].mac, 
-                                   (uint8_t*)&ping, sizeof(ping));
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (service->manager->transmitters[i].paired && !service->manager->transmitters[i].seenOnBoot) {
+      receiverPairingService_sendAlive(service, service->manager->transmitters[i].mac, i);
     }
   }
 }
@@ -183,28 +213,40 @@ void receiverPairingService_update(ReceiverPairingService* service, unsigned lon
   
   // Check for transmitter replacement timeout
   if (service->waitingForAliveResponses && currentTime >= service->aliveResponseTimeout) {
-    // Remove unresponsive transmitters
-    for (int i = service->manager->count - 1; i >= 0; i--) {
-      if (!service->transmitterResponded[i]) {
+    // Remove unresponsive transmitters; the others keep their IDs
+    for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+      if (service->manager->transmitters[i].paired && !service->transmitterResponded[i]) {
         transmitterManager_remove(service->manager, i);
       }
     }
     
-    // Send MSG_ALIVE to new transmitter if we have free slots
-    uint8_t broadcastMAC[] = BROADCAST_MAC;
-    if (service->manager->slotsUsed < MAX_PEDAL_SLOTS && 
-        memcmp(service->pendingNewTransmitterMAC, broadcastMAC, 6) != 0) {
+    // Invite the new transmitter into the freed slot: MSG_ALIVE brings its
+    // discovery request, which is let through even after the grace period
+    if (service->manager->slotsUsed < MAX_PEDAL_SLOTS) {
       receiverEspNowTransport_addPeer(service->transport, service->pendingNewTransmitterMAC, 0);
-      
-      struct_message alive = {MSG_ALIVE, 0, false, 0};
-      receiverEspNowTransport_send(service->transport, service->pendingNewTransmitterMAC, 
-                                   (uint8_t*)&alive, sizeof(alive));
+      receiverPairingService_sendAlive(service, service->pendingNewTransmitterMAC, -1);
+      service->newTransmitterInvited = true;
+      service->inviteTime = currentTime;
+      service->lastInviteTime = currentTime;
+    } else {
+      memset(service->pendingNewTransmitterMAC, 0, 6);
     }
     
     // Clear replacement state
     service->waitingForAliveResponses = false;
-    memset(service->pendingNewTransmitterMAC, 0, 6);
     service->aliveResponseTimeout = 0;
   }
+  
+  // Repeat the invitation until the new transmitter pairs: our MSG_ALIVE or
+  // its discovery request may have been lost. It lapses after a grace period.
+  if (service->newTransmitterInvited) {
+    if (service->manager->slotsUsed >= MAX_PEDAL_SLOTS || currentTime - service->inviteTime >= TRANSMITTER_TIMEOUT) {
+      service->newTransmitterInvited = false;
+      memset(service->pendingNewTransmitterMAC, 0, 6);
+    } else if (currentTime - service->lastInviteTime >= BEACON_INTERVAL) {
+      receiverPairingService_sendAlive(service, service->pendingNewTransmitterMAC, -1);
+      service->lastInviteTime = currentTime;
+    }
+  }
 }
 
@@ -6,6 +6,7 @@
 #include "../domain/TransmitterManager.h"
 #include "../infrastructure/EspNowTransport.h"
 #include "../shared/messages.h"
+#include "../shared/MessageCodec.h"
 
 #define BEACON_INTERVAL 2000
 #define TRANSMITTER_TIMEOUT 30000  // 30 seconds
@@ -22,18 +23,30 @@ typedef struct {
   uint8_t pendingNewTransmitterMAC[6];
   bool waitingForAliveResponses;
   unsigned long aliveResponseTimeout;
-  bool transmitterResponded[MAX_PEDAL_SLOTS];
+  bool transmitterResponded[MAX_TRANSMITTERS];  // By transmitter ID; any frame counts
+  bool newTransmitterInvited;  // pendingNewTransmitterMAC may pair after the grace period
+  unsigned long inviteTime;
+  unsigned long lastInviteTime;
 } ReceiverPairingService;
 
 void receiverPairingService_init(ReceiverPairingService* service, TransmitterManager* manager, 
                                   ReceiverEspNowTransport* transport, unsigned long bootTime);
-void receiverPairingService_handleDiscoveryRequest(ReceiverPairingService* service, const uint8_t* txMAC, 
-                                                    uint8_t pedalMode, uint8_t channel, unsigned long currentTime);
-void receiverPairingService_handleTransmitterOnline(ReceiverPairingService* service, const uint8_t* txMAC, 
-                                                     uint8_t channel);
-void receiverPairingService_handleTransmitterPaired(ReceiverPairingService* service, 
+// transmitterIndex: the sender's ID as looked up for the frame, -1 if unknown
+void receiverPairingService_handleDiscoveryRequest(ReceiverPairingService* service, const uint8_t* txMAC,
+                                                    int transmitterIndex, uint8_t pedalMode, PeerProtocol peer,
+                                                    uint8_t channel, unsigned long currentTime);
+void receiverPairingService_handleTransmitterOnline(ReceiverPairingService* service, const uint8_t* txMAC,
+                                                     int transmitterIndex, PeerProtocol peer, uint8_t channel);
+void receiverPairingService_handleTransmitterPaired(ReceiverPairingService* service, int transmitterIndex,
                                                      const transmitter_paired_message* msg);
-void receiverPairingService_handleAlive(ReceiverPairingService* service, const uint8_t* txMAC);
+void receiverPairingService_handleAlive(ReceiverPairingService* service, int transmitterIndex);
+// Every received frame, with its sender's ID: a paired transmitter that sends
+// anything while the replacement pings are out is still there
+static inline void receiverPairingService_noteFrame(ReceiverPairingService* service, int transmitterIndex) {
+  if (transmitterIndex >= 0 && service->waitingForAliveResponses) {
+    service->transmitterResponded[transmitterIndex] = true;
+  }
+}
 void receiverPairingService_sendBeacon(ReceiverPairingService* service);
 void receiverPairingService_pingKnownTransmitters(ReceiverPairingService* service);
 void receiverPairingService_update(ReceiverPairingService* service, unsigned long currentTime);
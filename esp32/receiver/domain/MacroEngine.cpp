@@ -0,0 +1,116 @@
+#include "MacroEngine.h"
+#include <string.h>
+
+static_assert(MACRO_SLOTS <= 32, "runningSlots holds one bit per slot");
+
+static bool macroEngine_running(const MacroEngine* engine, int slot) {
+  return engine->runningSlots & ((uint32_t)1 << slot);
+}
+
+static void macroEngine_setRunning(MacroEngine* engine, int slot, bool running) {
+  uint32_t bit = (uint32_t)1 << slot;
+  engine->runningSlots = running ? (engine->runningSlots | bit) : (engine->runningSlots & ~bit);
+}
+
+void macroEngine_init(MacroEngine* engine) {
+  memset(engine, 0, sizeof(MacroEngine));
+}
+
+void macroEngine_assign(MacroEngine* engine, int slot, const Macro* macro) {
+  if (slot < 0 || slot >= MACRO_SLOTS) return;
+  engine->runs[slot].macro = (macro && macro->count) ? macro : nullptr;
+  if (engine->runs[slot].macro) engine->runs[slot].autofireFrames = 0;
+  macroEngine_setRunning(engine, slot, false);
+}
+
+bool macroEngine_hasMacro(const MacroEngine* engine, int slot) {
+  return slot >= 0 && slot < MACRO_SLOTS && engine->runs[slot].macro;
+}
+
+// A press while the macro runs is ignored, so runs never overlap
+bool macroEngine_trigger(MacroEngine* engine, int slot, int64_t now) {
+  if (!macroEngine_hasMacro(engine, slot) || macroEngine_running(engine, slot)) return false;
+  MacroRun* run = &engine->runs[slot];
+  run->next = 0;
+  run->startMicros = now;
+  macroEngine_setRunning(engine, slot, true);
+  return true;
+}
+
+void macroEngine_assignAutofire(MacroEngine* engine, int slot, uint8_t framesPerToggle) {
+  if (slot < 0 || slot >= MACRO_SLOTS) return;
+  engine->runs[slot].autofireFrames = framesPerToggle;
+  if (framesPerToggle) engine->runs[slot].macro = nullptr;
+  macroEngine_setRunning(engine, slot, false);
+}
+
+bool macroEngine_hasAutofire(const MacroEngine* engine, int slot) {
+  return slot >= 0 && slot < MACRO_SLOTS && engine->runs[slot].autofireFrames;
+}
+
+void macroEngine_startAutofire(MacroEngine* engine, int slot, uint8_t output, int64_t now) {
+  if (!macroEngine_hasAutofire(engine, slot) || macroEngine_running(engine, slot)) return;
+  MacroRun* run = &engine->runs[slot];
+  run->next = 0;
+  run->startMicros = now;
+  run->output = output;
+  run->down = false;
+  macroEngine_setRunning(engine, slot, true);
+}
+
+// Releasing the pedal mid-press releases the output at once rather than on the grid
+void macroEngine_stopAutofire(MacroEngine* engine, int slot, MacroKeyHandler handler, void* arg, int64_t now) {
+  if (!macroEngine_hasAutofire(engine, slot) || !macroEngine_running(engine, slot)) return;
+  MacroRun* run = &engine->runs[slot];
+  macroEngine_setRunning(engine, slot, false);
+  if (run->down) {
+    run->down = false;
+    handler(arg, run->output, false, now);
+  }
+}
+
+void macroEngine_cancelAll(MacroEngine* engine) {
+  engine->runningSlots = 0;
+}
+
+static int64_t macroEngine_dueMicros(const MacroRun* run) {
+  int64_t frame = run->autofireFrames ? (int64_t)run->next * run->autofireFrames : run->macro->steps[run->next].frame;
+  return run->startMicros + frame * 1000000 / MACRO_FRAME_RATE_HZ;
+}
+
+// Called on every HID task step, so it walks only the running slots
+uint32_t macroEngine_run(MacroEngine* engine, int64_t now, MacroKeyHandler handler, void* arg) {
+  int64_t nextDue = -1;
+  for (uint32_t pending = engine->runningSlots; pending; pending &= pending - 1) {
+    int slot = __builtin_ctz(pending);
+    MacroRun* run = &engine->runs[slot];
+    while (macroEngine_running(engine, slot)) {
+      int64_t due = macroEngine_dueMicros(run);
+      if (due > now) {
+        if (nextDue < 0 || due < nextDue) nextDue = due;
+        break;
+      }
+
+      if (run->autofireFrames) {
+        run->down = !run->down;
+        handler(arg, run->output, run->down, due);
+        run->next++;
+      } else {
+        const MacroStep* step = &run->macro->steps[run->next];
+        handler(arg, (uint8_t)step->key, step->pressed, due);
+        if (++run->next == run->macro->count) macroEngine_setRunning(engine, slot, false);
+      }
+      uint32_t late = (uint32_t)(now - due);
+      engine->jitter.steps++;
+      engine->jitter.lateMicros += late;
+      if (late > engine->jitter.worstLateMicros) engine->jitter.worstLateMicros = late;
+    }
+  }
+  if (nextDue < 0) return 0;
+  return (uint32_t)(nextDue - now);
+}
+
+void macroEngine_takeJitter(MacroEngine* engine, MacroJitterStats* stats) {
+  *stats = engine->jitter;
+  memset(&engine->jitter, 0, sizeof(engine->jitter));
+}
@@ -0,0 +1,69 @@
+#ifndef MACRO_ENGINE_H
+#define MACRO_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "TransmitterManager.h"
+
+// Timed key output per pedal slot. A press on a slot with a macro starts its
+// steps; a slot with autofire toggles its output every few frames for as long
+// as the pedal is held. Everything is due a whole number of frames after the
+// press, timed from the press itself so rounding never accumulates. Macros and
+// their steps are const tables: a press only fills in its slot's run.
+
+#define MACRO_FRAME_RATE_HZ 60  // Steps are counted in frames of a 60 Hz game
+#define MACRO_SLOTS MAX_PEDAL_SLOTS
+
+typedef struct {
+  uint16_t frame;  // Frames after the press
+  char key;
+  bool pressed;
+} MacroStep;
+
+typedef struct {
+  const MacroStep* steps;  // In frame order
+  uint8_t count;
+} Macro;
+
+typedef struct {
+  const Macro* macro;      // Assigned macro, or nullptr
+  uint8_t autofireFrames;  // Assigned autofire: frames per toggle, 0 = none
+  int64_t startMicros;
+  uint32_t next;           // Macro: next step. Autofire: next toggle.
+  uint8_t output;          // Autofire: the key it toggles, or in gamepad mode the button
+  bool down;               // Autofire: output currently pressed
+} MacroRun;
+
+// How late steps were applied against their due time
+typedef struct {
+  uint32_t steps;
+  uint64_t lateMicros;
+  uint32_t worstLateMicros;
+} MacroJitterStats;
+
+typedef struct {
+  MacroRun runs[MACRO_SLOTS];
+  uint32_t runningSlots;  // Bit per slot with a run in progress; macroEngine_run visits only these
+  MacroJitterStats jitter;
+} MacroEngine;
+
+// output is a macro step's key, or an autofire run's output as it was started
+typedef void (*MacroKeyHandler)(void* arg, uint8_t output, bool pressed, int64_t dueMicros);
+
+void macroEngine_init(MacroEngine* engine);
+void macroEngine_assign(MacroEngine* engine, int slot, const Macro* macro);  // nullptr: the slot types its key
+bool macroEngine_hasMacro(const MacroEngine* engine, int slot);
+bool macroEngine_trigger(MacroEngine* engine, int slot, int64_t now);  // false while that slot's macro still runs
+// Autofire at MACRO_FRAME_RATE_HZ / (2 * framesPerToggle) presses per second;
+// replaces any macro on the slot, and 0 turns it off
+void macroEngine_assignAutofire(MacroEngine* engine, int slot, uint8_t framesPerToggle);
+bool macroEngine_hasAutofire(const MacroEngine* engine, int slot);
+void macroEngine_startAutofire(MacroEngine* engine, int slot, uint8_t output, int64_t now);  // First press is due now
+void macroEngine_stopAutofire(MacroEngine* engine, int slot, MacroKeyHandler handler, void* arg, int64_t now);
+void macroEngine_cancelAll(MacroEngine* engine);  // Stops without releasing anything
+// Applies every step and toggle due by now, in order; returns the microseconds until the
+// next one, or 0 if nothing is running
+uint32_t macroEngine_run(MacroEngine* engine, int64_t now, MacroKeyHandler handler, void* arg);
+void macroEngine_takeJitter(MacroEngine* engine, MacroJitterStats* stats);  // Copies and resets
+
+#endif // MACRO_ENGINE_H
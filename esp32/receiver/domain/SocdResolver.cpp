@@ -0,0 +1,63 @@
+#include "SocdResolver.h"
+#include <string.h>
+
+void socdResolver_init(SocdResolver* resolver) {
+  memset(resolver, 0, sizeof(SocdResolver));
+}
+
+bool socdResolver_addPair(SocdResolver* resolver, char first, char second, uint8_t policy) {
+  if (policy == SOCD_PRESS_BOTH) return true;
+  if (first == second || resolver->count >= SOCD_MAX_PAIRS) return false;
+  if (resolver->pairOf[(uint8_t)first] || resolver->pairOf[(uint8_t)second]) return false;
+
+  SocdPair* pair = &resolver->pairs[resolver->count++];
+  pair->keys[0] = first;
+  pair->keys[1] = second;
+  pair->policy = policy;
+  pair->held = 0;
+  pair->lastSide = 0;
+  resolver->pairOf[(uint8_t)first] = resolver->count;
+  resolver->pairOf[(uint8_t)second] = resolver->count;
+  return true;
+}
+
+// Whether a side of the pair sends, given what is held
+static bool socdResolver_sends(const SocdPair* pair, uint8_t side) {
+  if (!(pair->held & (1 << side))) return false;
+  if (pair->held != 0x03) return true;
+
+  switch (pair->policy) {
+    case SOCD_LAST_INPUT:  return side == pair->lastSide;
+    case SOCD_FIRST_INPUT: return side != pair->lastSide;
+    default:               return false;
+  }
+}
+
+char socdResolver_resolve(SocdResolver* resolver, char key, bool pressed, bool* keyOut, bool* partnerOut) {
+  uint8_t index = resolver->pairOf[(uint8_t)key];
+  if (!index) {
+    *keyOut = pressed;
+    return 0;
+  }
+
+  // A repeat of a key's state (snapshots resend held pedals) keeps the order
+  SocdPair* pair = &resolver->pairs[index - 1];
+  uint8_t side = pair->keys[0] == key ? 0 : 1;
+  uint8_t bit = (uint8_t)(1 << side);
+  if (pressed && !(pair->held & bit)) {
+    pair->held |= bit;
+    pair->lastSide = side;
+  } else if (!pressed) {
+    pair->held &= (uint8_t)~bit;
+  }
+
+  *keyOut = socdResolver_sends(pair, side);
+  *partnerOut = socdResolver_sends(pair, 1 - side);
+  return pair->keys[1 - side];
+}
+
+void socdResolver_releaseAll(SocdResolver* resolver) {
+  for (uint8_t i = 0; i < resolver->count; i++) {
+    resolver->pairs[i].held = 0;
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef SOCD_RESOLVER_H
+#define SOCD_RESOLVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Simultaneous opposing inputs: what a pair of keys sends while both are held.
+// Each pair keeps which keys are held and which came last, and a key finds its
+// pair through a table, so resolving a change takes the same few steps however
+// many pairs there are.
+
+#define SOCD_PRESS_BOTH 0   // No resolution, as earlier firmware did
+#define SOCD_LAST_INPUT 1   // The later key wins; the earlier one comes back when it is released
+#define SOCD_FIRST_INPUT 2  // The key held first keeps winning
+#define SOCD_NEUTRAL 3      // Both held sends neither
+
+#define SOCD_MAX_PAIRS 4
+
+typedef struct {
+  char keys[2];
+  uint8_t policy;
+  uint8_t held;      // Bit n = keys[n] is down
+  uint8_t lastSide;  // Index of the key pressed most recently
+} SocdPair;
+
+typedef struct {
+  SocdPair pairs[SOCD_MAX_PAIRS];
+  uint8_t count;
+  uint8_t pairOf[256];  // Key -> pair index + 1, 0 = not paired
+} SocdResolver;
+
+void socdResolver_init(SocdResolver* resolver);
+// False if either key is already paired or there is no room; SOCD_PRESS_BOTH
+// leaves the keys unpaired
+bool socdResolver_addPair(SocdResolver* resolver, char first, char second, uint8_t policy);
+// Takes a key going down or up and gives what the key and its partner should
+// now send. Returns the partner, or 0 for an unpaired key, which sends as is.
+char socdResolver_resolve(SocdResolver* resolver, char key, bool pressed, bool* keyOut, bool* partnerOut);
+void socdResolver_releaseAll(SocdResolver* resolver);  // Pairing kept
+
+#endif // SOCD_RESOLVER_H
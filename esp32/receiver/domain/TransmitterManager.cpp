@@ -1,58 +1,99 @@
 #include "TransmitterManager.h"
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
+
+// Key each slot types until remapped: 'l' and 'r' as earlier firmware did by
+// pairing order, then letters for the slots added since
+static const char kDefaultSlotKeys[MAX_PEDAL_SLOTS] = {
+  'l', 'r', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'm', 'n', 'o',
+};
+
+// ESP32 MACs share their vendor prefix, so hash the device-specific tail
+static uint32_t transmitterManager_hash(const uint8_t* mac) {
+  uint32_t tail = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+  return (tail * 2654435761u) >> (32 - TRANSMITTER_INDEX_BITS);
+}
+
+static void transmitterManager_indexInsert(TransmitterManager* manager, int id) {
+  uint32_t bucket = transmitterManager_hash(manager->transmitters[id].mac);
+  while (manager->index[bucket]) bucket = (bucket + 1) & (TRANSMITTER_INDEX_SIZE - 1);
+  manager->index[bucket] = (uint8_t)(id + 1);
+}
 
 void transmitterManager_init(TransmitterManager* manager) {
   memset(manager->transmitters, 0, sizeof(manager->transmitters));
+  memset(manager->index, 0, sizeof(manager->index));
   manager->count = 0;
   manager->slotsUsed = 0;
 }
 
+// The index is never more than half full, so a miss ends at an empty bucket
+// within a probe or two
 int transmitterManager_findIndex(const TransmitterManager* manager, const uint8_t* mac) {
-  for (int i = 0; i < manager->count; i++) {
-    if (memcmp(mac, manager->transmitters[i].mac, 6) == 0) {
-      return i;
+  uint32_t bucket = transmitterManager_hash(mac);
+  while (manager->index[bucket]) {
+    int id = manager->index[bucket] - 1;
+    if (memcmp(mac, manager->transmitters[id].mac, 6) == 0) {
+      return id;
     }
+    bucket = (bucket + 1) & (TRANSMITTER_INDEX_SIZE - 1);
   }
   return -1;
 }
 
-bool transmitterManager_add(TransmitterManager* manager, const uint8_t* mac, uint8_t pedalMode) {
+int transmitterManager_add(TransmitterManager* manager, const uint8_t* mac, uint8_t pedalMode) {
   int index = transmitterManager_findIndex(manager, mac);
   if (index >= 0) {
     // Already exists - update last seen
-    manager->transmitters[index].lastSeen = millis();
+    manager->transmitters[index].lastSeen = halClock_millis();
     manager->transmitters[index].seenOnBoot = true;
-    return true;
+    return index;
   }
   
   int slotsNeeded = (pedalMode == 0) ? 2 : 1;
   if (manager->slotsUsed + slotsNeeded > MAX_PEDAL_SLOTS) {
-    return false;  // Not enough slots
+    return -1;  // Not enough slots
   }
   
-  memcpy(manager->transmitters[manager->count].mac, mac, 6);
-  manager->transmitters[manager->count].pedalMode = pedalMode;
-  manager->transmitters[manager->count].seenOnBoot = true;
-  manager->transmitters[manager->count].lastSeen = millis();
+  // Lowest free ID; there is one whenever a slot is free
+  index = 0;
+  while (manager->transmitters[index].paired) index++;
+  
+  TransmitterInfo* transmitter = &manager->transmitters[index];
+  memset(transmitter, 0, sizeof(TransmitterInfo));
+  transmitter->paired = true;
+  memcpy(transmitter->mac, mac, 6);
+  transmitter->pedalMode = pedalMode;
+  transmitter->seenOnBoot = true;
+  transmitter->lastSeen = halClock_millis();
   manager->count++;
   manager->slotsUsed += slotsNeeded;
+  transmitterManager_indexInsert(manager, index);
+  transmitterManager_bindFreeSlots(manager, index);
   
-  return true;
+  return index;
 }
 
+// Leaves a hole: every other transmitter keeps its ID and its slots
 void transmitterManager_remove(TransmitterManager* manager, int index) {
-  if (index < 0 || index >= manager->count) return;
+  if (index < 0 || index >= MAX_TRANSMITTERS || !manager->transmitters[index].paired) return;
   
-  int slotsFreed = (manager->transmitters[index].pedalMode == 0) ? 2 : 1;
-  
-  for (int i = index; i < manager->count - 1; i++) {
-    manager->transmitters[i] = manager->transmitters[i + 1];
+  memset(&manager->transmitters[index], 0, sizeof(TransmitterInfo));
+  transmitterManager_reindex(manager);
+}
+
+// Rebuilt rather than patched: removals are rare and linear probing would
+// otherwise need tombstones
+void transmitterManager_reindex(TransmitterManager* manager) {
+  memset(manager->index, 0, sizeof(manager->index));
+  manager->count = 0;
+  manager->slotsUsed = 0;
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (!manager->transmitters[i].paired) continue;
+    transmitterManager_indexInsert(manager, i);
+    manager->count++;
+    manager->slotsUsed += (manager->transmitters[i].pedalMode == 0) ? 2 : 1;
   }
-  
-  manager->count--;
-  manager->slotsUsed -= slotsFreed;
-  memset(&manager->transmitters[manager->count], 0, sizeof(TransmitterInfo));
 }
 
 bool transmitterManager_hasFreeSlots(const TransmitterManager* manager, int slotsNeeded) {
@@ -63,7 +104,44 @@ int transmitterManager_getAvailableSlots(const TransmitterManager* manager) {
   return MAX_PEDAL_SLOTS - manager->slotsUsed;
 }
 
-char transmitterManager_getAssignedKey(const TransmitterManager* manager, int index) {
-  return (index == 0) ? 'l' : 'r';
+void transmitterManager_bindFreeSlots(TransmitterManager* manager, int index) {
+  bool used[MAX_PEDAL_SLOTS] = {};
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (!manager->transmitters[i].paired) continue;
+    for (int pedal = 0; pedal < 2; pedal++) {
+      uint8_t slot = manager->transmitters[i].bindings[pedal].slot;
+      if (i != index && slot < MAX_PEDAL_SLOTS) used[slot] = true;
+    }
+  }
+
+  TransmitterInfo* transmitter = &manager->transmitters[index];
+  int pedals = (transmitter->pedalMode == 0) ? 2 : 1;
+  int slot = 0;
+  for (int pedal = 0; pedal < 2; pedal++) {
+    PedalBinding* binding = &transmitter->bindings[pedal];
+    while (slot < MAX_PEDAL_SLOTS && used[slot]) slot++;
+    if (pedal < pedals && slot < MAX_PEDAL_SLOTS) {
+      binding->key = kDefaultSlotKeys[slot];
+      binding->modifiers = 0;
+      binding->slot = (uint8_t)slot++;
+    } else {
+      binding->key = 0;
+      binding->modifiers = 0;
+      binding->slot = PEDAL_SLOT_NONE;
+    }
+  }
+}
+
+char transmitterManager_defaultKey(uint8_t slot) {
+  return slot < MAX_PEDAL_SLOTS ? kDefaultSlotKeys[slot] : 0;
+}
+
+void transmitterManager_setBinding(TransmitterManager* manager, int index, char pedalKey, char key, uint8_t modifiers) {
+  uint8_t pedal = (uint8_t)(pedalKey - '1');
+  if (index < 0 || index >= MAX_TRANSMITTERS || !manager->transmitters[index].paired || pedal >= 2) return;
+  PedalBinding* binding = &manager->transmitters[index].bindings[pedal];
+  if (binding->slot == PEDAL_SLOT_NONE) return;
+  binding->key = key;
+  binding->modifiers = modifiers;
 }
 
@@ -4,28 +4,72 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define MAX_PEDAL_SLOTS 2
+#define MAX_PEDAL_SLOTS 16        // One gamepad button each (HAL_HID_GAMEPAD_BUTTONS)
+#define MAX_TRANSMITTERS MAX_PEDAL_SLOTS  // A single pedal takes one slot
+#define TRANSMITTER_INDEX_BITS 5  // MAC index: 32 buckets, at most half full
+#define TRANSMITTER_INDEX_SIZE (1 << TRANSMITTER_INDEX_BITS)
+#define PEDAL_SLOT_NONE 0xFF
 
+// What one pedal of a transmitter drives. Bindings belong to the transmitter
+// and are saved with it, so they stay put when another one is removed.
 typedef struct {
+  char key;           // Typed in keyboard output, 0 = unmapped
+  uint8_t modifiers;  // HAL_HID_MOD_* bits held with the key
+  uint8_t slot;       // Gamepad button, macro and autofire slot; PEDAL_SLOT_NONE if unmapped
+} PedalBinding;
+
+typedef struct {
+  bool paired;                // Entry in use; its index is the transmitter's ID
   uint8_t mac[6];
   uint8_t pedalMode;
   bool seenOnBoot;
   unsigned long lastSeen;
+  uint8_t lastSeq;            // Last accepted pedal event or snapshot seq, 0=none
+  unsigned long lastSeqTime;  // When it was accepted
+  uint8_t pedalMask;               // Pedals held per the last MSG_PEDAL_SNAPSHOT
+  unsigned long lastSnapshotTime;  // When it arrived
+  uint8_t protocolVersion;  // As last advertised, 0=not heard since boot
+  uint8_t capabilities;     // Negotiated CAP_* bits
+  uint8_t positions[2];     // Analog travel per MSG_PEDAL_POSITION, 0 = at rest
+  uint8_t positionSeq;      // Seq of the last position frame applied
+  bool positionsValid;      // Deltas apply; cleared by a gap until the next keyframe
+  PedalBinding bindings[2];  // Per pedal ('1', '2'); a single pedal leaves the second unmapped
+  char profileKeys[2];          // Pedal profile's key in place of the binding's, 0 = none; not saved
+  uint8_t profileModifiers[2];  // Held with profileKeys
 } TransmitterInfo;
 
+// Transmitters keep their index (ID) from pairing until removal: a removal
+// leaves a hole rather than shifting the others, so an ID looked up once for a
+// frame stays valid for the whole of its handling. Walk the array skipping
+// entries that are not `paired`. MACs find their ID through an open-addressed
+// hash index, so a lookup costs the same however many pedals are paired.
 typedef struct {
-  TransmitterInfo transmitters[MAX_PEDAL_SLOTS];
-  int count;
+  TransmitterInfo transmitters[MAX_TRANSMITTERS];
+  uint8_t index[TRANSMITTER_INDEX_SIZE];  // ID + 1 per bucket, 0 = empty; linear probing
+  int count;      // Paired transmitters
   int slotsUsed;
 } TransmitterManager;
 
 void transmitterManager_init(TransmitterManager* manager);
-int transmitterManager_findIndex(const TransmitterManager* manager, const uint8_t* mac);
-bool transmitterManager_add(TransmitterManager* manager, const uint8_t* mac, uint8_t pedalMode);
+int transmitterManager_findIndex(const TransmitterManager* manager, const uint8_t* mac);  // ID, or -1
+int transmitterManager_add(TransmitterManager* manager, const uint8_t* mac, uint8_t pedalMode);  // ID, or -1 if full
 void transmitterManager_remove(TransmitterManager* manager, int index);
+// Rebuilds the MAC index, count and slotsUsed after entries were filled in directly
+void transmitterManager_reindex(TransmitterManager* manager);
 bool transmitterManager_hasFreeSlots(const TransmitterManager* manager, int slotsNeeded);
 int transmitterManager_getAvailableSlots(const TransmitterManager* manager);
-char transmitterManager_getAssignedKey(const TransmitterManager* manager, int index);
+// Gives a transmitter without bindings the lowest free slots, each typing its
+// slot's default key ('l', 'r', then 'a'-'k', 'm', 'n', 'o')
+void transmitterManager_bindFreeSlots(TransmitterManager* manager, int index);
+char transmitterManager_defaultKey(uint8_t slot);  // 0 past the last slot
+void transmitterManager_setBinding(TransmitterManager* manager, int index, char pedalKey, char key, uint8_t modifiers);
+// A pedal's binding: one load, no branching on the pedal mode
+static inline const PedalBinding* transmitterManager_binding(const TransmitterManager* manager, int index,
+                                                             char pedalKey) {
+  static const PedalBinding kUnmapped = {0, 0, PEDAL_SLOT_NONE};
+  uint8_t pedal = (uint8_t)(pedalKey - '1');
+  return pedal < 2 ? &manager->transmitters[index].bindings[pedal] : &kUnmapped;
+}
 
 #endif // TRANSMITTER_MANAGER_H
 
@@ -0,0 +1,67 @@
+#include "DebugMonitor.h"
+#include "Persistence.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "../shared/hal/Hal.h"
+#include "../shared/messages.h"
+
+void debugMonitor_init(DebugMonitor* monitor, ReceiverEspNowTransport* transport, unsigned long bootTime) {
+  monitor->transport = transport;
+  memset(monitor->mac, 0, 6);
+  monitor->paired = false;
+  monitor->espNowInitialized = false;
+  monitor->bootTime = bootTime;
+  monitor->lineHead.store(0, std::memory_order_relaxed);
+  monitor->lineTail.store(0, std::memory_order_relaxed);
+  monitor->linesDropped = 0;
+}
+
+void debugMonitor_load(DebugMonitor* monitor) {
+  persistence_loadDebugMonitor(monitor->mac, &monitor->paired);
+}
+
+void debugMonitor_handleDiscoveryRequest(DebugMonitor* monitor, const uint8_t* mac, uint8_t channel) {
+  receiverEspNowTransport_addPeer(monitor->transport, mac, channel);
+  
+  if (!monitor->paired || memcmp(monitor->mac, mac, 6) != 0) {
+    memcpy(monitor->mac, mac, 6);
+    monitor->paired = true;
+    persistence_queueSaveDebugMonitor(mac);
+  }
+}
+
+void debugMonitor_print(DebugMonitor* monitor, const char* format, ...) {
+  if (!monitor->paired || !monitor->espNowInitialized) return;
+  
+  uint32_t head = monitor->lineHead.load(std::memory_order_relaxed);
+  if (head - monitor->lineTail.load(std::memory_order_acquire) >= DEBUG_MONITOR_QUEUE_SIZE) {
+    monitor->linesDropped++;
+    return;
+  }
+  
+  debug_message* msg = &monitor->lines[head & (DEBUG_MONITOR_QUEUE_SIZE - 1)];
+  msg->msgType = MSG_DEBUG;
+  
+  // Timestamp prefix (milliseconds since boot)
+  int prefixLen = snprintf(msg->message, sizeof(msg->message), "[%lu ms] ",
+                           halClock_millis() - monitor->bootTime);
+  if (prefixLen < 0 || prefixLen >= (int)sizeof(msg->message)) prefixLen = 0;
+  
+  va_list args;
+  va_start(args, format);
+  vsnprintf(msg->message + prefixLen, sizeof(msg->message) - prefixLen, format, args);
+  va_end(args);
+  
+  monitor->lineHead.store(head + 1, std::memory_order_release);
+}
+
+void debugMonitor_flush(DebugMonitor* monitor) {
+  uint32_t tail = monitor->lineTail.load(std::memory_order_relaxed);
+  while (tail != monitor->lineHead.load(std::memory_order_acquire)) {
+    const debug_message* msg = &monitor->lines[tail & (DEBUG_MONITOR_QUEUE_SIZE - 1)];
+    receiverEspNowTransport_send(monitor->transport, monitor->mac, (const uint8_t*)msg, sizeof(debug_message));
+    tail++;
+    monitor->lineTail.store(tail, std::memory_order_release);
+  }
+}
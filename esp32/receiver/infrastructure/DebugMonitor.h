@@ -0,0 +1,34 @@
+#ifndef DEBUG_MONITOR_H
+#define DEBUG_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include "EspNowTransport.h"
+#include "../shared/messages.h"
+
+#define DEBUG_MONITOR_QUEUE_SIZE 8  // Power of two
+
+// Forwards receiver debug output over ESP-NOW to debug-monitor/debug-monitor.ino
+// (USB is taken by the HID keyboard, so Serial is not available on the receiver).
+// debugMonitor_print formats into a single-producer/single-consumer queue on
+// the HID task; debugMonitor_flush sends from the low-priority task.
+typedef struct {
+  ReceiverEspNowTransport* transport;
+  uint8_t mac[6];
+  bool paired;
+  bool espNowInitialized;
+  unsigned long bootTime;
+  debug_message lines[DEBUG_MONITOR_QUEUE_SIZE];
+  std::atomic<uint32_t> lineHead;  // debugMonitor_print only
+  std::atomic<uint32_t> lineTail;  // debugMonitor_flush only
+  uint32_t linesDropped;  // Queue full
+} DebugMonitor;
+
+void debugMonitor_init(DebugMonitor* monitor, ReceiverEspNowTransport* transport, unsigned long bootTime);
+void debugMonitor_load(DebugMonitor* monitor);
+void debugMonitor_handleDiscoveryRequest(DebugMonitor* monitor, const uint8_t* mac, uint8_t channel);
+void debugMonitor_print(DebugMonitor* monitor, const char* format, ...);
+void debugMonitor_flush(DebugMonitor* monitor);  // Sends every queued line
+
+#endif // DEBUG_MONITOR_H
@@ -1,61 +1,50 @@
 #include "EspNowTransport.h"
-#include <esp_now.h>
-#include <WiFi.h>
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 #include "../shared/messages.h"
 
-static ReceiverMessageCallback g_receiveCallback = nullptr;
-
-void OnDataRecvWrapper(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
-  if (g_receiveCallback) {
-    uint8_t* senderMAC = (uint8_t*)info->src_addr;
-    uint8_t channel = info->rx_ctrl ? info->rx_ctrl->channel : 0;
-    g_receiveCallback(senderMAC, data, len, channel);
-  }
+// WiFi task: lock-free, so it never waits on a sender. Resends go out from
+// the next receiverEspNowTransport_send, under the lock.
+static void receiverEspNowTransport_onSendComplete(void* arg, const uint8_t* mac, bool delivered) {
+  ReceiverEspNowTransport* transport = (ReceiverEspNowTransport*)arg;
+  sendTracker_onSendComplete(&transport->sendTracker, mac, delivered);
 }
 
 void receiverEspNowTransport_init(ReceiverEspNowTransport* transport) {
-  WiFi.mode(WIFI_STA);
-  delay(100);
-  WiFi.disconnect();
-  delay(100);
-  
-  if (esp_now_init() == ESP_OK) {
-    transport->initialized = true;
-  } else {
-    transport->initialized = false;
+  sendTracker_init(&transport->sendTracker);
+  transport->lock = halLock_create();
+  transport->initialized = halRadio_init(100);
+  if (transport->initialized) {
+    halRadio_setSendCallback(receiverEspNowTransport_onSendComplete, transport);
   }
 }
 
 bool receiverEspNowTransport_send(ReceiverEspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len) {
   if (!transport->initialized) return false;
   
-  esp_err_t result = esp_now_send(mac, data, len);
-  return (result == ESP_OK);
+  halLock_take(transport->lock);
+  bool sent = sendTracker_send(&transport->sendTracker, mac, data, len, 0);
+  halLock_give(transport->lock);
+  return sent;
+}
+
+const SendPeerStats* receiverEspNowTransport_peerStats(const ReceiverEspNowTransport* transport, const uint8_t* mac) {
+  return sendTracker_peerStats(&transport->sendTracker, mac);
 }
 
 bool receiverEspNowTransport_addPeer(ReceiverEspNowTransport* transport, const uint8_t* mac, uint8_t channel) {
   if (!transport->initialized) return false;
   
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, mac, 6);
-  peerInfo.channel = channel;
-  peerInfo.encrypt = false;
-  
-  esp_err_t result = esp_now_add_peer(&peerInfo);
-  return (result == ESP_OK || result == ESP_ERR_ESPNOW_EXIST);
+  return halRadio_addPeer(mac, channel);
 }
 
 void receiverEspNowTransport_registerReceiveCallback(ReceiverEspNowTransport* transport, ReceiverMessageCallback callback) {
   if (!transport->initialized) return;
   
-  g_receiveCallback = callback;
-  esp_now_register_recv_cb(OnDataRecvWrapper);
+  halRadio_setReceiveCallback(callback);
 }
 
 void receiverEspNowTransport_broadcast(ReceiverEspNowTransport* transport, const uint8_t* data, int len) {
   uint8_t broadcastMAC[] = BROADCAST_MAC;
   receiverEspNowTransport_send(transport, broadcastMAC, data, len);
 }
-
@@ -3,16 +3,26 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "../domain/TransmitterManager.h"
+
+// Every pedal plus the debug monitor gets delivery counters
+#define SEND_TRACKER_MAX_PEERS (MAX_TRANSMITTERS + 1)
+#include "../shared/EspNowSendTracker.h"
+#include "../shared/hal/Hal.h"
+static_assert(SEND_TRACKER_MAX_PEERS >= MAX_TRANSMITTERS + 1, "EspNowSendTracker.h was included with a smaller peer table");
 
 // ESP-NOW transport abstraction for receiver
 typedef struct {
   bool initialized;
+  EspNowSendTracker sendTracker;  // In-flight unicast frames and per-peer counters
+  HalLock* lock;  // Serializes the senders (HID task, loop()); the send callback stays lock-free
 } ReceiverEspNowTransport;
 
 typedef void (*ReceiverMessageCallback)(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
 
 void receiverEspNowTransport_init(ReceiverEspNowTransport* transport);
 bool receiverEspNowTransport_send(ReceiverEspNowTransport* transport, const uint8_t* mac, const uint8_t* data, int len);
+const SendPeerStats* receiverEspNowTransport_peerStats(const ReceiverEspNowTransport* transport, const uint8_t* mac);
 bool receiverEspNowTransport_addPeer(ReceiverEspNowTransport* transport, const uint8_t* mac, uint8_t channel);
 void receiverEspNowTransport_registerReceiveCallback(ReceiverEspNowTransport* transport, ReceiverMessageCallback callback);
 void receiverEspNowTransport_broadcast(ReceiverEspNowTransport* transport, const uint8_t* data, int len);
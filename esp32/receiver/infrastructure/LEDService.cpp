@@ -1,26 +1,32 @@
 #include "LEDService.h"
-#include <Adafruit_NeoPixel.h>
-#include <Arduino.h>
-
-Adafruit_NeoPixel pixels(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
+#include "../shared/hal/Hal.h"
 
 void ledService_init(LEDService* service, unsigned long bootTime) {
   service->bootTime = bootTime;
-  pixels.begin();
-  pixels.clear();
-  pixels.show();
+  service->outputMode = 0;
+  service->outputModeTime = 0;
+  halPixel_begin(LED_PIN);
+}
+
+void ledService_showOutputMode(LEDService* service, uint8_t mode, unsigned long currentTime) {
+  service->outputMode = mode;
+  service->outputModeTime = currentTime ? currentTime : 1;
 }
 
 void ledService_update(LEDService* service, unsigned long currentTime) {
   unsigned long timeSinceBoot = currentTime - service->bootTime;
-  if (timeSinceBoot < TRANSMITTER_TIMEOUT) {
+  if (service->outputModeTime && currentTime - service->outputModeTime < LED_OUTPUT_MODE_SHOW_MS) {
+    // Output mode just changed - green for keyboard, magenta for gamepad
+    if (service->outputMode == 0) {
+      halPixel_setColor(0, 255, 0);
+    } else {
+      halPixel_setColor(255, 0, 255);
+    }
+  } else if (timeSinceBoot < TRANSMITTER_TIMEOUT) {
     // Grace period - set LED to blue
-    pixels.setPixelColor(0, pixels.Color(0, 0, 255));
-    pixels.show();
+    halPixel_setColor(0, 0, 255);
   } else {
     // After grace period - turn LED off
-    pixels.setPixelColor(0, pixels.Color(0, 0, 0));
-    pixels.show();
+    halPixel_setColor(0, 0, 0);
   }
 }
-
@@ -8,12 +8,17 @@
 #define NUM_LEDS 1
 #define TRANSMITTER_TIMEOUT 30000  // 30 seconds
 
+#define LED_OUTPUT_MODE_SHOW_MS 1500
+
 typedef struct {
   unsigned long bootTime;
+  uint8_t outputMode;            // HID_OUTPUT_*, shown after it changes
+  unsigned long outputModeTime;  // 0 = nothing to show
 } LEDService;
 
 void ledService_init(LEDService* service, unsigned long bootTime);
 void ledService_update(LEDService* service, unsigned long currentTime);
+void ledService_showOutputMode(LEDService* service, uint8_t mode, unsigned long currentTime);
 
 #endif // LED_SERVICE_H
 
@@ -0,0 +1,26 @@
+#include "ModeButton.h"
+#include "../shared/hal/Hal.h"
+
+void modeButton_init(ModeButton* button, uint8_t pin) {
+  button->pin = pin;
+  button->down = false;
+  button->fired = false;
+  button->downSince = 0;
+  halGpio_inputPullup(pin);
+}
+
+bool modeButton_update(ModeButton* button, unsigned long currentTime) {
+  bool down = halGpio_read(button->pin) == HAL_GPIO_LOW;
+  if (down != button->down) {
+    button->down = down;
+    button->fired = false;
+    button->downSince = currentTime;
+    return false;
+  }
+  
+  if (!down || button->fired || currentTime - button->downSince < MODE_BUTTON_HOLD_MS) {
+    return false;
+  }
+  button->fired = true;
+  return true;
+}
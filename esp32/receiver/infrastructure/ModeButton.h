@@ -0,0 +1,21 @@
+#ifndef MODE_BUTTON_H
+#define MODE_BUTTON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MODE_BUTTON_PIN 0         // BOOT button on ESP32-S3 DevKit boards, active LOW
+#define MODE_BUTTON_HOLD_MS 3000  // Long enough that a brush against it does nothing
+
+// A long press on a button, polled; fires once per press
+typedef struct {
+  uint8_t pin;
+  bool down;
+  bool fired;
+  unsigned long downSince;
+} ModeButton;
+
+void modeButton_init(ModeButton* button, uint8_t pin);
+bool modeButton_update(ModeButton* button, unsigned long currentTime);  // true when the hold completes
+
+#endif // MODE_BUTTON_H
@@ -1,82 +1,220 @@
 #include "Persistence.h"
-#include <Preferences.h>
+#include <stdio.h>
 #include <string.h>
-#include <Arduino.h>
+#include "../shared/hal/Hal.h"
 
-Preferences preferences;
+static HalLock* g_persistenceLock = nullptr;
+static TransmitterManager g_queuedManager;
+static bool g_managerQueued = false;
+static uint8_t g_queuedMonitorMAC[6];
+static bool g_monitorQueued = false;
+static uint8_t g_queuedOutputMode;
+static bool g_outputModeQueued = false;
+
+// One record per transmitter ID, and a mask of the IDs in use, so a save is
+// one write per paired pedal however many there are
+typedef struct {
+  uint8_t mac[6];
+  uint8_t pedalMode;
+  PedalBinding bindings[2];
+} SavedTransmitter;
+static_assert(sizeof(SavedTransmitter) == 13, "SavedTransmitter is stored as is");
+static_assert(MAX_TRANSMITTERS <= 31, "txMask holds one bit per ID");
+
+// Erases the records persistence_loadLegacy reads
+static void persistence_eraseLegacy() {
+  int count = halNvs_getInt("pairedCount", 0);
+  for (int i = 0; i < count && i < MAX_TRANSMITTERS; i++) {
+    char key[15];
+    for (int j = 0; j < 6; j++) {
+      snprintf(key, sizeof(key), "mac%d_%d", i, j);
+      halNvs_remove(key);
+    }
+    snprintf(key, sizeof(key), "mode%d", i);
+    halNvs_remove(key);
+  }
+  halNvs_remove("pairedCount");
+}
 
 void persistence_save(TransmitterManager* manager) {
-  preferences.begin("pedal", false);
-  preferences.putInt("pairedCount", manager->count);
-  preferences.putInt("pedalSlotsUsed", manager->slotsUsed);
+  halNvs_begin("pedal", false);
+  int32_t savedMask = halNvs_getInt("txMask", 0);
+  int32_t pairedMask = 0;
+  bool written = true;
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    const TransmitterInfo* transmitter = &manager->transmitters[i];
+    if (!transmitter->paired) continue;
+    pairedMask |= (int32_t)1 << i;
+    
+    SavedTransmitter record;
+    memcpy(record.mac, transmitter->mac, 6);
+    record.pedalMode = transmitter->pedalMode;
+    memcpy(record.bindings, transmitter->bindings, sizeof(record.bindings));
+    char key[12];
+    snprintf(key, sizeof(key), "tx%d", i);
+    written = halNvs_putBytes(key, &record, sizeof(record)) && written;
+  }
+  written = halNvs_putInt("txMask", pairedMask) && written;
   
-  for (int i = 0; i < manager->count; i++) {
+  // Once every record is written, the per-field ones from before IDs go, so a
+  // lost txMask can never migrate them again over newer bindings
+  if (written && halNvs_getInt("pairedCount", -1) >= 0) persistence_eraseLegacy();
+  
+  // Drop the records of removed IDs, or they would outlive the pairing
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (!(savedMask & ~pairedMask & ((int32_t)1 << i))) continue;
+    char key[12];
+    snprintf(key, sizeof(key), "tx%d", i);
+    halNvs_remove(key);
+  }
+  
+  halNvs_end();
+}
+
+// Records from before transmitter IDs: one value per field, in pairing order,
+// and no bindings (persistence_load gives them the slots pairing order gave)
+static void persistence_loadLegacy(TransmitterManager* manager) {
+  int count = halNvs_getInt("pairedCount", 0);
+  
+  for (int i = 0; i < count && i < MAX_TRANSMITTERS; i++) {
     char macKey[12];
     char modeKey[12];
     snprintf(macKey, sizeof(macKey), "mac%d", i);
     snprintf(modeKey, sizeof(modeKey), "mode%d", i);
     
+    manager->transmitters[i].paired = true;
     for (int j = 0; j < 6; j++) {
       char key[15];
       snprintf(key, sizeof(key), "%s_%d", macKey, j);
-      preferences.putUChar(key, manager->transmitters[i].mac[j]);
+      manager->transmitters[i].mac[j] = halNvs_getUChar(key, 0);
     }
-    preferences.putUChar(modeKey, manager->transmitters[i].pedalMode);
+    manager->transmitters[i].pedalMode = halNvs_getUChar(modeKey, 0);
   }
-  
-  preferences.end();
 }
 
 void persistence_load(TransmitterManager* manager) {
-  preferences.begin("pedal", true);
-  manager->count = preferences.getInt("pairedCount", 0);
-  manager->slotsUsed = preferences.getInt("pedalSlotsUsed", 0);
+  transmitterManager_init(manager);
+  bool bound[MAX_TRANSMITTERS] = {};
   
-  for (int i = 0; i < manager->count && i < MAX_PEDAL_SLOTS; i++) {
-    char macKey[12];
-    char modeKey[12];
-    snprintf(macKey, sizeof(macKey), "mac%d", i);
-    snprintf(modeKey, sizeof(modeKey), "mode%d", i);
-    
-    for (int j = 0; j < 6; j++) {
-      char key[15];
-      snprintf(key, sizeof(key), "%s_%d", macKey, j);
-      manager->transmitters[i].mac[j] = preferences.getUChar(key, 0);
+  halNvs_begin("pedal", true);
+  int32_t pairedMask = halNvs_getInt("txMask", -1);
+  if (pairedMask < 0) {
+    persistence_loadLegacy(manager);
+  } else {
+    for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+      if (!(pairedMask & ((int32_t)1 << i))) continue;
+      SavedTransmitter record;
+      char key[12];
+      snprintf(key, sizeof(key), "tx%d", i);
+      if (halNvs_getBytes(key, &record, sizeof(record)) != (int)sizeof(record)) continue;
+      
+      TransmitterInfo* transmitter = &manager->transmitters[i];
+      transmitter->paired = true;
+      memcpy(transmitter->mac, record.mac, 6);
+      transmitter->pedalMode = record.pedalMode;
+      memcpy(transmitter->bindings, record.bindings, sizeof(record.bindings));
+      bound[i] = true;
     }
-    manager->transmitters[i].pedalMode = preferences.getUChar(modeKey, 0);
-    manager->transmitters[i].seenOnBoot = false;
-    manager->transmitters[i].lastSeen = 0;
   }
+  halNvs_end();
   
-  preferences.end();
+  // Saved before bindings existed: the slots pairing order gave them
+  transmitterManager_reindex(manager);
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (manager->transmitters[i].paired && !bound[i]) transmitterManager_bindFreeSlots(manager, i);
+  }
 }
 
 void persistence_saveDebugMonitor(const uint8_t* mac) {
-  preferences.begin("pedal", false);
+  halNvs_begin("pedal", false);
   for (int j = 0; j < 6; j++) {
     char key[15];
     snprintf(key, sizeof(key), "dbgmon_%d", j);
-    preferences.putUChar(key, mac[j]);
+    halNvs_putUChar(key, mac[j]);
   }
-  preferences.putBool("dbgmon_paired", true);
-  preferences.end();
+  halNvs_putBool("dbgmon_paired", true);
+  halNvs_end();
 }
 
 void persistence_loadDebugMonitor(uint8_t* mac, bool* isPaired) {
-  preferences.begin("pedal", true);
-  bool dbgMonSaved = preferences.getBool("dbgmon_paired", false);
+  halNvs_begin("pedal", true);
+  bool dbgMonSaved = halNvs_getBool("dbgmon_paired", false);
   if (dbgMonSaved) {
     bool allZero = true;
     for (int j = 0; j < 6; j++) {
       char key[15];
       snprintf(key, sizeof(key), "dbgmon_%d", j);
-      mac[j] = preferences.getUChar(key, 0);
+      mac[j] = halNvs_getUChar(key, 0);
       if (mac[j] != 0) allZero = false;
     }
     *isPaired = !allZero;
   } else {
     *isPaired = false;
   }
-  preferences.end();
+  halNvs_end();
 }
 
+
+void persistence_saveOutputMode(uint8_t mode) {
+  halNvs_begin("pedal", false);
+  halNvs_putUChar("outputMode", mode);
+  halNvs_end();
+}
+
+uint8_t persistence_loadOutputMode(uint8_t defaultMode) {
+  halNvs_begin("pedal", true);
+  uint8_t mode = halNvs_getUChar("outputMode", defaultMode);
+  halNvs_end();
+  return mode;
+}
+
+void persistence_init() {
+  g_persistenceLock = halLock_create();
+  g_managerQueued = false;
+  g_monitorQueued = false;
+  g_outputModeQueued = false;
+}
+
+void persistence_queueSave(const TransmitterManager* manager) {
+  halLock_take(g_persistenceLock);
+  g_queuedManager = *manager;
+  g_managerQueued = true;
+  halLock_give(g_persistenceLock);
+}
+
+void persistence_queueSaveDebugMonitor(const uint8_t* mac) {
+  halLock_take(g_persistenceLock);
+  memcpy(g_queuedMonitorMAC, mac, 6);
+  g_monitorQueued = true;
+  halLock_give(g_persistenceLock);
+}
+
+void persistence_queueSaveOutputMode(uint8_t mode) {
+  halLock_take(g_persistenceLock);
+  g_queuedOutputMode = mode;
+  g_outputModeQueued = true;
+  halLock_give(g_persistenceLock);
+}
+
+bool persistence_flush() {
+  TransmitterManager manager;
+  uint8_t monitorMAC[6];
+  
+  // Copy out under the lock, write NVS without it
+  halLock_take(g_persistenceLock);
+  bool saveManager = g_managerQueued;
+  bool saveMonitor = g_monitorQueued;
+  bool saveOutputMode = g_outputModeQueued;
+  uint8_t outputMode = g_queuedOutputMode;
+  if (saveManager) manager = g_queuedManager;
+  if (saveMonitor) memcpy(monitorMAC, g_queuedMonitorMAC, 6);
+  g_managerQueued = false;
+  g_monitorQueued = false;
+  g_outputModeQueued = false;
+  halLock_give(g_persistenceLock);
+  
+  if (saveManager) persistence_save(&manager);
+  if (saveMonitor) persistence_saveDebugMonitor(monitorMAC);
+  if (saveOutputMode) persistence_saveOutputMode(outputMode);
+  return saveManager || saveMonitor || saveOutputMode;
+}
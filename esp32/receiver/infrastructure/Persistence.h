@@ -9,6 +9,16 @@ void persistence_save(TransmitterManager* manager);
 void persistence_load(TransmitterManager* manager);
 void persistence_saveDebugMonitor(const uint8_t* mac);
 void persistence_loadDebugMonitor(uint8_t* mac, bool* isPaired);
+void persistence_saveOutputMode(uint8_t mode);
+uint8_t persistence_loadOutputMode(uint8_t defaultMode);
+
+// Deferred saves: the HID task queues a copy of the state, persistence_flush
+// writes the latest one from the low-priority task, keeping NVS off the HID path
+void persistence_init();
+void persistence_queueSave(const TransmitterManager* manager);
+void persistence_queueSaveDebugMonitor(const uint8_t* mac);
+void persistence_queueSaveOutputMode(uint8_t mode);
+bool persistence_flush();  // Returns true if anything was written
 
 #endif // PERSISTENCE_H
 
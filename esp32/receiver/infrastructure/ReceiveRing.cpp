@@ -0,0 +1,53 @@
+#include "ReceiveRing.h"
+#include <string.h>
+#include "../shared/hal/Hal.h"
+
+static_assert((RECEIVE_RING_SIZE & (RECEIVE_RING_SIZE - 1)) == 0, "RECEIVE_RING_SIZE must be a power of two");
+
+void receiveRing_init(ReceiveRing* ring) {
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->pushed = 0;
+  ring->dropped = 0;
+  ring->highWater = 0;
+}
+
+bool receiveRing_push(ReceiveRing* ring, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  uint32_t waiting = head - ring->tail.load(std::memory_order_acquire);
+  if (waiting >= RECEIVE_RING_SIZE) {
+    ring->dropped++;
+    return false;
+  }
+  
+  ReceivedFrame* frame = &ring->frames[head & (RECEIVE_RING_SIZE - 1)];
+  if (len < 0) len = 0;
+  if (len > RECEIVE_RING_FRAME_MAX) len = RECEIVE_RING_FRAME_MAX;
+  frame->arrivalMicros = halClock_micros();
+  memcpy(frame->senderMAC, senderMAC, 6);
+  frame->channel = channel;
+  frame->len = (uint8_t)len;
+  memcpy(frame->data, data, len);
+  
+  // Publish the slot only after it is filled
+  ring->head.store(head + 1, std::memory_order_release);
+  ring->pushed++;
+  if (waiting + 1 > ring->highWater) ring->highWater = waiting + 1;
+  return true;
+}
+
+const ReceivedFrame* receiveRing_peek(ReceiveRing* ring) {
+  uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+  if (tail == ring->head.load(std::memory_order_acquire)) return nullptr;
+  
+  return &ring->frames[tail & (RECEIVE_RING_SIZE - 1)];
+}
+
+void receiveRing_pop(ReceiveRing* ring) {
+  // Hands the slot back to the producer once the consumer is done reading it
+  ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t receiveRing_occupancy(const ReceiveRing* ring) {
+  return ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,39 @@
+#ifndef RECEIVE_RING_H
+#define RECEIVE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring of received ESP-NOW frames.
+// The WiFi task's receive callback pushes, the HID task peeks and pops; each
+// side writes only its own index, so neither ever waits on the other.
+
+#define RECEIVE_RING_SIZE 32       // Power of two
+#define RECEIVE_RING_FRAME_MAX 32  // Longer frames keep their first RECEIVE_RING_FRAME_MAX bytes
+
+typedef struct {
+  int64_t arrivalMicros;  // halClock_micros() in the receive callback
+  uint8_t senderMAC[6];
+  uint8_t channel;
+  uint8_t len;
+  uint8_t data[RECEIVE_RING_FRAME_MAX];
+} ReceivedFrame;
+
+typedef struct {
+  ReceivedFrame frames[RECEIVE_RING_SIZE];
+  std::atomic<uint32_t> head;  // Next slot to fill; producer only
+  std::atomic<uint32_t> tail;  // Next slot to drain; consumer only
+  // Producer-side counters
+  uint32_t pushed;
+  uint32_t dropped;    // Ring full: the frame was discarded
+  uint32_t highWater;  // Most frames ever waiting at once
+} ReceiveRing;
+
+void receiveRing_init(ReceiveRing* ring);
+bool receiveRing_push(ReceiveRing* ring, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
+const ReceivedFrame* receiveRing_peek(ReceiveRing* ring);  // nullptr when empty
+void receiveRing_pop(ReceiveRing* ring);
+uint32_t receiveRing_occupancy(const ReceiveRing* ring);
+
+#endif // RECEIVE_RING_H
@@ -1,21 +1,61 @@
-#include <WiFi.h>
-#include <esp_now.h>
-
 // Clean Architecture: Include shared and domain modules
+#include "shared/hal/Hal.h"
 #include "shared/messages.h"
+#include "shared/MessageCodec.h"
 #include "domain/TransmitterManager.h"
+#include "domain/MacroEngine.h"
+#include "domain/SocdResolver.h"
 #include "infrastructure/EspNowTransport.h"
+#include "infrastructure/ReceiveRing.h"
 #include "infrastructure/Persistence.h"
 #include "infrastructure/LEDService.h"
 #include "infrastructure/DebugMonitor.h"
+#include "infrastructure/ModeButton.h"
 #include "application/PairingService.h"
 #include "application/KeyboardService.h"
 
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+#define HID_TASK_CORE 1          // ESP32-S3 APP_CPU; the WiFi driver runs on core 0
+#define HID_TASK_PRIORITY 5      // Preempts loop() (priority 1), which does the slow work
+#define HID_TASK_PERIOD_MS 10    // Beacons and key timeouts when no frame wakes the task
+#define HID_REPORT_SCHEDULE HID_SCHEDULE_FRAME_ALIGNED  // or HID_SCHEDULE_IMMEDIATE
+#define HID_OUTPUT_DEFAULT HID_OUTPUT_KEYBOARD  // Until changed by holding MODE_BUTTON_PIN; then saved
+#define STATS_REPORT_INTERVAL_MS 5000
+// ============================================================================
+
+// Pedal slot macros (keyboard output): a slot given a macro here types its
+// steps on each press instead of its key. Steps count frames from the press.
+static const MacroStep kComboSteps[] = {
+  {0, 's', true}, {1, 'd', true}, {2, 's', false}, {2, 'p', true}, {3, 'd', false}, {4, 'p', false},
+};
+static const Macro kComboMacro = {kComboSteps, sizeof(kComboSteps) / sizeof(kComboSteps[0])};
+static const Macro* const kSlotMacros[MACRO_SLOTS] = {nullptr, nullptr};  // e.g. {nullptr, &kComboMacro}
+
+// Pedal slot autofire (either output): frames per toggle on the 60 Hz grid
+// while the pedal is held, 1 = 30 presses a second, 2 = 15; 0 = off. Replaces
+// the slot's macro.
+static const uint8_t kSlotAutofireFrames[MACRO_SLOTS] = {0, 0};
+
+// Simultaneous opposing inputs (keyboard output): what each key pair sends
+// while both are held. SOCD_PRESS_BOTH, SOCD_LAST_INPUT, SOCD_FIRST_INPUT or
+// SOCD_NEUTRAL, as tournament rules require.
+typedef struct {
+  char first;
+  char second;
+  uint8_t policy;
+} SocdPairConfig;
+static const SocdPairConfig kSocdPairs[] = {{'l', 'r', SOCD_PRESS_BOTH}};
+
 // Domain layer instances
 TransmitterManager transmitterManager;
 ReceiverEspNowTransport transport;
+ReceiveRing receiveRing;
+HalTask* hidTask = nullptr;
 LEDService ledService;
 DebugMonitor debugMonitor;
+ModeButton modeButton;
 
 // Application layer instances
 ReceiverPairingService pairingService;
@@ -23,101 +63,220 @@ KeyboardService keyboardService;
 
 // System state
 unsigned long bootTime = 0;
+unsigned long lastServiceUpdateTime = 0;
+unsigned long lastRingReportTime = 0;
+unsigned long lastLatencyReportTime = 0;
+unsigned long lastMacroReportTime = 0;
+uint32_t lastReportedRingDrops = 0;
+uint32_t lastReportedRingHighWater = 0;
+int frameTransmitter = -1;  // Sender of the frame being handled: its ID, looked up once per frame, or -1
+
+// Message handlers, one per msgType; the codec has already checked each frame's
+// length, and frameTransmitter holds the sender's ID
+void onDebugMonitorRequest(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  debugMonitor_handleDiscoveryRequest(&debugMonitor, senderMAC, channel);
+  
+  // Send immediate confirmation that pairing succeeded
+  debugMonitor_print(&debugMonitor, "Debug monitor discovery request received and processed");
+}
+
+void onPedalSnapshot(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const pedal_snapshot_message* snapshot = (const pedal_snapshot_message*)data;
+  if (keyboardService_handlePedalSnapshot(&keyboardService, frameTransmitter, snapshot)) {
+    debugMonitor_print(&debugMonitor, "Pedal snapshot: transmitter %d, pedals 0x%02X (seq %d)",
+                       frameTransmitter, snapshot->pedalMask, snapshot->seq);
+  }
+}
+
+void onPedalPosition(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  keyboardService_handlePedalPosition(&keyboardService, frameTransmitter, (const pedal_position_message*)data, len);
+}
+
+// The pedal's profile switch moved: its keys change until the next profile.
+// The saved bindings stay as they are, so nothing is written.
+void onPedalProfile(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const pedal_profile_message* msg = (const pedal_profile_message*)data;
+  if (keyboardService_handlePedalProfile(&keyboardService, frameTransmitter, msg)) {
+    debugMonitor_print(&debugMonitor, "Pedal profile %d: keys '%c' '%c'", msg->profile,
+                       msg->keys[0] ? msg->keys[0] : '-', msg->keys[1] ? msg->keys[1] : '-');
+  }
+}
 
-// Forward declaration
-void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
+void onTransmitterOnline(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  if (frameTransmitter >= 0) {
+    debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_ONLINE from known transmitter %d", frameTransmitter);
+  } else {
+    debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_ONLINE from unknown transmitter");
+  }
+  receiverPairingService_handleTransmitterOnline(&pairingService, senderMAC, frameTransmitter,
+                                                 messageCodec_peerProtocol(data, len), channel);
+}
+
+void onTransmitterPaired(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_PAIRED");
+  receiverPairingService_handleTransmitterPaired(&pairingService, frameTransmitter,
+                                                 (const transmitter_paired_message*)data);
+}
+
+void onDeleteRecord(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  if (frameTransmitter >= 0) {
+    debugMonitor_print(&debugMonitor, "Received delete record request from transmitter %d - removing", frameTransmitter);
+    transmitterManager_remove(&transmitterManager, frameTransmitter);
+    persistence_queueSave(&transmitterManager);
+  }
+}
+
+void onDiscoveryRequest(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  const struct_message* msg = (const struct_message*)data;
+  PeerProtocol peer = messageCodec_peerProtocol(data, len);
+  debugMonitor_print(&debugMonitor, "Discovery request from %02X:%02X:%02X:%02X:%02X:%02X (mode=%d, protocol v%d, caps 0x%02X)",
+                     senderMAC[0], senderMAC[1], senderMAC[2], senderMAC[3], senderMAC[4], senderMAC[5], msg->pedalMode,
+                     peer.version, peer.capabilities);
+  receiverPairingService_handleDiscoveryRequest(&pairingService, senderMAC, frameTransmitter, msg->pedalMode, peer,
+                                                channel, halClock_millis());
+  persistence_queueSave(&transmitterManager);
+}
+
+void onPedalEvent(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  // Older transmitters send this without seq; the codec reads it as 0
+  const struct_message* msg = (const struct_message*)data;
+  if (!keyboardService_handlePedalEvent(&keyboardService, frameTransmitter, msg, len)) {
+    return;  // Unknown transmitter or a burst duplicate
+  }
+  char keyToPress = transmitterManager_binding(&transmitterManager, frameTransmitter, msg->key)->key;
+  debugMonitor_print(&debugMonitor, "Pedal event: transmitter %d, key '%c' %s (seq %d)", 
+                    frameTransmitter, keyToPress, msg->pressed ? "PRESSED" : "RELEASED", messageCodec_seq(msg, len));
+}
 
+void onAlive(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  receiverPairingService_handleAlive(&pairingService, frameTransmitter);
+}
+
+static constexpr MessageTable kMessageTable = messageTable_make({
+  {MSG_PEDAL_SNAPSHOT, onPedalSnapshot},
+  {MSG_PEDAL_POSITION, onPedalPosition},
+  {MSG_PEDAL_PROFILE, onPedalProfile},
+  {MSG_PEDAL_EVENT, onPedalEvent},
+  {MSG_ALIVE, onAlive},
+  {MSG_DISCOVERY_REQ, onDiscoveryRequest},
+  {MSG_DELETE_RECORD, onDeleteRecord},
+  {MSG_TRANSMITTER_ONLINE, onTransmitterOnline},
+  {MSG_TRANSMITTER_PAIRED, onTransmitterPaired},
+  {MSG_DEBUG_MONITOR_REQ, onDebugMonitorRequest},
+});
+
+// WiFi task: copy the frame out of the driver's buffer and wake the HID task
 void onMessageReceived(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
-  if (len < 1) return;
+  if (receiveRing_push(&receiveRing, senderMAC, data, len, channel) && hidTask) {
+    halTask_notify(hidTask);
+  }
+}
+
+// Reports ring pressure to the debug monitor when it changes
+void reportReceiveRing(unsigned long currentTime) {
+  if (currentTime - lastRingReportTime < STATS_REPORT_INTERVAL_MS) return;
+  if (receiveRing.dropped == lastReportedRingDrops && receiveRing.highWater == lastReportedRingHighWater) return;
   
-  uint8_t msgType = data[0];
+  lastRingReportTime = currentTime;
+  lastReportedRingDrops = receiveRing.dropped;
+  lastReportedRingHighWater = receiveRing.highWater;
+  debugMonitor_print(&debugMonitor, "Receive ring: %lu waiting, peak %lu/%d, %lu of %lu dropped; %lu debug lines dropped",
+                     (unsigned long)receiveRing_occupancy(&receiveRing), (unsigned long)receiveRing.highWater,
+                     RECEIVE_RING_SIZE, (unsigned long)receiveRing.dropped,
+                     (unsigned long)(receiveRing.pushed + receiveRing.dropped), (unsigned long)debugMonitor.linesDropped);
+}
+
+// Reports where pedal-to-host time went since the last report
+void reportHidLatency(unsigned long currentTime) {
+  if (!debugMonitor.paired || currentTime - lastLatencyReportTime < STATS_REPORT_INTERVAL_MS) return;
+  lastLatencyReportTime = currentTime;
   
-  // Handle debug monitor discovery request
-  if (msgType == MSG_DEBUG_MONITOR_REQ) {
-    debugMonitor_handleDiscoveryRequest(&debugMonitor, senderMAC, channel);
-    
-    // Send immediate confirmation that pairing succeeded
-    debugMonitor_print(&debugMonitor, "Debug monitor discovery request received and processed");
-    return;
-  }
+  HidLatencyStats latency;
+  keyboardService_takeLatency(&keyboardService, &latency);
+  if (latency.events == 0) return;
   
-  // Handle transmitter online broadcast
-  if (len >= sizeof(transmitter_online_message)) {
-    transmitter_online_message* onlineMsg = (transmitter_online_message*)data;
-    if (onlineMsg->msgType == MSG_TRANSMITTER_ONLINE) {
-      int index = transmitterManager_findIndex(&transmitterManager, senderMAC);
-      if (index >= 0) {
-        debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_ONLINE from known transmitter %d", index);
-      } else {
-        debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_ONLINE from unknown transmitter");
-      }
-      receiverPairingService_handleTransmitterOnline(&pairingService, senderMAC, channel);
-      return;
-    }
-  }
+  debugMonitor_print(&debugMonitor, "HID latency, %lu key changes: ring %lu us, hold %lu us, USB %lu us avg; worst %lu us total",
+                     (unsigned long)latency.events, (unsigned long)(latency.ringMicros / latency.events),
+                     (unsigned long)(latency.holdMicros / latency.events),
+                     (unsigned long)(latency.usbMicros / latency.events), (unsigned long)latency.worstMicros);
+}
+
+void reportMacroJitter(unsigned long currentTime) {
+  if (!debugMonitor.paired || currentTime - lastMacroReportTime < STATS_REPORT_INTERVAL_MS) return;
+  lastMacroReportTime = currentTime;
   
-  // Handle transmitter paired broadcast
-  if (len >= sizeof(transmitter_paired_message)) {
-    transmitter_paired_message* pairedMsg = (transmitter_paired_message*)data;
-    if (pairedMsg->msgType == MSG_TRANSMITTER_PAIRED) {
-      debugMonitor_print(&debugMonitor, "Received MSG_TRANSMITTER_PAIRED");
-      receiverPairingService_handleTransmitterPaired(&pairingService, pairedMsg);
-      return;
-    }
-  }
+  MacroJitterStats jitter;
+  keyboardService_takeMacroJitter(&keyboardService, &jitter);
+  if (jitter.steps == 0) return;
   
-  // Handle standard messages
-  if (len < sizeof(struct_message)) return;
+  debugMonitor_print(&debugMonitor, "Macro/autofire timing, %lu steps: %lu us late avg, worst %lu us",
+                     (unsigned long)jitter.steps, (unsigned long)(jitter.lateMicros / jitter.steps),
+                     (unsigned long)jitter.worstLateMicros);
+}
+
+// Holding the mode button switches between keyboard and gamepad output
+void checkModeButton(unsigned long currentTime) {
+  if (!modeButton_update(&modeButton, currentTime)) return;
   
-  struct_message* msg = (struct_message*)data;
+  uint8_t mode = keyboardService.outputMode == HID_OUTPUT_KEYBOARD ? HID_OUTPUT_GAMEPAD : HID_OUTPUT_KEYBOARD;
+  keyboardService_setOutputMode(&keyboardService, mode);
+  persistence_queueSaveOutputMode(mode);
+  ledService_showOutputMode(&ledService, mode, currentTime);
+  debugMonitor_print(&debugMonitor, "HID output: %s", mode == HID_OUTPUT_GAMEPAD ? "gamepad" : "keyboard");
+}
+
+// HID task: the only consumer of the receive ring, and the only task that
+// touches pairing state, key state and USB HID
+void hidTaskStep(void* arg) {
+  const ReceivedFrame* frame;
+  while ((frame = receiveRing_peek(&receiveRing)) != nullptr) {
+    keyboardService_setFrameArrival(&keyboardService, frame->arrivalMicros);
+    frameTransmitter = transmitterManager_findIndex(&transmitterManager, frame->senderMAC);
+    receiverPairingService_noteFrame(&pairingService, frameTransmitter);
+    messageTable_dispatch(&kMessageTable, frame->senderMAC, frame->data, frame->len, frame->channel);
+    receiveRing_pop(&receiveRing);
+  }
   
-  switch (msg->msgType) {
-    case MSG_DELETE_RECORD: {
-      int index = transmitterManager_findIndex(&transmitterManager, senderMAC);
-      if (index >= 0) {
-        debugMonitor_print(&debugMonitor, "Received delete record request from transmitter %d - removing", index);
-        transmitterManager_remove(&transmitterManager, index);
-        persistence_save(&transmitterManager);
-      }
-      break;
-    }
+  // Periodic work at most once per period, not on every frame's wake-up
+  unsigned long currentTime = halClock_millis();
+  if (currentTime - lastServiceUpdateTime >= HID_TASK_PERIOD_MS) {
+    lastServiceUpdateTime = currentTime;
     
-    case MSG_DISCOVERY_REQ: {
-      debugMonitor_print(&debugMonitor, "Discovery request from %02X:%02X:%02X:%02X:%02X:%02X (mode=%d)",
-                         senderMAC[0], senderMAC[1], senderMAC[2], senderMAC[3], senderMAC[4], senderMAC[5], msg->pedalMode);
-      receiverPairingService_handleDiscoveryRequest(&pairingService, senderMAC, msg->pedalMode, channel, millis());
-      persistence_save(&transmitterManager);
-      break;
-    }
+    // Update pairing service (handles beacons, pings, replacement logic)
+    receiverPairingService_update(&pairingService, currentTime);
     
-    case MSG_PEDAL_EVENT: {
-      int transmitterIndex = transmitterManager_findIndex(&transmitterManager, senderMAC);
-      if (transmitterIndex >= 0) {
-        char keyToPress;
-        if (transmitterManager.transmitters[transmitterIndex].pedalMode == 0) {
-          keyToPress = (msg->key == '1') ? 'l' : 'r';
-        } else {
-          keyToPress = transmitterManager_getAssignedKey(&transmitterManager, transmitterIndex);
-        }
-        debugMonitor_print(&debugMonitor, "Pedal event: transmitter %d, key '%c' %s", 
-                          transmitterIndex, keyToPress, msg->pressed ? "PRESSED" : "RELEASED");
-      }
-      keyboardService_handlePedalEvent(&keyboardService, senderMAC, msg);
-      break;
-    }
+    // Release keys of transmitters that went silent with a pedal held
+    keyboardService_setFrameArrival(&keyboardService, halClock_micros());
+    keyboardService_update(&keyboardService, currentTime);
+    checkModeButton(currentTime);
     
-    case MSG_ALIVE: {
-      receiverPairingService_handleAlive(&pairingService, senderMAC);
-      break;
-    }
+    reportReceiveRing(currentTime);
+    reportHidLatency(currentTime);
+    reportMacroJitter(currentTime);
+  }
+  
+  // Macro steps and autofire toggles due by now, on the timer set for them
+  // below; every slot shares it, so several at once all keep their rate
+  uint32_t macroMicros = keyboardService_runMacros(&keyboardService);
+  
+  // One HID report for every key that changed above, however many pedals
+  // moved; frame-aligned scheduling holds it until just before the next poll
+  uint32_t holdMicros = keyboardService_flush(&keyboardService);
+  uint32_t wakeMicros = (holdMicros && (!macroMicros || holdMicros < macroMicros)) ? holdMicros : macroMicros;
+  if (wakeMicros && hidTask) {
+    halTask_notifyAfter(hidTask, wakeMicros);
+  } else if (holdMicros) {
+    halClock_delayMicros(holdMicros);
+    keyboardService_flush(&keyboardService);
   }
 }
 
 void setup() {
-  bootTime = millis();
+  bootTime = halClock_millis();
   
   // Initialize domain layer
   transmitterManager_init(&transmitterManager);
+  receiveRing_init(&receiveRing);
   
   // Initialize infrastructure layer first (needed for debug monitor)
   receiverEspNowTransport_init(&transport);
@@ -126,6 +285,7 @@ void setup() {
   debugMonitor.espNowInitialized = true;
   
   // Load persisted state
+  persistence_init();
   persistence_load(&transmitterManager);
   
   ledService_init(&ledService, bootTime);
@@ -133,6 +293,16 @@ void setup() {
   // Initialize application layer
   receiverPairingService_init(&pairingService, &transmitterManager, &transport, bootTime);
   keyboardService_init(&keyboardService, &transmitterManager);
+  keyboardService_setScheduleMode(&keyboardService, HID_REPORT_SCHEDULE);
+  for (int slot = 0; slot < MACRO_SLOTS; slot++) {
+    keyboardService_setMacro(&keyboardService, slot, kSlotMacros[slot]);
+    if (kSlotAutofireFrames[slot]) keyboardService_setAutofire(&keyboardService, slot, kSlotAutofireFrames[slot]);
+  }
+  for (size_t i = 0; i < sizeof(kSocdPairs) / sizeof(kSocdPairs[0]); i++) {
+    keyboardService_setSocd(&keyboardService, kSocdPairs[i].first, kSocdPairs[i].second, kSocdPairs[i].policy);
+  }
+  keyboardService_setOutputMode(&keyboardService, persistence_loadOutputMode(HID_OUTPUT_DEFAULT));
+  modeButton_init(&modeButton, MODE_BUTTON_PIN);
   
   // Register message callback (must be before adding peers)
   receiverEspNowTransport_registerReceiveCallback(&transport, onMessageReceived);
@@ -142,42 +312,70 @@ void setup() {
   receiverEspNowTransport_addPeer(&transport, broadcastMAC, 0);
   
   // Add saved transmitters as peers
-  for (int i = 0; i < transmitterManager.count; i++) {
-    receiverEspNowTransport_addPeer(&transport, transmitterManager.transmitters[i].mac, 0);
+  for (int i = 0; i < MAX_TRANSMITTERS; i++) {
+    if (transmitterManager.transmitters[i].paired) {
+      receiverEspNowTransport_addPeer(&transport, transmitterManager.transmitters[i].mac, 0);
+    }
   }
   
   // Add saved debug monitor as peer (if it was saved)
   if (debugMonitor.paired) {
     receiverEspNowTransport_addPeer(&transport, debugMonitor.mac, 0);
     // Small delay to ensure peer is ready before sending messages
-    delay(50);
+    halClock_delay(50);
     
     // Send debug messages now that ESP-NOW is fully initialized
     debugMonitor_print(&debugMonitor, "ESP-NOW initialized");
     debugMonitor_print(&debugMonitor, "Loaded %d transmitter(s) from EEPROM", transmitterManager.count);
     debugMonitor_print(&debugMonitor, "Pedal slots used: %d/%d", transmitterManager.slotsUsed, MAX_PEDAL_SLOTS);
+    debugMonitor_print(&debugMonitor, "HID output: %s",
+                       keyboardService.outputMode == HID_OUTPUT_GAMEPAD ? "gamepad" : "keyboard");
   }
   
   debugMonitor_print(&debugMonitor, "=== Receiver Ready ===");
+  
+  // Frames received so far wait in the ring for the HID task's first step
+  hidTask = halTask_start("hid", hidTaskStep, nullptr, HID_TASK_PRIORITY, HID_TASK_CORE, HID_TASK_PERIOD_MS);
 }
 
+// Low-priority work the HID task hands off
 void loop() {
-  unsigned long currentTime = millis();
+  unsigned long currentTime = halClock_millis();
   
-  // Update pairing service (handles beacons, pings, replacement logic)
-  receiverPairingService_update(&pairingService, currentTime);
+  // No HID task (creation failed): do its work here instead
+  if (!hidTask) {
+    hidTaskStep(nullptr);
+  }
+  
+  // NVS writes and debug monitor output
+  persistence_flush();
+  debugMonitor_flush(&debugMonitor);
   
   // Update LED status
   ledService_update(&ledService, currentTime);
   
-  delay(10);
+  halClock_delay(10);
 }
 
 // Include implementation files (Arduino IDE doesn't auto-compile .cpp files in subdirectories)
 #include "domain/TransmitterManager.cpp"
+#include "domain/MacroEngine.cpp"
+#include "domain/SocdResolver.cpp"
+#include "shared/EspNowSendTracker.cpp"
 #include "infrastructure/EspNowTransport.cpp"
+#include "infrastructure/ReceiveRing.cpp"
 #include "infrastructure/Persistence.cpp"
 #include "infrastructure/LEDService.cpp"
 #include "infrastructure/DebugMonitor.cpp"
+#include "infrastructure/ModeButton.cpp"
 #include "application/PairingService.cpp"
 #include "application/KeyboardService.cpp"
+
+// HAL implementation for the target board (host builds define HAL_HOST and link hal/host instead)
+#ifndef HAL_HOST
+#include "shared/hal/esp32/HalSystem.cpp"
+#include "shared/hal/esp32/HalRadio.cpp"
+#include "shared/hal/esp32/HalNvs.cpp"
+#include "shared/hal/esp32/HalHid.cpp"
+#include "shared/hal/esp32/HalPixel.cpp"
+#endif
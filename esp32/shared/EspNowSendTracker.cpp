@@ -0,0 +1,113 @@
+#include "EspNowSendTracker.h"
+#include <string.h>
+#include "hal/Hal.h"
+#include "messages.h"
+
+void sendTracker_init(EspNowSendTracker* tracker) {
+  memset(tracker, 0, sizeof(EspNowSendTracker));
+}
+
+// Sending side only: the peer table grows from the one task that sends
+// (the transmitters post callback replies to loop(), the receiver locks)
+static int sendTracker_peerIndex(EspNowSendTracker* tracker, const uint8_t* mac) {
+  uint8_t count = tracker->peerCount;
+  for (int i = 0; i < count; i++) {
+    if (memcmp(tracker->peers[i].mac, mac, 6) == 0) return i;
+  }
+  if (count >= SEND_TRACKER_MAX_PEERS) return -1;
+
+  memcpy(tracker->peers[count].mac, mac, 6);
+  __atomic_store_n(&tracker->peerCount, count + 1, __ATOMIC_RELEASE);
+  return count;
+}
+
+bool sendTracker_send(EspNowSendTracker* tracker, const uint8_t* mac, const uint8_t* data, int len, uint8_t retries) {
+  static const uint8_t broadcastMAC[6] = BROADCAST_MAC;
+  sendTracker_poll(tracker);  // Pending resends go first
+  if (memcmp(mac, broadcastMAC, 6) == 0) {
+    return halRadio_send(mac, data, len);  // Never acknowledged
+  }
+
+  int peer = sendTracker_peerIndex(tracker, mac);
+  SendSlot* slot = nullptr;
+  for (int i = 0; peer >= 0 && i < SEND_TRACKER_POOL_SIZE; i++) {
+    if (__atomic_load_n(&tracker->slots[i].state, __ATOMIC_ACQUIRE) == SEND_SLOT_FREE) {
+      slot = &tracker->slots[i];
+      break;
+    }
+  }
+  if (!slot) {
+    tracker->untracked++;
+    return halRadio_send(mac, data, len);
+  }
+
+  // Fill the slot before it goes in flight: the callback may run before halRadio_send returns
+  memcpy(slot->mac, mac, 6);
+  slot->peer = (uint8_t)peer;
+  slot->retriesLeft = len <= SEND_TRACKER_MAX_FRAME ? retries : 0;
+  slot->len = len <= SEND_TRACKER_MAX_FRAME ? (uint8_t)len : 0;
+  if (slot->len) memcpy(slot->data, data, len);
+  slot->order = __atomic_fetch_add(&tracker->nextOrder, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->state, SEND_SLOT_IN_FLIGHT, __ATOMIC_RELEASE);
+
+  if (!halRadio_send(mac, data, len)) {
+    __atomic_store_n(&slot->state, SEND_SLOT_FREE, __ATOMIC_RELEASE);
+    return false;  // Not queued, so no callback will come
+  }
+  tracker->peers[peer].sent++;
+  return true;
+}
+
+// Send callback side (WiFi task)
+bool sendTracker_onSendComplete(EspNowSendTracker* tracker, const uint8_t* mac, bool delivered) {
+  SendSlot* slot = nullptr;
+  for (int i = 0; i < SEND_TRACKER_POOL_SIZE; i++) {
+    SendSlot* candidate = &tracker->slots[i];
+    if (__atomic_load_n(&candidate->state, __ATOMIC_ACQUIRE) != SEND_SLOT_IN_FLIGHT) continue;
+    if (memcmp(candidate->mac, mac, 6) != 0) continue;
+    if (!slot || (int32_t)(candidate->order - slot->order) < 0) slot = candidate;
+  }
+  if (!slot) return false;  // Broadcast or untracked frame
+
+  SendPeerStats* peer = &tracker->peers[slot->peer];
+  if (delivered) {
+    peer->delivered++;
+    __atomic_store_n(&slot->state, SEND_SLOT_FREE, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  // Hand the resend to the sending task instead of waiting for a higher-level timeout
+  if (slot->retriesLeft > 0) {
+    __atomic_store_n(&slot->state, SEND_SLOT_RETRY, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  __atomic_fetch_add(&peer->failed, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->state, SEND_SLOT_FREE, __ATOMIC_RELEASE);
+  return false;
+}
+
+void sendTracker_poll(EspNowSendTracker* tracker) {
+  for (int i = 0; i < SEND_TRACKER_POOL_SIZE; i++) {
+    SendSlot* slot = &tracker->slots[i];
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != SEND_SLOT_RETRY) continue;
+
+    SendPeerStats* peer = &tracker->peers[slot->peer];
+    slot->retriesLeft--;
+    slot->order = __atomic_fetch_add(&tracker->nextOrder, 1, __ATOMIC_RELAXED);
+    peer->retried++;
+    __atomic_store_n(&slot->state, SEND_SLOT_IN_FLIGHT, __ATOMIC_RELEASE);
+    if (!halRadio_send(slot->mac, slot->data, slot->len)) {
+      __atomic_fetch_add(&peer->failed, 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&slot->state, SEND_SLOT_FREE, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+const SendPeerStats* sendTracker_peerStats(const EspNowSendTracker* tracker, const uint8_t* mac) {
+  uint8_t count = __atomic_load_n(&tracker->peerCount, __ATOMIC_ACQUIRE);
+  for (int i = 0; i < count; i++) {
+    if (memcmp(tracker->peers[i].mac, mac, 6) == 0) return &tracker->peers[i];
+  }
+  return nullptr;
+}
@@ -0,0 +1,57 @@
+#ifndef ESPNOW_SEND_TRACKER_H
+#define ESPNOW_SEND_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Follows unicast ESP-NOW frames from halRadio_send until the send callback
+// reports whether the peer acknowledged them. A frame sent with a retry
+// budget is marked for a resend as soon as an attempt fails, and the sending
+// task resends it from sendTracker_poll. Per-peer counters give the real
+// delivery rate. The pool and peer table are fixed size; the callback runs on
+// the WiFi task, so slots change hands through an atomic state store, like
+// the pedal edge ring, and the callback never blocks or sends.
+
+#define SEND_TRACKER_POOL_SIZE 8
+#ifndef SEND_TRACKER_MAX_PEERS
+#define SEND_TRACKER_MAX_PEERS 4  // A transmitter's receiver plus any it turns away; the receiver sets its own
+#endif
+#define SEND_TRACKER_MAX_FRAME 16  // Longer frames are tracked but never resent
+
+#define SEND_SLOT_FREE 0
+#define SEND_SLOT_IN_FLIGHT 1
+#define SEND_SLOT_RETRY 2  // Failed, waiting for the sending task to resend it
+
+typedef struct {
+  uint8_t mac[6];
+  uint32_t sent;       // First attempts handed to the radio
+  uint32_t delivered;  // Acknowledged by the peer
+  uint32_t retried;    // Resends after a failed attempt
+  uint32_t failed;     // Given up on (retry budget spent)
+} SendPeerStats;
+
+typedef struct {
+  volatile uint8_t state;  // SEND_SLOT_*
+  uint8_t mac[6];
+  uint8_t peer;            // Index into EspNowSendTracker.peers
+  uint8_t retriesLeft;
+  uint8_t len;
+  uint32_t order;          // A completion belongs to the oldest frame in flight to its MAC
+  uint8_t data[SEND_TRACKER_MAX_FRAME];
+} SendSlot;
+
+typedef struct {
+  SendSlot slots[SEND_TRACKER_POOL_SIZE];
+  SendPeerStats peers[SEND_TRACKER_MAX_PEERS];
+  volatile uint8_t peerCount;
+  uint32_t nextOrder;
+  uint32_t untracked;  // Sent without a slot (pool or peer table full)
+} EspNowSendTracker;
+
+void sendTracker_init(EspNowSendTracker* tracker);
+bool sendTracker_send(EspNowSendTracker* tracker, const uint8_t* mac, const uint8_t* data, int len, uint8_t retries);
+bool sendTracker_onSendComplete(EspNowSendTracker* tracker, const uint8_t* mac, bool delivered);  // True: poll soon
+void sendTracker_poll(EspNowSendTracker* tracker);  // Sending side: resend failed frames
+const SendPeerStats* sendTracker_peerStats(const EspNowSendTracker* tracker, const uint8_t* mac);
+
+#endif // ESPNOW_SEND_TRACKER_H
@@ -0,0 +1,149 @@
+#ifndef MESSAGE_CODEC_H
+#define MESSAGE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <initializer_list>
+#include "messages.h"
+
+// Receive-side codec for the messages in messages.h. Every msgType maps to the
+// shortest frame it may arrive as and, per sketch, to a handler; dispatch is a
+// bounds check and one indexed call. Handlers read the frame in place through
+// the packed structs, which is safe because the length was checked first.
+
+// Wire layouts: these structs are the protocol, so a change here breaks
+// compatibility with deployed pedals and receivers
+static_assert(sizeof(struct_message) == 5, "struct_message wire size");
+static_assert(offsetof(struct_message, key) == 1 && offsetof(struct_message, pressed) == 2 &&
+              offsetof(struct_message, pedalMode) == 3 && offsetof(struct_message, seq) == 4,
+              "struct_message wire layout");
+static_assert(sizeof(bool) == 1, "struct_message.pressed is one byte on the wire");
+static_assert(STRUCT_MESSAGE_MIN_SIZE == offsetof(struct_message, seq), "legacy frames end before seq");
+static_assert(sizeof(pedal_snapshot_message) == 4, "pedal_snapshot_message wire size");
+static_assert(sizeof(pedal_position_message) == 4 && PEDAL_POSITION_DELTA_SIZE == offsetof(pedal_position_message, positions) + 1,
+              "pedal_position_message wire layout");
+static_assert(sizeof(pedal_profile_message) == 6 && offsetof(pedal_profile_message, modifiers) == 4,
+              "pedal_profile_message wire layout");
+static_assert(sizeof(handshake_message) == 7, "handshake_message wire size");
+static_assert(offsetof(handshake_message, pedalMode) == offsetof(struct_message, pedalMode),
+              "handshake_message extends struct_message");
+static_assert(offsetof(handshake_message, protocolVersion) == sizeof(struct_message), "handshake_message wire layout");
+static_assert(sizeof(beacon_message) == 11 && offsetof(beacon_message, protocolVersion) == 9, "beacon_message wire layout");
+static_assert(sizeof(transmitter_online_message) == 9 && offsetof(transmitter_online_message, protocolVersion) == 7,
+              "transmitter_online_message wire layout");
+static_assert(sizeof(transmitter_paired_message) == 13, "transmitter_paired_message wire size");
+static_assert(offsetof(transmitter_paired_message, receiverMAC) == 7, "transmitter_paired_message wire layout");
+static_assert(sizeof(debug_message) == 201, "debug_message wire size");
+
+#define MSG_TYPE_COUNT 0x0E  // One past the highest msgType
+
+// Shortest valid frame per msgType, 0 for unused types. struct_message types
+// accept frames from firmware that predates the seq field, and handshake
+// frames accept firmware that predates the version fields.
+constexpr uint8_t messageCodec_minSize(uint8_t msgType) {
+  switch (msgType) {
+    case MSG_PEDAL_EVENT:
+    case MSG_DISCOVERY_REQ:
+    case MSG_DISCOVERY_RESP:
+    case MSG_ALIVE:
+    case MSG_DELETE_RECORD:      return STRUCT_MESSAGE_MIN_SIZE;
+    case MSG_DEBUG:              return 2;  // Type byte and at least a terminator
+    case MSG_DEBUG_MONITOR_REQ:  return 1;
+    case MSG_BEACON:             return offsetof(beacon_message, protocolVersion);
+    case MSG_TRANSMITTER_ONLINE: return offsetof(transmitter_online_message, protocolVersion);
+    case MSG_TRANSMITTER_PAIRED: return sizeof(transmitter_paired_message);
+    case MSG_PEDAL_SNAPSHOT:     return sizeof(pedal_snapshot_message);
+    case MSG_PEDAL_POSITION:     return PEDAL_POSITION_DELTA_SIZE;
+    case MSG_PEDAL_PROFILE:      return sizeof(pedal_profile_message);
+    default:                     return 0;
+  }
+}
+
+// msgType of a frame long enough for its type, or -1
+static inline int messageCodec_validate(const uint8_t* data, int len) {
+  if (len < 1 || data[0] >= MSG_TYPE_COUNT) return -1;
+  uint8_t minSize = messageCodec_minSize(data[0]);
+  return (minSize && len >= minSize) ? data[0] : -1;
+}
+
+// struct_message.seq read in place; frames without the field read 0
+static inline uint8_t messageCodec_seq(const struct_message* msg, int len) {
+  return len >= (int)sizeof(struct_message) ? msg->seq : 0;
+}
+
+// MSG_PEDAL_POSITION delta byte: each pedal's change in -7..7
+static inline uint8_t messageCodec_packPositionDeltas(int8_t pedal1, int8_t pedal2) {
+  return (uint8_t)((pedal1 & 0x0F) | ((pedal2 & 0x0F) << 4));
+}
+
+static inline int8_t messageCodec_positionDelta(uint8_t packed, uint8_t pedal) {
+  return pedal == 0 ? (int8_t)(uint8_t)(packed << 4) >> 4 : (int8_t)packed >> 4;
+}
+
+typedef struct {
+  uint8_t version;
+  uint8_t capabilities;  // CAP_* bits
+} PeerProtocol;
+
+// Version and capabilities a handshake frame advertises; frames that end
+// before those fields come from firmware older than them
+static inline PeerProtocol messageCodec_peerProtocol(const uint8_t* data, int len) {
+  int offset;
+  switch (data[0]) {
+    case MSG_DISCOVERY_REQ:
+    case MSG_DISCOVERY_RESP:
+    case MSG_ALIVE:              offset = offsetof(handshake_message, protocolVersion); break;
+    case MSG_BEACON:             offset = offsetof(beacon_message, protocolVersion); break;
+    case MSG_TRANSMITTER_ONLINE: offset = offsetof(transmitter_online_message, protocolVersion); break;
+    default:                     offset = len; break;
+  }
+  PeerProtocol peer = {PROTOCOL_VERSION_LEGACY, 0};
+  if (len >= offset + 2) {
+    peer.version = data[offset];
+    peer.capabilities = data[offset + 1];
+  }
+  return peer;
+}
+
+// The fastest mode both ends support
+static inline uint8_t messageCodec_negotiate(PeerProtocol peer) {
+  return peer.version >= PROTOCOL_VERSION ? (PROTOCOL_CAPABILITIES & peer.capabilities) : 0;
+}
+
+typedef void (*MessageHandler)(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
+
+typedef struct {
+  MessageHandler handler;  // nullptr: this sketch ignores the type
+  uint8_t minSize;
+} MessageRoute;
+
+typedef struct {
+  uint8_t msgType;
+  MessageHandler handler;
+} MessageBinding;
+
+typedef struct {
+  MessageRoute routes[MSG_TYPE_COUNT];
+} MessageTable;
+
+// Builds a sketch's table at compile time from its (msgType, handler) list
+constexpr MessageTable messageTable_make(std::initializer_list<MessageBinding> bindings) {
+  MessageTable table = {};
+  for (const MessageBinding& binding : bindings) {
+    table.routes[binding.msgType].handler = binding.handler;
+    table.routes[binding.msgType].minSize = messageCodec_minSize(binding.msgType);
+  }
+  return table;
+}
+
+// Returns false if the frame was dropped (unknown type, too short, or no handler)
+static inline bool messageTable_dispatch(const MessageTable* table, const uint8_t* senderMAC,
+                                         const uint8_t* data, int len, uint8_t channel) {
+  if (len < 1 || data[0] >= MSG_TYPE_COUNT) return false;
+  const MessageRoute* route = &table->routes[data[0]];
+  if (!route->handler || len < route->minSize) return false;
+  route->handler(senderMAC, data, len, channel);
+  return true;
+}
+
+#endif // MESSAGE_CODEC_H
@@ -0,0 +1,97 @@
+#ifndef PEDAL_BANK_H
+#define PEDAL_BANK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal/Hal.h"
+
+// Bit-parallel debounce for a compile-time set of active-low pedal pins, for
+// boards with more switches than PedalReader's two. Each scan reads the GPIO
+// input register once per bank in use (pins 0-31, 32-63) and debounces every
+// pin at once with a 2-bit vertical counter: a pin changes state after
+// PEDAL_BANK_SAMPLES consecutive scans that disagree with it. The scan cost does
+// not depend on the number of pedals; call pedalBank_update at a fixed period
+// (the debounce time is PEDAL_BANK_SAMPLES scan periods).
+//
+//   PedalBank<4, 5, 6, 7> bank;
+//   pedalBank_init(&bank);
+//   pedalBank_update(&bank, onPedalPress, onPedalRelease);  // keys '1'..'4'
+
+#define PEDAL_BANK_SAMPLES 4
+
+template <uint8_t... Pins>
+struct PedalBankMask;
+
+template <>
+struct PedalBankMask<> {
+  static constexpr uint64_t value = 0;
+};
+
+template <uint8_t Pin, uint8_t... Rest>
+struct PedalBankMask<Pin, Rest...> {
+  static_assert(Pin < 64, "PedalBank pins must be GPIO 0-63");
+  static constexpr uint64_t value = (1ULL << Pin) | PedalBankMask<Rest...>::value;
+};
+
+template <uint8_t... Pins>
+struct PedalBank {
+  static constexpr uint8_t count = sizeof...(Pins);
+  static constexpr uint64_t mask = PedalBankMask<Pins...>::value;
+  static_assert(count > 0, "PedalBank needs at least one pin");
+
+  // Bits are in pin positions: bit n is GPIO n
+  uint64_t pressed;   // Debounced, 1=pressed
+  uint64_t counter0;  // Vertical counter, low bit
+  uint64_t counter1;  // Vertical counter, high bit
+};
+
+template <uint8_t... Pins>
+void pedalBank_init(PedalBank<Pins...>* bank) {
+  const uint8_t pins[] = {Pins...};
+  for (uint8_t i = 0; i < sizeof...(Pins); i++) {
+    halGpio_inputPullup(pins[i]);
+  }
+  bank->pressed = 0;
+  bank->counter0 = PedalBank<Pins...>::mask;
+  bank->counter1 = PedalBank<Pins...>::mask;
+}
+
+// Samples all pins and returns the mask of pins whose debounced state changed
+template <uint8_t... Pins>
+uint64_t pedalBank_scan(PedalBank<Pins...>* bank) {
+  const uint64_t mask = PedalBank<Pins...>::mask;
+
+  // Constant conditions: the read of an unused bank is compiled out
+  uint64_t levels = 0;
+  if (mask & 0xFFFFFFFFULL) levels |= halGpio_readBank(0);
+  if (mask >> 32) levels |= (uint64_t)halGpio_readBank(1) << 32;
+  uint64_t sample = ~levels & mask;  // Active low
+
+  // Count consecutive disagreeing samples; a pin that agrees resets its counter
+  uint64_t disagree = bank->pressed ^ sample;
+  bank->counter0 = ~(bank->counter0 & disagree) & mask;
+  bank->counter1 = (bank->counter0 ^ (bank->counter1 & disagree)) & mask;
+  uint64_t changed = disagree & bank->counter0 & bank->counter1;
+  bank->pressed ^= changed;
+  return changed;
+}
+
+// Scans once and reports changes; keys are '1' + the pin's position in Pins
+template <uint8_t... Pins>
+void pedalBank_update(PedalBank<Pins...>* bank, void (*onPedalPress)(char key), void (*onPedalRelease)(char key)) {
+  uint64_t changed = pedalBank_scan(bank);
+  if (!changed) return;
+
+  const uint8_t pins[] = {Pins...};
+  for (uint8_t i = 0; i < sizeof...(Pins); i++) {
+    uint64_t bit = 1ULL << pins[i];
+    if (!(changed & bit)) continue;
+    if (bank->pressed & bit) {
+      if (onPedalPress) onPedalPress('1' + i);
+    } else {
+      if (onPedalRelease) onPedalRelease('1' + i);
+    }
+  }
+}
+
+#endif // PEDAL_BANK_H
@@ -0,0 +1,92 @@
+#include "PedalEventQueue.h"
+#include <string.h>
+
+static QueuedPedalEvent* pedalEventQueue_at(PedalEventQueue* queue, int index) {
+  return &queue->events[(queue->head + index) & (PEDAL_EVENT_QUEUE_SIZE - 1)];
+}
+
+static void pedalEventQueue_removeAt(PedalEventQueue* queue, int index) {
+  for (int i = index; i < queue->count - 1; i++) {
+    *pedalEventQueue_at(queue, i) = *pedalEventQueue_at(queue, i + 1);
+  }
+  queue->count--;
+}
+
+// Makes room by folding away the oldest tap (a press and its release) as if it
+// never happened. With no complete tap queued, the oldest event goes instead;
+// later entries carry the state it set.
+static void pedalEventQueue_collapse(PedalEventQueue* queue) {
+  for (int i = 0; i < queue->count; i++) {
+    QueuedPedalEvent* press = pedalEventQueue_at(queue, i);
+    if (!press->pressed) continue;
+
+    for (int j = i + 1; j < queue->count; j++) {
+      QueuedPedalEvent* release = pedalEventQueue_at(queue, j);
+      if (release->key != press->key) continue;
+      if (release->pressed) break;
+
+      // Pedal '1' is bit 0 and '2' bit 1, as in pedalReader_pressedMask()
+      uint8_t bit = (uint8_t)(1 << (press->key - '1'));
+      for (int k = i + 1; k < j; k++) {
+        pedalEventQueue_at(queue, k)->pedalMask &= (uint8_t)~bit;
+      }
+      pedalEventQueue_removeAt(queue, j);
+      pedalEventQueue_removeAt(queue, i);
+      queue->collapsed++;
+      return;
+    }
+  }
+  pedalEventQueue_pop(queue);
+  queue->discarded++;
+}
+
+void pedalEventQueue_init(PedalEventQueue* queue, unsigned long staleMs) {
+  memset(queue, 0, sizeof(PedalEventQueue));
+  queue->staleMs = staleMs;
+}
+
+bool pedalEventQueue_isEmpty(const PedalEventQueue* queue) {
+  return queue->count == 0;
+}
+
+void pedalEventQueue_push(PedalEventQueue* queue, char key, bool pressed, uint8_t pedalMask, unsigned long now) {
+  // Same state as this pedal's last queued event: nothing for the receiver to see
+  for (int i = queue->count - 1; i >= 0; i--) {
+    QueuedPedalEvent* previous = pedalEventQueue_at(queue, i);
+    if (previous->key != key) continue;
+    if (previous->pressed == pressed) {
+      queue->discarded++;
+      return;
+    }
+    break;
+  }
+
+  if (queue->count == PEDAL_EVENT_QUEUE_SIZE) {
+    pedalEventQueue_collapse(queue);
+  }
+
+  QueuedPedalEvent* event = pedalEventQueue_at(queue, queue->count);
+  event->timeMs = now;
+  event->key = key;
+  event->pressed = pressed;
+  event->pedalMask = pedalMask;
+  queue->count++;
+}
+
+bool pedalEventQueue_peek(PedalEventQueue* queue, unsigned long now, QueuedPedalEvent* event) {
+  while (queue->staleMs && queue->count > 1 &&
+         now - pedalEventQueue_at(queue, 0)->timeMs > queue->staleMs) {
+    pedalEventQueue_pop(queue);
+    queue->discarded++;
+  }
+  if (queue->count == 0) return false;
+
+  *event = *pedalEventQueue_at(queue, 0);
+  return true;
+}
+
+void pedalEventQueue_pop(PedalEventQueue* queue) {
+  if (queue->count == 0) return;
+  queue->head = (queue->head + 1) & (PEDAL_EVENT_QUEUE_SIZE - 1);
+  queue->count--;
+}
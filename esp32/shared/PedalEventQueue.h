@@ -0,0 +1,39 @@
+#ifndef PEDAL_EVENT_QUEUE_H
+#define PEDAL_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pedal events that could not be sent yet (not paired, or the radio refused
+// the frame), kept in order until the link is back. Each entry carries the
+// pedal mask after the event, so dropping an entry never leaves the receiver
+// with a wrong final state. Fixed size, no heap.
+
+#define PEDAL_EVENT_QUEUE_SIZE 16          // Power of two
+#define PEDAL_EVENT_QUEUE_STALE_MS 2000    // Default age past which an event is not worth replaying
+
+typedef struct {
+  unsigned long timeMs;  // When the edge was reported
+  char key;
+  bool pressed;
+  uint8_t pedalMask;     // pedalReader_pressedMask() after this event
+} QueuedPedalEvent;
+
+typedef struct {
+  QueuedPedalEvent events[PEDAL_EVENT_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t count;
+  unsigned long staleMs;  // 0 = replay everything regardless of age
+  uint16_t collapsed;     // Press/release pairs folded away when full
+  uint16_t discarded;     // Stale or redundant events dropped
+} PedalEventQueue;
+
+void pedalEventQueue_init(PedalEventQueue* queue, unsigned long staleMs);
+bool pedalEventQueue_isEmpty(const PedalEventQueue* queue);
+void pedalEventQueue_push(PedalEventQueue* queue, char key, bool pressed, uint8_t pedalMask, unsigned long now);
+// Oldest event still worth sending. Stale events are dropped on the way,
+// except the newest one, which is kept for the state it carries.
+bool pedalEventQueue_peek(PedalEventQueue* queue, unsigned long now, QueuedPedalEvent* event);
+void pedalEventQueue_pop(PedalEventQueue* queue);
+
+#endif // PEDAL_EVENT_QUEUE_H
@@ -0,0 +1,254 @@
+#include "PedalReader.h"
+#include <string.h>
+#include "hal/Hal.h"
+
+static void pedalState_init(PedalState* state) {
+  memset(state, 0, sizeof(PedalState));
+  state->lastState = HAL_GPIO_HIGH;
+  state->rawState = HAL_GPIO_HIGH;
+  state->debouncePolicy = DEBOUNCE_POLICY_DEFERRED;
+  state->lockoutMicros = (uint32_t)DEBOUNCE_LOCKOUT * 1000;
+}
+
+void pedalReader_init(PedalReader* reader, uint8_t pedal1Pin, uint8_t pedal2Pin, uint8_t pedalMode) {
+  reader->pedal1Pin = pedal1Pin;
+  reader->pedal2Pin = pedal2Pin;
+  reader->pedalMode = pedalMode;
+  reader->interruptCapture = false;
+  reader->edgeBuffer.head = 0;
+  reader->edgeBuffer.tail = 0;
+  reader->edgeBuffer.overflowed = false;
+  pedalState_init(&reader->pedal1State);
+  pedalState_init(&reader->pedal2State);
+
+  halGpio_inputPullup(pedal1Pin);
+  if (pedalMode == 0) {  // DUAL mode
+    halGpio_inputPullup(pedal2Pin);
+  }
+}
+
+// ISR side: timestamp the edge and wake loop() from its idle delay
+static void HAL_ISR_ATTR pedalReader_pushEdge(PedalReader* reader, uint8_t pedal, bool level) {
+  PedalEdgeBuffer* buffer = &reader->edgeBuffer;
+  uint32_t head = buffer->head;
+  uint32_t tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+
+  if (head - tail >= PEDAL_EDGE_BUFFER_SIZE) {
+    buffer->overflowed = true;  // Consumer resyncs from the pin levels
+  } else {
+    PedalEdge* edge = &buffer->edges[head & (PEDAL_EDGE_BUFFER_SIZE - 1)];
+    edge->timeMicros = halClock_micros();
+    edge->pedal = pedal;
+    edge->level = level;
+    __atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+  }
+  halClock_wakeFromIsr();
+}
+
+static void HAL_ISR_ATTR pedalReader_captureEdge(PedalReader* reader, uint8_t pedal, uint8_t pin, PedalState* state) {
+  bool level = halGpio_read(pin);
+  if (state->contact) {
+    bool previous = state->contactLevel;
+    level = state->contact(state, level);
+    state->contactLevel = level;
+    if (level == previous) return;  // Absorbed by the contact stage
+  }
+  pedalReader_pushEdge(reader, pedal, level);
+}
+
+// Shared by the NO and (with a contact stage) contact pin of each pedal
+static void HAL_ISR_ATTR pedalReader_onPedal1Edge(void* arg) {
+  PedalReader* reader = (PedalReader*)arg;
+  pedalReader_captureEdge(reader, 0, reader->pedal1Pin, &reader->pedal1State);
+}
+
+static void HAL_ISR_ATTR pedalReader_onPedal2Edge(void* arg) {
+  PedalReader* reader = (PedalReader*)arg;
+  pedalReader_captureEdge(reader, 1, reader->pedal2Pin, &reader->pedal2State);
+}
+
+// Call after pedalReader_setContact so the contact pins get interrupts too
+void pedalReader_enableInterruptCapture(PedalReader* reader) {
+  reader->interruptCapture = true;
+  halGpio_attachEdgeInterrupt(reader->pedal1Pin, pedalReader_onPedal1Edge, reader);
+  if (reader->pedal1State.contact) {
+    halGpio_attachEdgeInterrupt(reader->pedal1State.contactPin, pedalReader_onPedal1Edge, reader);
+  }
+  if (reader->pedalMode == 0) {  // DUAL mode
+    halGpio_attachEdgeInterrupt(reader->pedal2Pin, pedalReader_onPedal2Edge, reader);
+    if (reader->pedal2State.contact) {
+      halGpio_attachEdgeInterrupt(reader->pedal2State.contactPin, pedalReader_onPedal2Edge, reader);
+    }
+  }
+}
+
+void pedalReader_setDebouncePolicy(PedalReader* reader, uint8_t pedal, uint8_t policy, uint16_t lockoutMs) {
+  PedalState* state = pedal == 0 ? &reader->pedal1State : &reader->pedal2State;
+  state->debouncePolicy = policy;
+  state->lockoutMicros = (uint32_t)lockoutMs * 1000;
+}
+
+// The pedal must be at rest (debounced HIGH): the contact stage starts from there
+void pedalReader_setContact(PedalReader* reader, uint8_t pedal, PedalContact contact, uint8_t contactPin) {
+  PedalState* state = pedal == 0 ? &reader->pedal1State : &reader->pedal2State;
+  state->contactPin = contactPin;
+  state->contactLevel = HAL_GPIO_HIGH;
+  state->contact = contact;
+}
+
+PedalState* pedalReader_stateForKey(PedalReader* reader, char key) {
+  return key == '2' ? &reader->pedal2State : &reader->pedal1State;
+}
+
+static void pedalReader_recordEdge(PedalState* state, bool level, int64_t timeMicros) {
+  if (state->rawState == state->lastState && level != state->lastState) {
+    state->transitionMicros = timeMicros;
+  }
+  state->rawState = level;
+  state->edgeMicros = timeMicros;
+}
+
+static void pedalReader_resyncPin(uint8_t pin, PedalState* state, int64_t now) {
+  // The ISR keeps the contact stage current even when the buffer is full
+  bool level = state->contact ? state->contactLevel : halGpio_read(pin);
+  if (level != state->rawState) {
+    pedalReader_recordEdge(state, level, now);
+  }
+}
+
+// Loop side: move captured edges into the per-pedal raw state. Kept out of
+// line so the per-loop pin checks in pedalReader_update stay inlined.
+static void __attribute__((noinline)) pedalReader_drainEdges(PedalReader* reader) {
+  PedalEdgeBuffer* buffer = &reader->edgeBuffer;
+  uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = buffer->tail;
+
+  while (tail != head) {
+    const PedalEdge* edge = &buffer->edges[tail & (PEDAL_EDGE_BUFFER_SIZE - 1)];
+    PedalState* state = edge->pedal == 0 ? &reader->pedal1State : &reader->pedal2State;
+    pedalReader_recordEdge(state, edge->level, edge->timeMicros);
+    tail++;
+  }
+  __atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+
+  if (buffer->overflowed) {
+    buffer->overflowed = false;
+    int64_t now = halClock_micros();
+    pedalReader_resyncPin(reader->pedal1Pin, &reader->pedal1State, now);
+    if (reader->pedalMode == 0) {  // DUAL mode
+      pedalReader_resyncPin(reader->pedal2Pin, &reader->pedal2State, now);
+    }
+  }
+}
+
+static void pedalLatency_record(PedalLatency* latency, int64_t micros) {
+  latency->count++;
+  latency->lastMicros = micros;
+  latency->totalMicros += micros;
+  if (micros > latency->maxMicros) latency->maxMicros = micros;
+}
+
+// Deferred policy: how long the raw level must hold since its last edge to count
+static int64_t pedalReader_deferredMicros(const PedalState* state) {
+  return state->rawState == HAL_GPIO_LOW ? (int64_t)DEBOUNCE_DELAY * 1000 : DEBOUNCE_RELEASE_US;
+}
+
+// Raw level differs from the debounced one: decide whether the change counts yet
+static bool pedalReader_settle(PedalState* state) {
+  int64_t now = halClock_micros();
+
+  if (state->debouncePolicy == DEBOUNCE_POLICY_LATCH) {
+    // The contact stage already debounced it
+  } else if (state->debouncePolicy == DEBOUNCE_POLICY_EAGER) {
+    // The first edge that holds counts; anything until the lockout ends is bounce
+    if (now < state->lockoutUntilMicros || now - state->edgeMicros < DEBOUNCE_CONFIRM_US) {
+      return false;
+    }
+    state->lockoutUntilMicros = now + state->lockoutMicros;
+  } else if (now - state->edgeMicros < pedalReader_deferredMicros(state)) {
+    // A dropout while held or a glitch at rest ends before this and never counts
+    return false;
+  }
+
+  state->lastState = state->rawState;
+  pedalLatency_record(state->lastState == HAL_GPIO_LOW ? &state->pressLatency : &state->releaseLatency,
+                      now - state->transitionMicros);
+  return true;  // Pressed or released
+}
+
+bool pedalReader_checkPedal(PedalReader* reader, uint8_t pin, PedalState* state) {
+  if (!reader->interruptCapture) {
+    bool currentState = halGpio_read(pin);
+    if (state->contact) {
+      currentState = state->contact(state, currentState);
+      state->contactLevel = currentState;
+    }
+    if (currentState != state->rawState) {
+      pedalReader_recordEdge(state, currentState, halClock_micros());
+    }
+  }
+
+  if (state->rawState == state->lastState) {
+    return false;  // No change
+  }
+  return pedalReader_settle(state);
+}
+
+void pedalReader_update(PedalReader* reader, void (*onPedalPress)(char key), void (*onPedalRelease)(char key)) {
+  if (reader->interruptCapture) {
+    pedalReader_drainEdges(reader);
+  }
+
+  if (pedalReader_checkPedal(reader, reader->pedal1Pin, &reader->pedal1State)) {
+    if (reader->pedal1State.lastState == HAL_GPIO_LOW) {
+      if (onPedalPress) onPedalPress('1');
+    } else {
+      if (onPedalRelease) onPedalRelease('1');
+    }
+  }
+
+  if (reader->pedalMode == 0) {  // DUAL mode
+    if (pedalReader_checkPedal(reader, reader->pedal2Pin, &reader->pedal2State)) {
+      if (reader->pedal2State.lastState == HAL_GPIO_LOW) {
+        if (onPedalPress) onPedalPress('2');
+      } else {
+        if (onPedalRelease) onPedalRelease('2');
+      }
+    }
+  }
+}
+
+static unsigned long pedalReader_settleTimeout(const PedalState* state, int64_t now, unsigned long maxMs) {
+  if (state->rawState == state->lastState) {
+    return maxMs;  // Nothing pending
+  }
+  int64_t remainingMicros;
+  if (state->debouncePolicy == DEBOUNCE_POLICY_EAGER) {
+    remainingMicros = state->lockoutUntilMicros - now;
+    int64_t confirmMicros = state->edgeMicros + DEBOUNCE_CONFIRM_US - now;
+    if (confirmMicros > remainingMicros) remainingMicros = confirmMicros;
+  } else if (state->debouncePolicy == DEBOUNCE_POLICY_DEFERRED) {
+    remainingMicros = state->edgeMicros + pedalReader_deferredMicros(state) - now;
+  } else {
+    return maxMs;  // Reported on the next check
+  }
+  unsigned long remainingMs = remainingMicros <= 0 ? 0 : (unsigned long)((remainingMicros + 999) / 1000);
+  return remainingMs < maxMs ? remainingMs : maxMs;
+}
+
+// How long loop() may idle before a pending change needs reporting
+unsigned long pedalReader_idleTimeout(PedalReader* reader, unsigned long maxMs) {
+  int64_t now = halClock_micros();
+  unsigned long timeout = pedalReader_settleTimeout(&reader->pedal1State, now, maxMs);
+  if (reader->pedalMode == 0) {  // DUAL mode
+    timeout = pedalReader_settleTimeout(&reader->pedal2State, now, timeout);
+  }
+  return timeout;
+}
+
+uint8_t pedalReader_pressedMask(const PedalReader* reader) {
+  uint8_t mask = 0;
+  if (reader->pedal1State.lastState == HAL_GPIO_LOW) mask |= 0x01;
+  if (reader->pedalMode == 0 && reader->pedal2State.lastState == HAL_GPIO_LOW) mask |= 0x02;  // DUAL mode
+  return mask;
+}
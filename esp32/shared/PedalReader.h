@@ -0,0 +1,85 @@
+#ifndef PEDAL_READER_H
+#define PEDAL_READER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Two NO pedal pins, with pin-change interrupts or polled from loop(). A board
+// can put its own contact logic in front of the debounce with a PedalContact
+// (the PanicPedal Pro's NO/NC latch); everything else is shared.
+
+#define DEBOUNCE_DELAY 20  // milliseconds
+#define DEBOUNCE_RELEASE_US 1000  // Stable HIGH before a deferred release counts; outlasts dropouts while held
+#define DEBOUNCE_LOCKOUT 30  // milliseconds, default for DEBOUNCE_POLICY_EAGER
+#define DEBOUNCE_CONFIRM_US 500  // Eager: a new level must hold this long; outlasts EMI spikes and dropouts
+
+// Debounce policies (per pedal)
+#define DEBOUNCE_POLICY_DEFERRED 0  // Report a press after DEBOUNCE_DELAY of stable LOW, a release after DEBOUNCE_RELEASE_US of HIGH
+#define DEBOUNCE_POLICY_EAGER 1     // Report an edge held DEBOUNCE_CONFIRM_US, then ignore edges for the lockout
+#define DEBOUNCE_POLICY_LATCH 2     // The pedal's contact stage is a latch; no timing at all
+#define PEDAL_EDGE_BUFFER_SIZE 16  // Power of two
+
+typedef struct {
+  int64_t timeMicros;
+  uint8_t pedal;  // 0=pedal 1, 1=pedal 2
+  bool level;
+} PedalEdge;
+
+// Lock-free single-producer (GPIO ISR) / single-consumer (loop) ring
+typedef struct {
+  PedalEdge edges[PEDAL_EDGE_BUFFER_SIZE];
+  volatile uint32_t head;  // Written by the ISR only
+  volatile uint32_t tail;  // Written by pedalReader_update only
+  volatile bool overflowed;
+} PedalEdgeBuffer;
+
+// Edge-to-report latency of one kind of transition
+typedef struct {
+  uint32_t count;
+  int64_t lastMicros;
+  int64_t maxMicros;
+  int64_t totalMicros;
+} PedalLatency;
+
+typedef struct PedalState PedalState;
+
+// Maps the NO pin level to the pedal's level, reading contactPin as it needs.
+// Runs in the GPIO ISR when capturing by interrupt.
+typedef bool (*PedalContact)(PedalState* state, bool noLevel);
+
+struct PedalState {
+  bool lastState;             // Debounced level
+  bool rawState;              // Level after the most recent edge
+  int64_t edgeMicros;         // Time of the most recent edge
+  int64_t transitionMicros;   // First edge away from lastState
+  uint8_t debouncePolicy;
+  uint32_t lockoutMicros;
+  int64_t lockoutUntilMicros;
+  PedalContact contact;       // nullptr: the NO pin level as read
+  uint8_t contactPin;         // Second contact, also interrupting; contact stage only
+  volatile bool contactLevel; // Contact stage output, written by the ISR when capturing by interrupt
+  PedalLatency pressLatency;
+  PedalLatency releaseLatency;
+};
+
+typedef struct {
+  PedalState pedal1State;
+  PedalState pedal2State;
+  uint8_t pedal1Pin;
+  uint8_t pedal2Pin;
+  uint8_t pedalMode;  // 0=DUAL, 1=SINGLE
+  bool interruptCapture;  // Edges come from the ISR instead of polling the pins
+  PedalEdgeBuffer edgeBuffer;
+} PedalReader;
+
+void pedalReader_init(PedalReader* reader, uint8_t pedal1Pin, uint8_t pedal2Pin, uint8_t pedalMode);
+void pedalReader_enableInterruptCapture(PedalReader* reader);
+void pedalReader_setDebouncePolicy(PedalReader* reader, uint8_t pedal, uint8_t policy, uint16_t lockoutMs);
+void pedalReader_setContact(PedalReader* reader, uint8_t pedal, PedalContact contact, uint8_t contactPin);
+PedalState* pedalReader_stateForKey(PedalReader* reader, char key);
+bool pedalReader_checkPedal(PedalReader* reader, uint8_t pin, PedalState* state);
+void pedalReader_update(PedalReader* reader, void (*onPedalPress)(char key), void (*onPedalRelease)(char key));
+unsigned long pedalReader_idleTimeout(PedalReader* reader, unsigned long maxMs);
+uint8_t pedalReader_pressedMask(const PedalReader* reader);  // Bit 0 = pedal '1', bit 1 = pedal '2'
+
+#endif // PEDAL_READER_H
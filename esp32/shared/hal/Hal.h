@@ -0,0 +1,147 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+// Hardware abstraction layer shared by the receiver and transmitter sketches.
+// Device implementations live in hal/esp32/, host fakes in hal/host/.
+// Define HAL_HOST to build against the host fakes instead of the ESP32 SDK.
+
+// Functions called from interrupt handlers must live in IRAM on the device
+#ifdef HAL_HOST
+#define HAL_ISR_ATTR
+#else
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#endif
+
+// Clock
+unsigned long halClock_millis();
+int64_t halClock_micros();             // Safe to call from an ISR
+void halClock_delay(unsigned long ms);
+void halClock_delayMicros(uint32_t us);
+void halClock_idle(unsigned long ms);  // Like delay(), but halClock_wake*() ends it early
+void halClock_wakeFromIsr();           // Safe to call from an ISR
+void halClock_wake();                  // The same, from another task
+
+// GPIO
+#define HAL_GPIO_LOW false
+#define HAL_GPIO_HIGH true
+
+void halGpio_inputPullup(uint8_t pin);
+void halGpio_output(uint8_t pin);
+bool halGpio_read(uint8_t pin);  // Safe to call from an ISR
+void halGpio_write(uint8_t pin, bool level);
+uint32_t halGpio_readBank(uint8_t bank);  // Levels of pins bank*32 .. bank*32+31 in one register read
+
+// Calls handler(arg) from an ISR on every edge of pin; the handler must be HAL_ISR_ATTR
+typedef void (*HalGpioEdgeHandler)(void* arg);
+void halGpio_attachEdgeInterrupt(uint8_t pin, HalGpioEdgeHandler handler, void* arg);
+
+// Tasks. step(arg) runs on its own task, pinned to core, after every
+// halTask_notify and at least every periodMs. Host fakes run it on the caller's
+// thread: halTask_notify runs it right away, halClock_delay when it is due.
+typedef void (*HalTaskStep)(void* arg);
+typedef struct HalTask HalTask;
+
+HalTask* halTask_start(const char* name, HalTaskStep step, void* arg, uint8_t priority, uint8_t core,
+                       unsigned long periodMs);
+void halTask_notify(HalTask* task);  // From any task, including the radio callbacks; not from an ISR
+void halTask_notifyAfter(HalTask* task, uint32_t micros);  // One-shot; replaces a pending one
+
+// Mutex between tasks (priority inheritance on the device)
+typedef struct HalLock HalLock;
+
+HalLock* halLock_create();
+void halLock_take(HalLock* lock);
+void halLock_give(HalLock* lock);
+
+// ADC continuous sampling. The converter cycles through the pins on its own,
+// sampleRateHz conversions per second in total, into a DMA buffer;
+// halAdc_read drains what has arrived without blocking. Pins must be on ADC1.
+#define HAL_ADC_MAX_PINS 4
+#define HAL_ADC_MAX_VALUE 4095  // 12-bit conversions
+
+typedef struct {
+  uint8_t pin;
+  uint16_t value;
+} HalAdcSample;
+
+bool halAdc_beginContinuous(const uint8_t* pins, uint8_t count, uint32_t sampleRateHz);
+int halAdc_read(HalAdcSample* samples, int maxSamples);  // Oldest first; samples a full buffer overwrote are lost
+int halAdc_readOnce(uint8_t pin);  // One blocking conversion, before halAdc_beginContinuous; -1 on error
+
+// Power
+void halPower_setCpuFrequencyMhz(uint32_t mhz);
+void halPower_deepSleep(uint8_t wakePin);  // Wakes when wakePin goes LOW
+void halPower_deepSleepFor(unsigned long ms);  // Wakes after ms
+bool halPower_wokeByTimer();  // This boot is a halPower_deepSleepFor wake
+
+// Log (Serial on the device, stdout on the host)
+void halLog_begin(unsigned long baud);
+void halLog_vprintf(const char* format, va_list args);
+
+// Radio (ESP-NOW)
+typedef void (*HalRadioReceiveCallback)(const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
+// MAC-layer outcome of each halRadio_send that returned true, in send order,
+// from the WiFi task on the device
+typedef void (*HalRadioSendCallback)(void* arg, const uint8_t* dstMAC, bool delivered);
+
+bool halRadio_init(unsigned long settleDelayMs);
+bool halRadio_send(const uint8_t* mac, const uint8_t* data, int len);
+bool halRadio_addPeer(const uint8_t* mac, uint8_t channel);
+void halRadio_setReceiveCallback(HalRadioReceiveCallback callback);
+void halRadio_setSendCallback(HalRadioSendCallback callback, void* arg);
+void halRadio_macAddress(uint8_t* mac);
+void halRadio_enablePowerSave();
+
+// NVS (key/value storage)
+bool halNvs_begin(const char* name, bool readOnly);
+void halNvs_end();
+int32_t halNvs_getInt(const char* key, int32_t defaultValue);
+bool halNvs_putInt(const char* key, int32_t value);  // false if not written
+uint8_t halNvs_getUChar(const char* key, uint8_t defaultValue);
+void halNvs_putUChar(const char* key, uint8_t value);
+bool halNvs_getBool(const char* key, bool defaultValue);
+void halNvs_putBool(const char* key, bool value);
+int halNvs_getBytes(const char* key, void* buffer, int maxLength);  // Bytes read, 0 if the key is missing
+bool halNvs_putBytes(const char* key, const void* data, int length);  // false if not written
+void halNvs_remove(const char* key);
+
+// HID keyboard (N-key rollover). press/release only update the key state;
+// halHid_flush sends it as one report if anything changed, so keys that
+// change together reach the host in the same USB frame.
+#define HAL_HID_POLL_INTERVAL_US 1000  // bInterval = 1 at full speed
+
+void halHid_begin();
+void halHid_press(uint8_t key);
+void halHid_release(uint8_t key);
+int64_t halHid_flush();  // halClock_micros() when the host picked the report up, or -1 if none was sent
+
+// Modifier keys: the report's modifier byte, one bit per key
+#define HAL_HID_MOD_LEFT_CTRL 0x01
+#define HAL_HID_MOD_LEFT_SHIFT 0x02
+#define HAL_HID_MOD_LEFT_ALT 0x04
+#define HAL_HID_MOD_LEFT_GUI 0x08
+#define HAL_HID_MOD_RIGHT_CTRL 0x10
+#define HAL_HID_MOD_RIGHT_SHIFT 0x20
+#define HAL_HID_MOD_RIGHT_ALT 0x40
+#define HAL_HID_MOD_RIGHT_GUI 0x80
+
+void halHid_setModifiers(uint8_t modifiers);  // Every modifier held, replacing the last set
+
+// HID gamepad, on the same interface as the keyboard under its own report ID;
+// halHid_flush sends it too when it changed
+#define HAL_HID_GAMEPAD_BUTTONS 16
+#define HAL_HID_GAMEPAD_AXES 4
+
+void halHid_setButton(uint8_t button, bool pressed);
+void halHid_setAxis(uint8_t axis, uint8_t value);  // 0 = at rest, 255 = fully pressed
+
+// Status pixel (single addressable RGB LED)
+void halPixel_begin(uint8_t pin);
+void halPixel_setColor(uint8_t r, uint8_t g, uint8_t b);
+
+#endif // HAL_H
@@ -0,0 +1,103 @@
+#include "../Hal.h"
+#include <esp_adc/adc_continuous.h>
+#include <esp_adc/adc_oneshot.h>
+#include <driver/gpio.h>
+#include <string.h>
+
+#define HAL_ADC_FRAME_BYTES 256   // One DMA conversion frame
+#define HAL_ADC_STORE_BYTES 1024  // Converted frames waiting for halAdc_read
+#define HAL_ADC_NO_PIN 0xFF
+
+static adc_continuous_handle_t g_adcHandle = nullptr;
+static uint8_t g_adcChannelPins[SOC_ADC_MAX_CHANNEL_NUM];  // ADC1 channel -> GPIO
+
+bool halAdc_beginContinuous(const uint8_t* pins, uint8_t count, uint32_t sampleRateHz) {
+  if (g_adcHandle || count == 0 || count > HAL_ADC_MAX_PINS) return false;
+
+  memset(g_adcChannelPins, HAL_ADC_NO_PIN, sizeof(g_adcChannelPins));
+  adc_digi_pattern_config_t patterns[HAL_ADC_MAX_PINS] = {};
+  for (uint8_t i = 0; i < count; i++) {
+    adc_unit_t unit;
+    adc_channel_t channel;
+    if (adc_continuous_io_to_channel(pins[i], &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) return false;
+
+    // A pull-up left from digital use would bias the sensor
+    gpio_pullup_dis((gpio_num_t)pins[i]);
+    gpio_pulldown_dis((gpio_num_t)pins[i]);
+    patterns[i].atten = ADC_ATTEN_DB_12;
+    patterns[i].channel = channel;
+    patterns[i].unit = ADC_UNIT_1;
+    patterns[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    g_adcChannelPins[channel] = pins[i];
+  }
+
+  adc_continuous_handle_cfg_t handleConfig = {};
+  handleConfig.max_store_buf_size = HAL_ADC_STORE_BYTES;
+  handleConfig.conv_frame_size = HAL_ADC_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleConfig, &g_adcHandle) != ESP_OK) return false;
+
+  adc_continuous_config_t config = {};
+  config.pattern_num = count;
+  config.adc_pattern = patterns;
+  config.sample_freq_hz = sampleRateHz;
+  config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_continuous_config(g_adcHandle, &config) != ESP_OK || adc_continuous_start(g_adcHandle) != ESP_OK) {
+    adc_continuous_deinit(g_adcHandle);
+    g_adcHandle = nullptr;
+    return false;
+  }
+  return true;
+}
+
+// Copies out of the driver's ring buffer without waiting; the DMA keeps
+// converting meanwhile
+int halAdc_read(HalAdcSample* samples, int maxSamples) {
+  if (!g_adcHandle) return 0;
+
+  uint8_t buffer[HAL_ADC_FRAME_BYTES];
+  int count = 0;
+  while (count < maxSamples) {
+    uint32_t wanted = (uint32_t)(maxSamples - count) * SOC_ADC_DIGI_RESULT_BYTES;
+    if (wanted > sizeof(buffer)) wanted = sizeof(buffer);
+
+    uint32_t length = 0;
+    if (adc_continuous_read(g_adcHandle, buffer, wanted, &length, 0) != ESP_OK || length == 0) break;
+
+    for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* result = (const adc_digi_output_data_t*)&buffer[offset];
+      uint32_t channel = result->type2.channel;
+      if (channel >= SOC_ADC_MAX_CHANNEL_NUM || g_adcChannelPins[channel] == HAL_ADC_NO_PIN) continue;
+
+      samples[count].pin = g_adcChannelPins[channel];
+      samples[count].value = (uint16_t)result->type2.data;
+      count++;
+    }
+  }
+  return count;
+}
+
+// Releases the unit again so halAdc_beginContinuous can claim it
+int halAdc_readOnce(uint8_t pin) {
+  adc_unit_t unit;
+  adc_channel_t channel;
+  if (adc_oneshot_io_to_channel(pin, &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) return -1;
+
+  adc_oneshot_unit_handle_t handle;
+  adc_oneshot_unit_init_cfg_t unitConfig = {};
+  unitConfig.unit_id = ADC_UNIT_1;
+  if (adc_oneshot_new_unit(&unitConfig, &handle) != ESP_OK) return -1;
+
+  gpio_pullup_dis((gpio_num_t)pin);
+  gpio_pulldown_dis((gpio_num_t)pin);
+  adc_oneshot_chan_cfg_t channelConfig = {};
+  channelConfig.atten = ADC_ATTEN_DB_12;
+  channelConfig.bitwidth = ADC_BITWIDTH_12;
+  int value = -1;
+  if (adc_oneshot_config_channel(handle, channel, &channelConfig) != ESP_OK ||
+      adc_oneshot_read(handle, channel, &value) != ESP_OK) {
+    value = -1;
+  }
+  adc_oneshot_del_unit(handle);
+  return value;
+}
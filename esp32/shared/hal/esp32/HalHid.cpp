@@ -0,0 +1,161 @@
+#include "../Hal.h"
+#include <USB.h>
+#include <USBHID.h>
+#include <Arduino.h>
+#include <string.h>
+
+// N-key-rollover keyboard: one bit per key usage instead of the boot
+// keyboard's six slots, so every pedal key fits in one report however many
+// are held. A gamepad shares the interface under a second report ID. USBHID's
+// interface descriptor asks the host to poll every 1 ms (bInterval = 1).
+#define HID_NKRO_REPORT_ID 1
+#define HID_GAMEPAD_REPORT_ID 2
+#define HID_GAMEPAD_REPORT_SIZE (HAL_HID_GAMEPAD_BUTTONS / 8 + HAL_HID_GAMEPAD_AXES)  // Button bits, then one byte per axis
+#define HID_NKRO_KEY_COUNT 104  // Usages 0x00-0x67: letters, digits, punctuation, F1-F12, navigation
+#define HID_NKRO_REPORT_SIZE (1 + HID_NKRO_KEY_COUNT / 8)  // Modifier byte, then the key bitmap
+
+static const uint8_t kReportDescriptor[] = {
+  0x05, 0x01,                     // Usage Page (Generic Desktop)
+  0x09, 0x06,                     // Usage (Keyboard)
+  0xA1, 0x01,                     // Collection (Application)
+  0x85, HID_NKRO_REPORT_ID,       //   Report ID
+  0x05, 0x07,                     //   Usage Page (Keyboard/Keypad)
+  0x19, 0xE0, 0x29, 0xE7,         //   Usage Minimum/Maximum (Left Control .. Right GUI)
+  0x15, 0x00, 0x25, 0x01,         //   Logical Minimum 0, Maximum 1
+  0x75, 0x01, 0x95, 0x08,         //   Report Size 1, Count 8
+  0x81, 0x02,                     //   Input (Data, Variable, Absolute): modifiers
+  0x19, 0x00, 0x29, HID_NKRO_KEY_COUNT - 1,  // Usage Minimum/Maximum
+  0x95, HID_NKRO_KEY_COUNT,       //   Report Count (Report Size still 1)
+  0x81, 0x02,                     //   Input (Data, Variable, Absolute): key bitmap
+  0xC0,                           // End Collection
+  
+  0x05, 0x01,                     // Usage Page (Generic Desktop)
+  0x09, 0x05,                     // Usage (Game Pad)
+  0xA1, 0x01,                     // Collection (Application)
+  0x85, HID_GAMEPAD_REPORT_ID,    //   Report ID
+  0x05, 0x09,                     //   Usage Page (Button)
+  0x19, 0x01, 0x29, HAL_HID_GAMEPAD_BUTTONS,  // Usage Minimum/Maximum (Button 1 .. 16)
+  0x15, 0x00, 0x25, 0x01,         //   Logical Minimum 0, Maximum 1
+  0x75, 0x01, 0x95, HAL_HID_GAMEPAD_BUTTONS,  // Report Size 1, Count 16
+  0x81, 0x02,                     //   Input (Data, Variable, Absolute): buttons
+  0x05, 0x01,                     //   Usage Page (Generic Desktop)
+  0x09, 0x30, 0x09, 0x31,         //   Usage (X), Usage (Y)
+  0x09, 0x32, 0x09, 0x33,         //   Usage (Z), Usage (Rx)
+  0x15, 0x00, 0x26, 0xFF, 0x00,   //   Logical Minimum 0, Maximum 255
+  0x75, 0x08, 0x95, HAL_HID_GAMEPAD_AXES,  // Report Size 8, Count 4
+  0x81, 0x02,                     //   Input (Data, Variable, Absolute): axes
+  0xC0,                           // End Collection
+};
+
+static USBHID g_hid;
+
+class HalPedalHid : public USBHIDDevice {
+ public:
+  HalPedalHid() {
+    USBHID::addDevice(this, sizeof(kReportDescriptor));
+  }
+  
+  uint16_t _onGetDescriptor(uint8_t* buffer) override {
+    memcpy(buffer, kReportDescriptor, sizeof(kReportDescriptor));
+    return sizeof(kReportDescriptor);
+  }
+};
+
+static HalPedalHid g_device;
+static uint8_t g_report[HID_NKRO_REPORT_SIZE];
+static bool g_reportChanged = false;
+static uint8_t g_gamepadReport[HID_GAMEPAD_REPORT_SIZE];
+static bool g_gamepadReportChanged = false;
+
+// HID usage for the printable ASCII keys the pedals are mapped to, 0 if none
+static uint8_t halHid_usage(uint8_t key) {
+  if (key >= 'a' && key <= 'z') return 0x04 + (key - 'a');
+  if (key >= 'A' && key <= 'Z') return 0x04 + (key - 'A');
+  if (key >= '1' && key <= '9') return 0x1E + (key - '1');
+  switch (key) {
+    case '0':  return 0x27;
+    case '\n': return 0x28;
+    case ' ':  return 0x2C;
+    case '-':  return 0x2D;
+    case '=':  return 0x2E;
+    case '[':  return 0x2F;
+    case ']':  return 0x30;
+    case ';':  return 0x33;
+    case ',':  return 0x36;
+    case '.':  return 0x37;
+    case '/':  return 0x38;
+    default:   return 0;
+  }
+}
+
+static void halHid_setKey(uint8_t key, bool pressed) {
+  uint8_t usage = halHid_usage(key);
+  if (!usage || usage >= HID_NKRO_KEY_COUNT) return;
+  
+  uint8_t* byte = &g_report[1 + usage / 8];
+  uint8_t bit = (uint8_t)(1 << (usage % 8));
+  uint8_t updated = pressed ? (*byte | bit) : (*byte & (uint8_t)~bit);
+  if (updated != *byte) {
+    *byte = updated;
+    g_reportChanged = true;
+  }
+}
+
+void halHid_begin() {
+  USB.begin();
+  delay(500);
+  g_hid.begin();
+  delay(2000);
+}
+
+void halHid_press(uint8_t key) {
+  halHid_setKey(key, true);
+}
+
+void halHid_release(uint8_t key) {
+  halHid_setKey(key, false);
+}
+
+void halHid_setModifiers(uint8_t modifiers) {
+  if (g_report[0] != modifiers) {
+    g_report[0] = modifiers;
+    g_reportChanged = true;
+  }
+}
+
+void halHid_setButton(uint8_t button, bool pressed) {
+  if (button >= HAL_HID_GAMEPAD_BUTTONS) return;
+  
+  uint8_t* byte = &g_gamepadReport[button / 8];
+  uint8_t bit = (uint8_t)(1 << (button % 8));
+  uint8_t updated = pressed ? (*byte | bit) : (*byte & (uint8_t)~bit);
+  if (updated != *byte) {
+    *byte = updated;
+    g_gamepadReportChanged = true;
+  }
+}
+
+void halHid_setAxis(uint8_t axis, uint8_t value) {
+  if (axis >= HAL_HID_GAMEPAD_AXES) return;
+  
+  uint8_t* byte = &g_gamepadReport[HAL_HID_GAMEPAD_BUTTONS / 8 + axis];
+  if (*byte != value) {
+    *byte = value;
+    g_gamepadReportChanged = true;
+  }
+}
+
+// SendReport returns once the host's IN token has taken the report, so the
+// caller's changes made meanwhile go out together in the next one
+int64_t halHid_flush() {
+  int64_t pickup = -1;
+  if (g_reportChanged) {
+    g_reportChanged = false;
+    if (g_hid.SendReport(HID_NKRO_REPORT_ID, g_report, sizeof(g_report))) pickup = halClock_micros();
+  }
+  if (g_gamepadReportChanged) {
+    g_gamepadReportChanged = false;
+    if (g_hid.SendReport(HID_GAMEPAD_REPORT_ID, g_gamepadReport, sizeof(g_gamepadReport))) pickup = halClock_micros();
+  }
+  return pickup;
+}
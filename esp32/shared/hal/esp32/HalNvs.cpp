@@ -0,0 +1,48 @@
+#include "../Hal.h"
+#include <Preferences.h>
+
+static Preferences g_preferences;
+
+bool halNvs_begin(const char* name, bool readOnly) {
+  return g_preferences.begin(name, readOnly);
+}
+
+void halNvs_end() {
+  g_preferences.end();
+}
+
+int32_t halNvs_getInt(const char* key, int32_t defaultValue) {
+  return g_preferences.getInt(key, defaultValue);
+}
+
+bool halNvs_putInt(const char* key, int32_t value) {
+  return g_preferences.putInt(key, value) == sizeof(int32_t);
+}
+
+uint8_t halNvs_getUChar(const char* key, uint8_t defaultValue) {
+  return g_preferences.getUChar(key, defaultValue);
+}
+
+void halNvs_putUChar(const char* key, uint8_t value) {
+  g_preferences.putUChar(key, value);
+}
+
+bool halNvs_getBool(const char* key, bool defaultValue) {
+  return g_preferences.getBool(key, defaultValue);
+}
+
+void halNvs_putBool(const char* key, bool value) {
+  g_preferences.putBool(key, value);
+}
+
+int halNvs_getBytes(const char* key, void* buffer, int maxLength) {
+  return (int)g_preferences.getBytes(key, buffer, maxLength);
+}
+
+bool halNvs_putBytes(const char* key, const void* data, int length) {
+  return g_preferences.putBytes(key, data, length) == (size_t)length;
+}
+
+void halNvs_remove(const char* key) {
+  g_preferences.remove(key);
+}
@@ -0,0 +1,16 @@
+#include "../Hal.h"
+#include <Adafruit_NeoPixel.h>
+
+static Adafruit_NeoPixel g_pixel(1, 0, NEO_GRB + NEO_KHZ800);
+
+void halPixel_begin(uint8_t pin) {
+  g_pixel.setPin(pin);
+  g_pixel.begin();
+  g_pixel.clear();
+  g_pixel.show();
+}
+
+void halPixel_setColor(uint8_t r, uint8_t g, uint8_t b) {
+  g_pixel.setPixelColor(0, g_pixel.Color(r, g, b));
+  g_pixel.show();
+}
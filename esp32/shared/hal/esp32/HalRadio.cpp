@@ -0,0 +1,75 @@
+#include "../Hal.h"
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <esp_idf_version.h>
+#include <WiFi.h>
+#include <string.h>
+#include <Arduino.h>
+
+static HalRadioReceiveCallback g_radioReceiveCallback = nullptr;
+static HalRadioSendCallback g_radioSendCallback = nullptr;
+static void* g_radioSendCallbackArg = nullptr;
+
+static void halRadio_onDataRecv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+  if (g_radioReceiveCallback) {
+    uint8_t channel = info->rx_ctrl ? info->rx_ctrl->channel : 0;
+    g_radioReceiveCallback(info->src_addr, data, len, channel);
+  }
+}
+
+// ESP-IDF 5.5 passes the frame's tx info instead of the bare destination MAC
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0)
+static void halRadio_onDataSent(const esp_now_send_info_t *info, esp_now_send_status_t status) {
+  if (g_radioSendCallback) {
+    g_radioSendCallback(g_radioSendCallbackArg, info->des_addr, status == ESP_NOW_SEND_SUCCESS);
+  }
+}
+#else
+static void halRadio_onDataSent(const uint8_t *mac, esp_now_send_status_t status) {
+  if (g_radioSendCallback) {
+    g_radioSendCallback(g_radioSendCallbackArg, mac, status == ESP_NOW_SEND_SUCCESS);
+  }
+}
+#endif
+
+bool halRadio_init(unsigned long settleDelayMs) {
+  WiFi.mode(WIFI_STA);
+  if (settleDelayMs) delay(settleDelayMs);
+  WiFi.disconnect();
+  if (settleDelayMs) delay(settleDelayMs);
+  
+  return esp_now_init() == ESP_OK;
+}
+
+bool halRadio_send(const uint8_t* mac, const uint8_t* data, int len) {
+  return esp_now_send(mac, data, len) == ESP_OK;
+}
+
+bool halRadio_addPeer(const uint8_t* mac, uint8_t channel) {
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = channel;
+  peerInfo.encrypt = false;
+  
+  esp_err_t result = esp_now_add_peer(&peerInfo);
+  return (result == ESP_OK || result == ESP_ERR_ESPNOW_EXIST);
+}
+
+void halRadio_setReceiveCallback(HalRadioReceiveCallback callback) {
+  g_radioReceiveCallback = callback;
+  esp_now_register_recv_cb(halRadio_onDataRecv);
+}
+
+void halRadio_setSendCallback(HalRadioSendCallback callback, void* arg) {
+  g_radioSendCallbackArg = arg;
+  g_radioSendCallback = callback;
+  esp_now_register_send_cb(halRadio_onDataSent);
+}
+
+void halRadio_macAddress(uint8_t* mac) {
+  WiFi.macAddress(mac);
+}
+
+void halRadio_enablePowerSave() {
+  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+}
@@ -0,0 +1,179 @@
+#include "../Hal.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <soc/gpio_reg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+static SemaphoreHandle_t g_wakeSemaphore = nullptr;
+
+unsigned long halClock_millis() {
+  return millis();
+}
+
+// esp_timer_get_time is in IRAM, so this is safe from the pedal ISRs
+int64_t HAL_ISR_ATTR halClock_micros() {
+  return esp_timer_get_time();
+}
+
+void halClock_delay(unsigned long ms) {
+  delay(ms);
+}
+
+void halClock_delayMicros(uint32_t us) {
+  delayMicroseconds(us);
+}
+
+void halClock_idle(unsigned long ms) {
+  if (!g_wakeSemaphore) {
+    g_wakeSemaphore = xSemaphoreCreateBinary();
+  }
+  xSemaphoreTake(g_wakeSemaphore, pdMS_TO_TICKS(ms));
+}
+
+void HAL_ISR_ATTR halClock_wakeFromIsr() {
+  if (!g_wakeSemaphore) return;
+  
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  xSemaphoreGiveFromISR(g_wakeSemaphore, &higherPriorityTaskWoken);
+  if (higherPriorityTaskWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void halClock_wake() {
+  if (!g_wakeSemaphore) return;
+  
+  xSemaphoreGive(g_wakeSemaphore);
+}
+
+void halGpio_inputPullup(uint8_t pin) {
+  pinMode(pin, INPUT_PULLUP);
+}
+
+void halGpio_output(uint8_t pin) {
+  pinMode(pin, OUTPUT);
+}
+
+// Reads the input register directly: digitalRead lives in flash, and the
+// pedal ISRs call this
+bool HAL_ISR_ATTR halGpio_read(uint8_t pin) {
+  uint32_t levels = pin < 32 ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+  return (levels >> (pin & 31)) & 1;
+}
+
+void halGpio_write(uint8_t pin, bool level) {
+  digitalWrite(pin, level ? HIGH : LOW);
+}
+
+uint32_t halGpio_readBank(uint8_t bank) {
+  return bank == 0 ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+}
+
+void halGpio_attachEdgeInterrupt(uint8_t pin, HalGpioEdgeHandler handler, void* arg) {
+  attachInterruptArg(digitalPinToInterrupt(pin), handler, arg, CHANGE);
+}
+
+#define HAL_MAX_TASKS 4
+
+struct HalTask {
+  TaskHandle_t handle;
+  HalTaskStep step;
+  void* arg;
+  TickType_t periodTicks;
+  esp_timer_handle_t timer;  // halTask_notifyAfter; created on first use
+};
+
+static HalTask g_tasks[HAL_MAX_TASKS];
+static int g_taskCount = 0;
+
+static void halTask_run(void* param) {
+  HalTask* task = (HalTask*)param;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, task->periodTicks);
+    task->step(task->arg);
+  }
+}
+
+HalTask* halTask_start(const char* name, HalTaskStep step, void* arg, uint8_t priority, uint8_t core,
+                       unsigned long periodMs) {
+  if (g_taskCount >= HAL_MAX_TASKS) return nullptr;
+  
+  HalTask* task = &g_tasks[g_taskCount];
+  task->step = step;
+  task->arg = arg;
+  task->periodTicks = pdMS_TO_TICKS(periodMs);
+  task->timer = nullptr;
+  if (xTaskCreatePinnedToCore(halTask_run, name, 4096, task, priority, &task->handle, core) != pdPASS) {
+    return nullptr;
+  }
+  g_taskCount++;
+  return task;
+}
+
+void halTask_notify(HalTask* task) {
+  xTaskNotifyGive(task->handle);
+}
+
+static void halTask_onTimer(void* arg) {
+  halTask_notify((HalTask*)arg);
+}
+
+// Tick-based waits are 1 ms coarse; esp_timer wakes the task to the microsecond
+void halTask_notifyAfter(HalTask* task, uint32_t micros) {
+  if (!task->timer) {
+    esp_timer_create_args_t args = {};
+    args.callback = halTask_onTimer;
+    args.arg = task;
+    args.name = "halTask";
+    if (esp_timer_create(&args, &task->timer) != ESP_OK) {
+      task->timer = nullptr;
+      halTask_notify(task);
+      return;
+    }
+  }
+  esp_timer_stop(task->timer);
+  esp_timer_start_once(task->timer, micros);
+}
+
+HalLock* halLock_create() {
+  return (HalLock*)xSemaphoreCreateMutex();
+}
+
+void halLock_take(HalLock* lock) {
+  xSemaphoreTake((SemaphoreHandle_t)lock, portMAX_DELAY);
+}
+
+void halLock_give(HalLock* lock) {
+  xSemaphoreGive((SemaphoreHandle_t)lock);
+}
+
+void halPower_setCpuFrequencyMhz(uint32_t mhz) {
+  setCpuFrequencyMhz(mhz);
+}
+
+void halPower_deepSleep(uint8_t wakePin) {
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)wakePin, LOW);
+  esp_deep_sleep_start();
+}
+
+void halPower_deepSleepFor(unsigned long ms) {
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  esp_deep_sleep_start();
+}
+
+bool halPower_wokeByTimer() {
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+void halLog_begin(unsigned long baud) {
+  Serial.begin(baud);
+}
+
+void halLog_vprintf(const char* format, va_list args) {
+  char buffer[256];
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  Serial.print(buffer);
+}
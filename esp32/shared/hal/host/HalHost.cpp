@@ -0,0 +1,572 @@
+#include "HalHost.h"
+#include <stdio.h>
+#include <string.h>
+
+static HalHostNode g_defaultNode;
+static bool g_defaultNodeReady = false;
+static HalHostNode* g_currentNode = nullptr;
+
+static int64_t g_clockMicros = 0;
+static bool g_delayAdvancesClock = true;
+static bool g_logEnabled = true;
+
+static HalHostSendHook g_sendHook = nullptr;
+static void* g_sendHookContext = nullptr;
+static HalHostHidHook g_hidHook = nullptr;
+static void* g_hidHookContext = nullptr;
+
+// ----------------------------------------------------------------------------
+// Host control
+// ----------------------------------------------------------------------------
+
+void halHost_initNode(HalHostNode* node, const uint8_t* mac) {
+  memset(node, 0, sizeof(HalHostNode));
+  memcpy(node->mac, mac, 6);
+  for (int i = 0; i < HAL_HOST_MAX_PINS; i++) {
+    node->pins[i] = HAL_GPIO_HIGH;  // Pull-ups, nothing pressed
+  }
+  for (int i = 0; i < HAL_HOST_MAX_PINS / 32; i++) {
+    node->pinBanks[i] = 0xFFFFFFFF;
+  }
+}
+
+void halHost_selectNode(HalHostNode* node) {
+  g_currentNode = node;
+}
+
+HalHostNode* halHost_currentNode() {
+  if (g_currentNode) return g_currentNode;
+  
+  if (!g_defaultNodeReady) {
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    halHost_initNode(&g_defaultNode, mac);
+    g_defaultNodeReady = true;
+  }
+  g_currentNode = &g_defaultNode;
+  return g_currentNode;
+}
+
+void halHost_setMicros(int64_t micros) {
+  g_clockMicros = micros;
+}
+
+void halHost_advanceMicros(int64_t micros) {
+  g_clockMicros += micros;
+}
+
+void halHost_advanceMillis(unsigned long ms) {
+  g_clockMicros += (int64_t)ms * 1000;
+}
+
+void halHost_setDelayAdvancesClock(bool enabled) {
+  g_delayAdvancesClock = enabled;
+}
+
+static void halHost_storePin(HalHostNode* node, uint8_t pin, bool level) {
+  node->pins[pin] = level;
+  uint32_t bit = 1UL << (pin % 32);
+  node->pinBanks[pin / 32] = level ? (node->pinBanks[pin / 32] | bit) : (node->pinBanks[pin / 32] & ~bit);
+}
+
+void halHost_setPin(uint8_t pin, bool level) {
+  if (pin >= HAL_HOST_MAX_PINS) return;
+  HalHostNode* node = halHost_currentNode();
+  bool changed = node->pins[pin] != level;
+  halHost_storePin(node, pin, level);
+  if (changed && node->edgeHandlers[pin]) {
+    node->edgeHandlers[pin](node->edgeHandlerArgs[pin]);
+  }
+}
+
+void halHost_setAnalog(uint8_t pin, uint16_t value) {
+  if (pin >= HAL_HOST_MAX_PINS) return;
+  halHost_currentNode()->analog[pin] = value > HAL_ADC_MAX_VALUE ? HAL_ADC_MAX_VALUE : value;
+}
+
+void halHost_setSendHook(HalHostSendHook hook, void* context) {
+  g_sendHook = hook;
+  g_sendHookContext = context;
+}
+
+void halHost_deliver(HalHostNode* node, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel) {
+  if (!node->radioInitialized || !node->receiveCallback || node->asleep) return;
+  
+  HalHostNode* previous = g_currentNode;
+  g_currentNode = node;
+  node->receiveCallback(senderMAC, data, len, channel);
+  g_currentNode = previous;
+}
+
+void halHost_completeSend(HalHostNode* node, const uint8_t* dstMAC, bool delivered) {
+  if (!node->radioInitialized || !node->sendCallback || node->asleep) return;
+  
+  HalHostNode* previous = g_currentNode;
+  g_currentNode = node;
+  node->sendCallback(node->sendCallbackArg, dstMAC, delivered);
+  g_currentNode = previous;
+}
+
+void halHost_setHidHook(HalHostHidHook hook, void* context) {
+  g_hidHook = hook;
+  g_hidHookContext = context;
+}
+
+void halHost_clearHidEvents(HalHostNode* node) {
+  node->hidEventCount = 0;
+}
+
+void halHost_setLogEnabled(bool enabled) {
+  g_logEnabled = enabled;
+}
+
+// ----------------------------------------------------------------------------
+// Clock
+// ----------------------------------------------------------------------------
+
+unsigned long halClock_millis() {
+  return (unsigned long)(g_clockMicros / 1000);
+}
+
+int64_t halClock_micros() {
+  return g_clockMicros;
+}
+
+static void halHost_runDueTasks();
+
+void halClock_delay(unsigned long ms) {
+  if (g_delayAdvancesClock) halHost_advanceMillis(ms);
+  halHost_runDueTasks();
+}
+
+void halClock_delayMicros(uint32_t us) {
+  if (g_delayAdvancesClock) halHost_advanceMicros(us);
+  halHost_runDueTasks();
+}
+
+void halClock_idle(unsigned long ms) {
+  HalHostNode* node = halHost_currentNode();
+  if (node->wakePending) {
+    node->wakePending = false;
+    return;
+  }
+  halClock_delay(ms);
+}
+
+void halClock_wakeFromIsr() {
+  halHost_currentNode()->wakePending = true;
+}
+
+void halClock_wake() {
+  halHost_currentNode()->wakePending = true;
+}
+
+// ----------------------------------------------------------------------------
+// Tasks
+// ----------------------------------------------------------------------------
+
+static void halHost_runTask(HalTask* task) {
+  if (task->running) {
+    task->notified = true;
+    return;
+  }
+  task->running = true;
+  task->nextRunMicros = g_clockMicros + task->periodMicros;  // The step may bring this forward
+  do {
+    task->notified = false;
+    task->step(task->arg);
+  } while (task->notified);
+  task->running = false;
+}
+
+static void halHost_runDueTasks() {
+  HalHostNode* node = halHost_currentNode();
+  for (int i = 0; i < node->taskCount; i++) {
+    if (g_clockMicros >= node->tasks[i].nextRunMicros) {
+      halHost_runTask(&node->tasks[i]);
+    }
+  }
+}
+
+HalTask* halTask_start(const char* name, HalTaskStep step, void* arg, uint8_t priority, uint8_t core,
+                       unsigned long periodMs) {
+  (void)name;
+  (void)priority;
+  (void)core;
+  HalHostNode* node = halHost_currentNode();
+  if (node->taskCount >= HAL_HOST_MAX_TASKS) return nullptr;
+  
+  HalTask* task = &node->tasks[node->taskCount++];
+  task->step = step;
+  task->arg = arg;
+  task->periodMicros = (int64_t)periodMs * 1000;
+  task->nextRunMicros = g_clockMicros + task->periodMicros;
+  return task;
+}
+
+void halTask_notify(HalTask* task) {
+  halHost_runTask(task);
+}
+
+void halTask_notifyAfter(HalTask* task, uint32_t micros) {
+  if (g_clockMicros + micros < task->nextRunMicros) {
+    task->nextRunMicros = g_clockMicros + micros;
+  }
+}
+
+// One thread: nothing to exclude
+struct HalLock {
+  int unused;
+};
+
+HalLock* halLock_create() {
+  static HalLock lock;
+  return &lock;
+}
+
+void halLock_take(HalLock* lock) {
+  (void)lock;
+}
+
+void halLock_give(HalLock* lock) {
+  (void)lock;
+}
+
+// ----------------------------------------------------------------------------
+// GPIO
+// ----------------------------------------------------------------------------
+
+void halGpio_inputPullup(uint8_t pin) {
+  (void)pin;
+}
+
+void halGpio_output(uint8_t pin) {
+  (void)pin;
+}
+
+bool halGpio_read(uint8_t pin) {
+  if (pin >= HAL_HOST_MAX_PINS) return HAL_GPIO_HIGH;
+  return halHost_currentNode()->pins[pin];
+}
+
+void halGpio_write(uint8_t pin, bool level) {
+  if (pin >= HAL_HOST_MAX_PINS) return;
+  halHost_storePin(halHost_currentNode(), pin, level);
+}
+
+uint32_t halGpio_readBank(uint8_t bank) {
+  if (bank >= HAL_HOST_MAX_PINS / 32) return 0xFFFFFFFF;
+  return halHost_currentNode()->pinBanks[bank];
+}
+
+void halGpio_attachEdgeInterrupt(uint8_t pin, HalGpioEdgeHandler handler, void* arg) {
+  if (pin >= HAL_HOST_MAX_PINS) return;
+  halHost_currentNode()->edgeHandlers[pin] = handler;
+  halHost_currentNode()->edgeHandlerArgs[pin] = arg;
+}
+
+// ----------------------------------------------------------------------------
+// ADC
+// ----------------------------------------------------------------------------
+
+bool halAdc_beginContinuous(const uint8_t* pins, uint8_t count, uint32_t sampleRateHz) {
+  HalHostNode* node = halHost_currentNode();
+  if (count == 0 || count > HAL_ADC_MAX_PINS || sampleRateHz == 0) return false;
+  
+  memcpy(node->adcPins, pins, count);
+  node->adcPinCount = count;
+  node->adcSampleRateHz = sampleRateHz;
+  node->adcStartMicros = g_clockMicros;
+  node->adcConversions = 0;
+  return true;
+}
+
+// Conversions happen on the virtual clock, cycling through the pins; any
+// beyond what the buffer holds have been overwritten
+int halAdc_read(HalAdcSample* samples, int maxSamples) {
+  HalHostNode* node = halHost_currentNode();
+  if (node->adcPinCount == 0) return 0;
+  
+  uint64_t due = (uint64_t)(g_clockMicros - node->adcStartMicros) * node->adcSampleRateHz / 1000000;
+  if (due - node->adcConversions > HAL_HOST_ADC_BUFFER) {
+    node->adcConversions = due - HAL_HOST_ADC_BUFFER;
+  }
+  
+  int count = 0;
+  while (count < maxSamples && node->adcConversions < due) {
+    uint8_t pin = node->adcPins[node->adcConversions % node->adcPinCount];
+    samples[count].pin = pin;
+    samples[count].value = pin < HAL_HOST_MAX_PINS ? node->analog[pin] : 0;
+    count++;
+    node->adcConversions++;
+  }
+  return count;
+}
+
+int halAdc_readOnce(uint8_t pin) {
+  HalHostNode* node = halHost_currentNode();
+  return pin < HAL_HOST_MAX_PINS ? node->analog[pin] : -1;
+}
+
+// ----------------------------------------------------------------------------
+// Power
+// ----------------------------------------------------------------------------
+
+void halPower_setCpuFrequencyMhz(uint32_t mhz) {
+  (void)mhz;
+}
+
+void halPower_deepSleep(uint8_t wakePin) {
+  (void)wakePin;
+  halHost_currentNode()->asleep = true;
+}
+
+void halPower_deepSleepFor(unsigned long ms) {
+  (void)ms;
+  halHost_currentNode()->asleep = true;
+}
+
+bool halPower_wokeByTimer() {
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+// Log
+// ----------------------------------------------------------------------------
+
+void halLog_begin(unsigned long baud) {
+  (void)baud;
+}
+
+void halLog_vprintf(const char* format, va_list args) {
+  if (!g_logEnabled) return;
+  vprintf(format, args);
+}
+
+// ----------------------------------------------------------------------------
+// Radio
+// ----------------------------------------------------------------------------
+
+bool halRadio_init(unsigned long settleDelayMs) {
+  halClock_delay(settleDelayMs * 2);
+  halHost_currentNode()->radioInitialized = true;
+  return true;
+}
+
+bool halRadio_send(const uint8_t* mac, const uint8_t* data, int len) {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->radioInitialized || node->asleep) return false;
+  bool accepted = g_sendHook ? g_sendHook(g_sendHookContext, node, mac, data, len) : true;
+  if (accepted && !node->deferSendCompletion && node->sendCallback) {
+    node->sendCallback(node->sendCallbackArg, mac, true);
+  }
+  return accepted;
+}
+
+bool halRadio_addPeer(const uint8_t* mac, uint8_t channel) {
+  (void)mac;
+  (void)channel;
+  return halHost_currentNode()->radioInitialized;
+}
+
+void halRadio_setReceiveCallback(HalRadioReceiveCallback callback) {
+  halHost_currentNode()->receiveCallback = callback;
+}
+
+void halRadio_setSendCallback(HalRadioSendCallback callback, void* arg) {
+  HalHostNode* node = halHost_currentNode();
+  node->sendCallback = callback;
+  node->sendCallbackArg = arg;
+}
+
+void halRadio_macAddress(uint8_t* mac) {
+  memcpy(mac, halHost_currentNode()->mac, 6);
+}
+
+void halRadio_enablePowerSave() {
+}
+
+// ----------------------------------------------------------------------------
+// NVS
+// ----------------------------------------------------------------------------
+
+static HalHostNvsEntry* halHost_findNvsEntry(HalHostNode* node, const char* key, bool create) {
+  HalHostNvsEntry* freeEntry = nullptr;
+  for (int i = 0; i < HAL_HOST_MAX_NVS_ENTRIES; i++) {
+    HalHostNvsEntry* entry = &node->nvs[i];
+    if (!entry->used) {
+      if (!freeEntry) freeEntry = entry;
+      continue;
+    }
+    if (strncmp(entry->name, node->nvsName, sizeof(entry->name)) == 0 &&
+        strncmp(entry->key, key, sizeof(entry->key)) == 0) {
+      return entry;
+    }
+  }
+  
+  if (!create || !freeEntry) return nullptr;
+  
+  snprintf(freeEntry->name, sizeof(freeEntry->name), "%s", node->nvsName);
+  snprintf(freeEntry->key, sizeof(freeEntry->key), "%s", key);
+  freeEntry->used = true;
+  return freeEntry;
+}
+
+static int32_t halHost_nvsGet(const char* key, int32_t defaultValue) {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->nvsOpen) return defaultValue;
+  HalHostNvsEntry* entry = halHost_findNvsEntry(node, key, false);
+  return entry ? entry->value : defaultValue;
+}
+
+static bool halHost_nvsPut(const char* key, int32_t value) {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->nvsOpen || node->nvsReadOnly) return false;
+  HalHostNvsEntry* entry = halHost_findNvsEntry(node, key, true);
+  if (!entry) return false;
+  entry->value = value;
+  return true;
+}
+
+bool halNvs_begin(const char* name, bool readOnly) {
+  HalHostNode* node = halHost_currentNode();
+  snprintf(node->nvsName, sizeof(node->nvsName), "%s", name);
+  node->nvsOpen = true;
+  node->nvsReadOnly = readOnly;
+  return true;
+}
+
+void halNvs_end() {
+  halHost_currentNode()->nvsOpen = false;
+}
+
+int32_t halNvs_getInt(const char* key, int32_t defaultValue) {
+  return halHost_nvsGet(key, defaultValue);
+}
+
+bool halNvs_putInt(const char* key, int32_t value) {
+  return halHost_nvsPut(key, value);
+}
+
+uint8_t halNvs_getUChar(const char* key, uint8_t defaultValue) {
+  return (uint8_t)halHost_nvsGet(key, defaultValue);
+}
+
+void halNvs_putUChar(const char* key, uint8_t value) {
+  halHost_nvsPut(key, value);
+}
+
+bool halNvs_getBool(const char* key, bool defaultValue) {
+  return halHost_nvsGet(key, defaultValue ? 1 : 0) != 0;
+}
+
+void halNvs_putBool(const char* key, bool value) {
+  halHost_nvsPut(key, value ? 1 : 0);
+}
+
+int halNvs_getBytes(const char* key, void* buffer, int maxLength) {
+  HalHostNode* node = halHost_currentNode();
+  HalHostNvsEntry* entry = node->nvsOpen ? halHost_findNvsEntry(node, key, false) : nullptr;
+  if (!entry || entry->value > maxLength) return 0;
+  memcpy(buffer, entry->bytes, entry->value);
+  return entry->value;
+}
+
+bool halNvs_putBytes(const char* key, const void* data, int length) {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->nvsOpen || node->nvsReadOnly || length > HAL_HOST_NVS_BLOB_MAX) return false;
+  HalHostNvsEntry* entry = halHost_findNvsEntry(node, key, true);
+  if (!entry) return false;
+  memcpy(entry->bytes, data, length);
+  entry->value = length;
+  return true;
+}
+
+void halNvs_remove(const char* key) {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->nvsOpen || node->nvsReadOnly) return;
+  HalHostNvsEntry* entry = halHost_findNvsEntry(node, key, false);
+  if (entry) entry->used = false;
+}
+
+// ----------------------------------------------------------------------------
+// HID
+// ----------------------------------------------------------------------------
+
+static void halHost_logHidEvent(uint8_t key, bool pressed, bool gamepad) {
+  HalHostNode* node = halHost_currentNode();
+  HalHostHidEvent event = {g_clockMicros, key, pressed, gamepad};
+  
+  if (node->hidEventCount < HAL_HOST_MAX_HID_EVENTS) {
+    node->hidEvents[node->hidEventCount++] = event;
+  }
+  node->hidReportPending = true;
+  if (g_hidHook) {
+    g_hidHook(g_hidHookContext, node, &event);
+  }
+}
+
+void halHid_begin() {
+  halClock_delay(2500);
+}
+
+void halHid_press(uint8_t key) {
+  halHost_logHidEvent(key, true, false);
+}
+
+void halHid_release(uint8_t key) {
+  halHost_logHidEvent(key, false, false);
+}
+
+void halHid_setModifiers(uint8_t modifiers) {
+  HalHostNode* node = halHost_currentNode();
+  if (node->hidModifiers == modifiers) return;
+  
+  node->hidModifiers = modifiers;
+  node->hidReportPending = true;
+}
+
+void halHid_setButton(uint8_t button, bool pressed) {
+  halHost_logHidEvent(button, pressed, true);
+}
+
+void halHid_setAxis(uint8_t axis, uint8_t value) {
+  HalHostNode* node = halHost_currentNode();
+  if (axis >= HAL_HID_GAMEPAD_AXES || node->hidAxes[axis] == value) return;
+  
+  node->hidAxes[axis] = value;
+  node->hidReportPending = true;
+}
+
+// The fake host polls once per frame; a report waits for the first poll
+// after it is staged, and behind any report still waiting for its own
+int64_t halHid_flush() {
+  HalHostNode* node = halHost_currentNode();
+  if (!node->hidReportPending) return -1;
+  
+  node->hidReportPending = false;
+  node->hidReportCount++;
+  
+  int64_t sincePhase = g_clockMicros - node->hidPollPhaseMicros;
+  int64_t pickup = node->hidPollPhaseMicros + (sincePhase / HAL_HID_POLL_INTERVAL_US + 1) * HAL_HID_POLL_INTERVAL_US;
+  if (node->hidReportCount > 1 && pickup <= node->hidLastPickupMicros) {
+    pickup = node->hidLastPickupMicros + HAL_HID_POLL_INTERVAL_US;
+  }
+  node->hidLastPickupMicros = pickup;
+  return pickup;
+}
+
+// ----------------------------------------------------------------------------
+// Status pixel
+// ----------------------------------------------------------------------------
+
+void halPixel_begin(uint8_t pin) {
+  (void)pin;
+  halPixel_setColor(0, 0, 0);
+}
+
+void halPixel_setColor(uint8_t r, uint8_t g, uint8_t b) {
+  HalHostNode* node = halHost_currentNode();
+  node->pixel[0] = r;
+  node->pixel[1] = g;
+  node->pixel[2] = b;
+}
@@ -0,0 +1,114 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../Hal.h"
+
+// Host-side fakes for the HAL. State that belongs to a board (MAC, pins, NVS,
+// HID output) lives in a HalHostNode so several boards can share one process;
+// the clock is global and virtual - it only moves when the host program says so.
+
+#define HAL_HOST_MAX_PINS 64
+#define HAL_HOST_MAX_NVS_ENTRIES 64
+#define HAL_HOST_NVS_BLOB_MAX 32  // Longest halNvs_putBytes value kept
+#define HAL_HOST_MAX_HID_EVENTS 256
+#define HAL_HOST_MAX_TASKS 4
+#define HAL_HOST_ADC_BUFFER 256  // Conversions the fake DMA buffer holds before the oldest are lost
+
+typedef struct {
+  char name[16];
+  char key[16];
+  int32_t value;
+  uint8_t bytes[HAL_HOST_NVS_BLOB_MAX];  // halNvs_putBytes values; `value` holds the length
+  bool used;
+} HalHostNvsEntry;
+
+typedef struct {
+  int64_t timeMicros;
+  uint8_t key;   // Gamepad events: the button number
+  bool pressed;
+  bool gamepad;
+} HalHostHidEvent;
+
+struct HalTask {
+  HalTaskStep step;
+  void* arg;
+  int64_t periodMicros;
+  int64_t nextRunMicros;
+  bool running;   // Inside step; a notify now reruns it once step returns
+  bool notified;
+};
+
+typedef struct HalHostNode {
+  uint8_t mac[6];
+  bool pins[HAL_HOST_MAX_PINS];
+  uint32_t pinBanks[HAL_HOST_MAX_PINS / 32];  // Packed copy of pins for halGpio_readBank
+  HalGpioEdgeHandler edgeHandlers[HAL_HOST_MAX_PINS];
+  void* edgeHandlerArgs[HAL_HOST_MAX_PINS];
+  bool wakePending;  // Set by halClock_wakeFromIsr, consumed by halClock_idle
+  uint16_t analog[HAL_HOST_MAX_PINS];  // What the ADC converts on each pin
+  uint8_t adcPins[HAL_ADC_MAX_PINS];
+  uint8_t adcPinCount;
+  uint32_t adcSampleRateHz;
+  int64_t adcStartMicros;
+  uint64_t adcConversions;  // Handed out by halAdc_read since adcStartMicros
+  HalTask tasks[HAL_HOST_MAX_TASKS];
+  int taskCount;
+  bool radioInitialized;
+  HalRadioReceiveCallback receiveCallback;
+  HalRadioSendCallback sendCallback;
+  void* sendCallbackArg;
+  bool deferSendCompletion;  // Host program reports outcomes with halHost_completeSend
+  HalHostNvsEntry nvs[HAL_HOST_MAX_NVS_ENTRIES];
+  char nvsName[16];
+  bool nvsOpen;
+  bool nvsReadOnly;
+  HalHostHidEvent hidEvents[HAL_HOST_MAX_HID_EVENTS];
+  int hidEventCount;
+  bool hidReportPending;  // A press/release since the last halHid_flush
+  int hidReportCount;     // halHid_flush calls that sent a report
+  uint8_t hidModifiers;
+  uint8_t hidAxes[HAL_HID_GAMEPAD_AXES];
+  int64_t hidPollPhaseMicros;   // The fake host polls at this offset into each 1 ms frame
+  int64_t hidLastPickupMicros;  // A report staged before this waits for the next poll
+  uint8_t pixel[3];
+  bool asleep;
+  void* userData;
+} HalHostNode;
+
+// Called for every halRadio_send; returns the value halRadio_send reports
+typedef bool (*HalHostSendHook)(void* context, HalHostNode* sender, const uint8_t* dstMAC,
+                                const uint8_t* data, int len);
+// Called for every HID press/release after it is logged on the node
+typedef void (*HalHostHidHook)(void* context, HalHostNode* node, const HalHostHidEvent* event);
+
+void halHost_initNode(HalHostNode* node, const uint8_t* mac);
+void halHost_selectNode(HalHostNode* node);
+HalHostNode* halHost_currentNode();
+
+// Virtual clock
+void halHost_setMicros(int64_t micros);
+void halHost_advanceMicros(int64_t micros);
+void halHost_advanceMillis(unsigned long ms);
+void halHost_setDelayAdvancesClock(bool enabled);
+
+// GPIO (current node); a level change runs the pin's edge handler, as the ISR would
+void halHost_setPin(uint8_t pin, bool level);
+void halHost_setAnalog(uint8_t pin, uint16_t value);  // Conversions from now on read value
+
+// Radio
+void halHost_setSendHook(HalHostSendHook hook, void* context);
+void halHost_deliver(HalHostNode* node, const uint8_t* senderMAC, const uint8_t* data, int len, uint8_t channel);
+// Unless node->deferSendCompletion is set, every accepted send completes as
+// delivered immediately; otherwise the host program calls this per send
+void halHost_completeSend(HalHostNode* node, const uint8_t* dstMAC, bool delivered);
+
+// HID
+void halHost_setHidHook(HalHostHidHook hook, void* context);
+void halHost_clearHidEvents(HalHostNode* node);
+
+// Log
+void halHost_setLogEnabled(bool enabled);
+
+#endif // HAL_HOST_H
@@ -14,6 +14,9 @@
 #define MSG_BEACON         0x07
 #define MSG_TRANSMITTER_ONLINE 0x09
 #define MSG_TRANSMITTER_PAIRED 0x0A
+#define MSG_PEDAL_SNAPSHOT 0x0B
+#define MSG_PEDAL_POSITION 0x0C
+#define MSG_PEDAL_PROFILE  0x0D
 
 // Common message structure (must match between transmitter and receiver)
 typedef struct __attribute__((packed)) struct_message {
@@ -21,20 +24,103 @@ typedef struct __attribute__((packed)) struct_message {
   char key;          // '1' for pin 13, '2' for pin 14
   bool pressed;
   uint8_t pedalMode; // 0=DUAL, 1=SINGLE
+  uint8_t seq;       // MSG_PEDAL_EVENT: per-transmitter sequence number, 0=none
 } struct_message;
 
+// Frames from firmware without the seq field are this long
+#define STRUCT_MESSAGE_MIN_SIZE 4
+
+// Protocol version and capabilities ride on the discovery, alive, beacon and
+// online frames. Firmware from before them sends those frames without the
+// fields; it reads as PROTOCOL_VERSION_LEGACY with no capabilities. Each side
+// uses what both support, so old and new pedals can share one receiver.
+#define PROTOCOL_VERSION_LEGACY 1
+#define PROTOCOL_VERSION 2
+
+#define CAP_SEQUENCE      0x01  // struct_message.seq; bursts deduplicated by seq
+#define CAP_SNAPSHOT      0x02  // MSG_PEDAL_SNAPSHOT frames and keepalives
+#define CAP_COMPACT_EVENT 0x04  // Reserved for a smaller event frame
+#define CAP_TIMESTAMP     0x08  // Reserved for edge timestamps in event frames
+#define CAP_POSITION      0x10  // MSG_PEDAL_POSITION frames from analog pedals
+#define CAP_PROFILE       0x20  // MSG_PEDAL_PROFILE key mappings chosen on the pedal
+#define PROTOCOL_CAPABILITIES (CAP_SEQUENCE | CAP_SNAPSHOT | CAP_POSITION | CAP_PROFILE)  // Implemented by this firmware
+
+// MSG_DISCOVERY_REQ, MSG_DISCOVERY_RESP and MSG_ALIVE: a struct_message with
+// the sender's protocol version and capabilities appended
+typedef struct __attribute__((packed)) handshake_message {
+  uint8_t msgType;
+  char key;          // Unused, 0
+  bool pressed;      // Unused, false
+  uint8_t pedalMode; // MSG_DISCOVERY_REQ: 0=DUAL, 1=SINGLE
+  uint8_t seq;       // Unused, 0
+  uint8_t protocolVersion;
+  uint8_t capabilities;  // From a receiver: what it will accept from the recipient
+} handshake_message;
+
+// Each pedal event goes out as a burst of identical copies (same seq), queued
+// together; the receiver keeps the first and drops the rest
+#define PEDAL_EVENT_BURST_COUNT 3
+#define PEDAL_EVENT_RETRY_BUDGET 2  // Immediate resends per copy after a MAC-layer failure
+
+// State of every pedal on a transmitter. Sent (as a burst) on each change and
+// every PEDAL_SNAPSHOT_KEEPALIVE_MS while any pedal is held; a receiver that
+// hears nothing for PEDAL_SNAPSHOT_TIMEOUT_MS releases that transmitter's keys.
+typedef struct __attribute__((packed)) pedal_snapshot_message {
+  uint8_t msgType;    // 0x0B = MSG_PEDAL_SNAPSHOT
+  uint8_t pedalMask;  // Bit 0 = pedal '1', bit 1 = pedal '2'; 1=pressed
+  uint8_t pedalMode;  // 0=DUAL, 1=SINGLE
+  uint8_t seq;        // Same numbering as struct_message; keepalives repeat it
+} pedal_snapshot_message;
+
+#define PEDAL_SNAPSHOT_KEEPALIVE_MS 100
+#define PEDAL_SNAPSHOT_TIMEOUT_MS 350  // Three lost keepalives
+
+// Travel of each pedal on an analog transmitter, sent while any pedal moves.
+// A keyframe carries every position; the frames between carry each pedal's
+// change since the previous frame as a signed nibble, pedal '1' in the low
+// half. Key state still travels in MSG_PEDAL_SNAPSHOT: these frames only feed
+// analog outputs, so they go out once without retries, and a receiver that
+// misses one ignores deltas until the next keyframe.
+typedef struct __attribute__((packed)) pedal_position_message {
+  uint8_t msgType;       // 0x0C = MSG_PEDAL_POSITION
+  uint8_t seq;           // Bits 0-6 count position frames; bit 7 marks a keyframe
+  uint8_t positions[2];  // Keyframe: 0 = at rest, 255 = fully pressed. Delta: positions[0] only.
+} pedal_position_message;
+
+#define PEDAL_POSITION_KEYFRAME 0x80
+#define PEDAL_POSITION_SEQ_MASK 0x7F
+#define PEDAL_POSITION_DELTA_SIZE 3   // A delta frame ends after positions[0]
+#define PEDAL_POSITION_DELTA_MAX 7    // Larger changes go out as a keyframe
+#define PEDAL_POSITION_INTERVAL_MS 4  // At most one frame per interval
+#define PEDAL_POSITION_KEYFRAME_MS 100  // A keyframe at least this often while moving, and once after
+#define PEDAL_POSITION_DEADBAND 1     // Changes this small are sensor noise: no frame of their own
+
+// Keys of the profile selected on the pedal (the PanicPedal Pro's switch).
+// Sent as a burst when the selection changes and again after each pairing;
+// the receiver types these keys in place of the saved bindings, which it keeps.
+typedef struct __attribute__((packed)) pedal_profile_message {
+  uint8_t msgType;       // 0x0D = MSG_PEDAL_PROFILE
+  uint8_t profile;       // Which profile, for logs
+  char keys[2];          // Per pedal; 0 = the binding saved on the receiver
+  uint8_t modifiers[2];  // HID modifier bits held with each key
+} pedal_profile_message;
+
 // Beacon message structure
 typedef struct __attribute__((packed)) beacon_message {
   uint8_t msgType;        // 0x07 = MSG_BEACON
   uint8_t receiverMAC[6];
   uint8_t availableSlots;
   uint8_t totalSlots;
+  uint8_t protocolVersion;
+  uint8_t capabilities;
 } beacon_message;
 
 // Transmitter online message structure
 typedef struct __attribute__((packed)) transmitter_online_message {
   uint8_t msgType;        // 0x09 = MSG_TRANSMITTER_ONLINE
   uint8_t transmitterMAC[6];
+  uint8_t protocolVersion;
+  uint8_t capabilities;
 } transmitter_online_message;
 
 // Transmitter paired message structure
@@ -0,0 +1,30 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "messages.h"
+
+// MAC address helpers
+static inline bool macEqual(const uint8_t* a, const uint8_t* b) {
+  return memcmp(a, b, 6) == 0;
+}
+
+static inline void macCopy(uint8_t* dst, const uint8_t* src) {
+  memcpy(dst, src, 6);
+}
+
+// A usable unicast MAC: not all-zero, not broadcast
+static inline bool isValidMAC(const uint8_t* mac) {
+  static const uint8_t zeroMAC[6] = {0, 0, 0, 0, 0, 0};
+  static const uint8_t broadcastMAC[6] = BROADCAST_MAC;
+  return !macEqual(mac, zeroMAC) && !macEqual(mac, broadcastMAC);
+}
+
+// Receiver slots taken by a transmitter: 0=DUAL needs 2, 1=SINGLE needs 1
+static inline int getSlotsNeeded(uint8_t pedalMode) {
+  return (pedalMode == 0) ? 2 : 1;
+}
+
+#endif // UTILS_H